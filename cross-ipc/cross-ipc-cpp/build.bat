@@ -13,16 +13,16 @@ if not exist bin mkdir bin
 echo Compiling library source files...
 for %%f in (src\*.cpp) do (
     echo Compiling %%f...
-    cl.exe /c /EHsc /std:c++14 /Iinclude /Fo"bin\%%~nf.obj" %%f
+    cl.exe /c /EHsc /std:c++20 /Iinclude /Fo"bin\%%~nf.obj" %%f
     if errorlevel 1 goto error
 )
 
 echo Compiling counter_incrementer example...
-cl.exe /c /EHsc /std:c++14 /Iinclude /Fo"bin\counter_incrementer.obj" examples\counter_incrementer.cpp
+cl.exe /c /EHsc /std:c++20 /Iinclude /Fo"bin\counter_incrementer.obj" examples\counter_incrementer.cpp
 if errorlevel 1 goto error
 
 echo Creating counter_incrementer executable...
-cl.exe /EHsc /std:c++14 /Febin\counter_incrementer.exe bin\counter_incrementer.obj bin\cross_ipc.obj bin\named_pipe.obj bin\shared_memory.obj bin\shm_dispenser_pattern.obj bin\store_dict_pattern.obj
+cl.exe /EHsc /std:c++20 /Febin\counter_incrementer.exe bin\counter_incrementer.obj bin\cross_ipc.obj bin\named_pipe.obj bin\shared_memory.obj bin\shm_dispenser_pattern.obj bin\store_dict_pattern.obj
 if errorlevel 1 goto error
 
 echo Copying DLL to output directory...
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "cross_ipc.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <vector>
 
 namespace cross_ipc {
@@ -23,6 +26,15 @@ public:
     void WriteBytes(const std::vector<uint8_t>& data);
     std::string Read();
     std::vector<uint8_t> ReadBytes();
+    
+    // Zero-copy view of the current payload. The span points into the mapping;
+    // call IsBorrowValid(generation) after using it to detect concurrent writes.
+    // The span dangles once the mapping goes: after Close(), and after any call
+    // that remaps this handle, which a write to a growable segment or another
+    // process growing it can do. Reading it then is undefined behaviour that
+    // IsBorrowValid cannot detect, so copy out what you need first.
+    std::span<const std::byte> Borrow(uint32_t* generation = nullptr);
+    bool IsBorrowValid(uint32_t generation);
     void Clear();
     void Close();
     void Unlink();
@@ -30,6 +42,9 @@ public:
     // Lock-related methods
     bool LockForWriting(unsigned long timeout_ms = 5000);
     bool UnlockFromWriting();
+    // Shared lock: any number of readers, blocked while a writer waits or holds
+    bool LockForReading(unsigned long timeout_ms = 5000);
+    bool UnlockFromReading();
     bool WriteWithLock(const std::string& data, unsigned long timeout_ms = 5000);
     bool WriteBytesWithLock(const std::vector<uint8_t>& data, unsigned long timeout_ms = 5000);
     
@@ -43,12 +58,16 @@ private:
     using WriteBytesFn = void (*)(void*, const uint8_t*, size_t);
     using ReadFn = const char* (*)(void*);
     using ReadBytesFn = const uint8_t* (*)(void*, size_t*);
+    using BorrowFn = const uint8_t* (*)(void*, size_t*, uint32_t*);
+    using ValidateBorrowFn = bool (*)(void*, uint32_t);
     using ClearFn = void (*)(void*);
     using CloseFn = void (*)(void*);
     using UnlinkFn = void (*)(void*);
     using DestroyFn = void (*)(void*);
     using LockForWritingFn = bool (*)(void*, unsigned long);
     using UnlockFromWritingFn = bool (*)(void*);
+    using LockForReadingFn = bool (*)(void*, unsigned long);
+    using UnlockFromReadingFn = bool (*)(void*);
     
     CreateFn create_;
     SetupFn setup_;
@@ -56,12 +75,16 @@ private:
     WriteBytesFn writeBytes_;
     ReadFn read_;
     ReadBytesFn readBytes_;
+    BorrowFn borrow_;
+    ValidateBorrowFn validateBorrow_;
     ClearFn clear_;
     CloseFn close_;
     UnlinkFn unlink_;
     DestroyFn destroy_;
     LockForWritingFn lockForWriting_;
     UnlockFromWritingFn unlockFromWriting_;
+    LockForReadingFn lockForReading_;
+    UnlockFromReadingFn unlockFromReading_;
 };
 
 } // namespace cross_ipc 
\ No newline at end of file
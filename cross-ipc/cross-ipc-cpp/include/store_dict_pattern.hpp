@@ -1,6 +1,10 @@
 #pragma once
 
 #include "cross_ipc.hpp"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
 
 namespace cross_ipc {
 
@@ -16,10 +20,47 @@ public:
     StoreDictPattern(StoreDictPattern&&) = delete;
     StoreDictPattern& operator=(StoreDictPattern&&) = delete;
     
+    // Scan visitor: return false to stop the scan early
+    using ScanCallback = std::function<bool(const std::string& key, const std::string& value)>;
+    
     // Public methods
+    bool SetOrdered(bool ordered);
+    // Bounds the table to `capacity` arena bytes; writes past it evict
+    // approximately least recently used entries. Call before Setup().
+    bool SetCapacity(uint64_t capacity);
     bool Setup();
     void Store(const std::string& key, const std::string& value);
     std::string Retrieve(const std::string& key);
+    
+    // The entry reads as absent once ttl_ms has passed; 0 never expires
+    bool StoreWithTtl(const std::string& key, const std::string& value, uint64_t ttl_ms);
+    // Removes expired entries from the next max_buckets buckets (0: all)
+    size_t Sweep(uint32_t max_buckets = 0);
+    
+    // Optimistic concurrency: `version` is 0 for absent keys. StoreIfVersion
+    // stores only while the entry is still at `version`, and either way
+    // leaves it holding the entry's current version.
+    std::string RetrieveWithVersion(const std::string& key, uint64_t& version);
+    bool StoreIfVersion(const std::string& key, const std::string& value, uint64_t& version);
+    
+    // Batches take the dictionary lock once for all keys
+    size_t StoreMany(const std::map<std::string, std::string>& items);
+    std::map<std::string, std::string> RetrieveMany(const std::vector<std::string>& keys);
+    
+    // 64-bit counters updated with CPU atomics in shared memory
+    bool CreateCounter(const std::string& key, int64_t initial = 0, uint32_t shards = 1);
+    int64_t AtomicAdd(const std::string& key, int64_t delta = 1);
+    int64_t AtomicGet(const std::string& key);
+    bool CompareExchange(const std::string& key, int64_t& expected, int64_t desired);
+    
+    // Ordered scans in key order; need SetOrdered(true) before Setup().
+    // ScanRange covers [start, end), and an empty end runs to the last key.
+    size_t ScanPrefix(const std::string& prefix, const ScanCallback& callback);
+    size_t ScanRange(const std::string& start, const std::string& end, const ScanCallback& callback);
+    
+    // Warm start: dump the segment image to a file and load it back whole
+    bool Snapshot(const std::string& path);
+    bool Restore(const std::string& path);
     void Close();
     
 private:
@@ -30,6 +71,25 @@ private:
     using SetupFn = bool (*)(void*);
     using StoreFn = void (*)(void*, const char*, const char*);
     using RetrieveFn = const char* (*)(void*, const char*);
+    using RetrieveWithVersionFn = char* (*)(void*, const char*, uint64_t*);
+    using StoreIfVersionFn = bool (*)(void*, const char*, const char*, uint64_t, uint64_t*);
+    using StoreManyFn = size_t (*)(void*, const char**, const unsigned char**, const size_t*, size_t);
+    using RetrieveManyFn = size_t (*)(void*, const char**, size_t, unsigned char**, size_t*);
+    using FreeValuesFn = void (*)(unsigned char**, size_t);
+    using CreateCounterFn = bool (*)(void*, const char*, int64_t, uint32_t);
+    using AtomicAddFn = bool (*)(void*, const char*, int64_t, int64_t*);
+    using AtomicGetFn = bool (*)(void*, const char*, int64_t*);
+    using CompareExchangeFn = bool (*)(void*, const char*, int64_t, int64_t, int64_t*);
+    using PathFn = bool (*)(void*, const char*);
+    using SetOrderedFn = bool (*)(void*, bool);
+    using SetCapacityFn = bool (*)(void*, uint64_t);
+    using StoreWithTtlFn = bool (*)(void*, const char*, const char*, uint64_t);
+    using SweepFn = size_t (*)(void*, uint32_t);
+    using ScanVisitFn = bool (*)(const char*, const unsigned char*, size_t, void*);
+    using ScanPrefixFn = size_t (*)(void*, const char*, ScanVisitFn, void*);
+    using ScanRangeFn = size_t (*)(void*, const char*, const char*, ScanVisitFn, void*);
+    
+    static bool ScanTrampoline(const char* key, const unsigned char* value, size_t size, void* user_data);
     using CloseFn = void (*)(void*);
     using DestroyFn = void (*)(void*);
     
@@ -37,6 +97,23 @@ private:
     SetupFn setup_;
     StoreFn store_;
     RetrieveFn retrieve_;
+    RetrieveWithVersionFn retrieve_with_version_;
+    StoreIfVersionFn store_if_version_;
+    StoreManyFn store_many_;
+    RetrieveManyFn retrieve_many_;
+    FreeValuesFn free_values_;
+    CreateCounterFn create_counter_;
+    AtomicAddFn atomic_add_;
+    AtomicGetFn atomic_get_;
+    CompareExchangeFn compare_exchange_;
+    PathFn snapshot_;
+    PathFn restore_;
+    SetOrderedFn set_ordered_;
+    SetCapacityFn set_capacity_;
+    StoreWithTtlFn store_with_ttl_;
+    SweepFn sweep_;
+    ScanPrefixFn scan_prefix_;
+    ScanRangeFn scan_range_;
     CloseFn close_;
     DestroyFn destroy_;
 };
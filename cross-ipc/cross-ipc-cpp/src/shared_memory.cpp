@@ -38,6 +38,16 @@ SharedMemory::SharedMemory(const std::string& id, size_t size, bool verbose)
         throw CrossIPCError("Failed to find SharedMemory_read_bytes_api: " + GetLastErrorAsString());
     }
     
+    borrow_ = reinterpret_cast<BorrowFn>(GetProcAddress(dll, "SharedMemory_borrow_api"));
+    if (!borrow_) {
+        throw CrossIPCError("Failed to find SharedMemory_borrow_api: " + GetLastErrorAsString());
+    }
+    
+    validateBorrow_ = reinterpret_cast<ValidateBorrowFn>(GetProcAddress(dll, "SharedMemory_validate_borrow_api"));
+    if (!validateBorrow_) {
+        throw CrossIPCError("Failed to find SharedMemory_validate_borrow_api: " + GetLastErrorAsString());
+    }
+    
     clear_ = reinterpret_cast<ClearFn>(GetProcAddress(dll, "SharedMemory_clear_api"));
     if (!clear_) {
         throw CrossIPCError("Failed to find SharedMemory_clear_api: " + GetLastErrorAsString());
@@ -69,6 +79,16 @@ SharedMemory::SharedMemory(const std::string& id, size_t size, bool verbose)
         throw CrossIPCError("Failed to find SharedMemory_unlock_from_writing_api: " + GetLastErrorAsString());
     }
     
+    lockForReading_ = reinterpret_cast<LockForReadingFn>(GetProcAddress(dll, "SharedMemory_lock_for_reading_api"));
+    if (!lockForReading_) {
+        throw CrossIPCError("Failed to find SharedMemory_lock_for_reading_api: " + GetLastErrorAsString());
+    }
+    
+    unlockFromReading_ = reinterpret_cast<UnlockFromReadingFn>(GetProcAddress(dll, "SharedMemory_unlock_from_reading_api"));
+    if (!unlockFromReading_) {
+        throw CrossIPCError("Failed to find SharedMemory_unlock_from_reading_api: " + GetLastErrorAsString());
+    }
+    
     
     handle_ = create_(id.c_str(), size, verbose);
     if (!handle_) {
@@ -141,6 +161,34 @@ std::vector<uint8_t> SharedMemory::ReadBytes() {
     return std::vector<uint8_t>(data, data + size);
 }
 
+std::span<const std::byte> SharedMemory::Borrow(uint32_t* generation) {
+    if (!handle_) {
+        throw CrossIPCError("SharedMemory not initialized");
+    }
+    
+    size_t size = 0;
+    uint32_t token = 0;
+    const uint8_t* data = borrow_(handle_, &size, &token);
+    
+    if (!data) {
+        throw CrossIPCError("Failed to borrow shared memory contents");
+    }
+    
+    if (generation) {
+        *generation = token;
+    }
+    
+    return std::span<const std::byte>(reinterpret_cast<const std::byte*>(data), size);
+}
+
+bool SharedMemory::IsBorrowValid(uint32_t generation) {
+    if (!handle_) {
+        throw CrossIPCError("SharedMemory not initialized");
+    }
+    
+    return validateBorrow_(handle_, generation);
+}
+
 void SharedMemory::Clear() {
     if (!handle_) {
         throw CrossIPCError("SharedMemory not initialized");
@@ -182,6 +230,22 @@ bool SharedMemory::UnlockFromWriting() {
     return unlockFromWriting_(handle_);
 }
 
+bool SharedMemory::LockForReading(unsigned long timeout_ms) {
+    if (!handle_) {
+        throw CrossIPCError("SharedMemory not initialized");
+    }
+    
+    return lockForReading_(handle_, timeout_ms);
+}
+
+bool SharedMemory::UnlockFromReading() {
+    if (!handle_) {
+        throw CrossIPCError("SharedMemory not initialized");
+    }
+    
+    return unlockFromReading_(handle_);
+}
+
 bool SharedMemory::WriteWithLock(const std::string& data, unsigned long timeout_ms) {
     if (!handle_) {
         throw CrossIPCError("SharedMemory not initialized");
@@ -28,6 +28,93 @@ StoreDictPattern::StoreDictPattern(const std::string& name, size_t size, bool ve
         throw CrossIPCError("Failed to find StoreDictPattern_retrieve_string_api: " + GetLastErrorAsString());
     }
     
+    retrieve_with_version_ = reinterpret_cast<RetrieveWithVersionFn>(
+        GetProcAddress(dll, "StoreDictPattern_retrieve_string_with_version_api"));
+    if (!retrieve_with_version_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_retrieve_string_with_version_api: " + GetLastErrorAsString());
+    }
+    
+    store_if_version_ = reinterpret_cast<StoreIfVersionFn>(
+        GetProcAddress(dll, "StoreDictPattern_store_string_if_version_api"));
+    if (!store_if_version_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_store_string_if_version_api: " + GetLastErrorAsString());
+    }
+    
+    store_many_ = reinterpret_cast<StoreManyFn>(GetProcAddress(dll, "StoreDictPattern_store_many_api"));
+    if (!store_many_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_store_many_api: " + GetLastErrorAsString());
+    }
+    
+    retrieve_many_ = reinterpret_cast<RetrieveManyFn>(GetProcAddress(dll, "StoreDictPattern_retrieve_many_api"));
+    if (!retrieve_many_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_retrieve_many_api: " + GetLastErrorAsString());
+    }
+    
+    free_values_ = reinterpret_cast<FreeValuesFn>(GetProcAddress(dll, "StoreDictPattern_free_values_api"));
+    if (!free_values_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_free_values_api: " + GetLastErrorAsString());
+    }
+    
+    create_counter_ = reinterpret_cast<CreateCounterFn>(GetProcAddress(dll, "StoreDictPattern_create_counter_api"));
+    if (!create_counter_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_create_counter_api: " + GetLastErrorAsString());
+    }
+    
+    atomic_add_ = reinterpret_cast<AtomicAddFn>(GetProcAddress(dll, "StoreDictPattern_atomic_add_api"));
+    if (!atomic_add_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_atomic_add_api: " + GetLastErrorAsString());
+    }
+    
+    atomic_get_ = reinterpret_cast<AtomicGetFn>(GetProcAddress(dll, "StoreDictPattern_atomic_get_api"));
+    if (!atomic_get_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_atomic_get_api: " + GetLastErrorAsString());
+    }
+    
+    compare_exchange_ = reinterpret_cast<CompareExchangeFn>(GetProcAddress(dll, "StoreDictPattern_compare_exchange_api"));
+    if (!compare_exchange_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_compare_exchange_api: " + GetLastErrorAsString());
+    }
+    
+    snapshot_ = reinterpret_cast<PathFn>(GetProcAddress(dll, "StoreDictPattern_snapshot_api"));
+    if (!snapshot_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_snapshot_api: " + GetLastErrorAsString());
+    }
+    
+    restore_ = reinterpret_cast<PathFn>(GetProcAddress(dll, "StoreDictPattern_restore_api"));
+    if (!restore_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_restore_api: " + GetLastErrorAsString());
+    }
+    
+    set_ordered_ = reinterpret_cast<SetOrderedFn>(GetProcAddress(dll, "StoreDictPattern_set_ordered_api"));
+    if (!set_ordered_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_set_ordered_api: " + GetLastErrorAsString());
+    }
+    
+    set_capacity_ = reinterpret_cast<SetCapacityFn>(GetProcAddress(dll, "StoreDictPattern_set_capacity_api"));
+    if (!set_capacity_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_set_capacity_api: " + GetLastErrorAsString());
+    }
+    
+    store_with_ttl_ = reinterpret_cast<StoreWithTtlFn>(GetProcAddress(dll, "StoreDictPattern_store_string_with_ttl_api"));
+    if (!store_with_ttl_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_store_string_with_ttl_api: " + GetLastErrorAsString());
+    }
+    
+    sweep_ = reinterpret_cast<SweepFn>(GetProcAddress(dll, "StoreDictPattern_sweep_api"));
+    if (!sweep_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_sweep_api: " + GetLastErrorAsString());
+    }
+    
+    scan_prefix_ = reinterpret_cast<ScanPrefixFn>(GetProcAddress(dll, "StoreDictPattern_scan_prefix_api"));
+    if (!scan_prefix_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_scan_prefix_api: " + GetLastErrorAsString());
+    }
+    
+    scan_range_ = reinterpret_cast<ScanRangeFn>(GetProcAddress(dll, "StoreDictPattern_scan_range_api"));
+    if (!scan_range_) {
+        throw CrossIPCError("Failed to find StoreDictPattern_scan_range_api: " + GetLastErrorAsString());
+    }
+    
     close_ = reinterpret_cast<CloseFn>(GetProcAddress(dll, "StoreDictPattern_close_api"));
     if (!close_) {
         throw CrossIPCError("Failed to find StoreDictPattern_close_api: " + GetLastErrorAsString());
@@ -56,6 +143,20 @@ StoreDictPattern::~StoreDictPattern() {
     }
 }
 
+bool StoreDictPattern::SetOrdered(bool ordered) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return set_ordered_(handle_, ordered);
+}
+
+bool StoreDictPattern::SetCapacity(uint64_t capacity) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return set_capacity_(handle_, capacity);
+}
+
 bool StoreDictPattern::Setup() {
     if (!handle_) {
         throw CrossIPCError("StoreDictPattern not initialized");
@@ -85,6 +186,178 @@ std::string StoreDictPattern::Retrieve(const std::string& key) {
     return PtrToString(value);
 }
 
+std::string StoreDictPattern::RetrieveWithVersion(const std::string& key, uint64_t& version) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    
+    version = 0;
+    const char* result = retrieve_with_version_(handle_, key.c_str(), &version);
+    return result ? PtrToString(result) : std::string();
+}
+
+bool StoreDictPattern::StoreIfVersion(const std::string& key, const std::string& value, uint64_t& version) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    
+    uint64_t current = 0;
+    bool stored = store_if_version_(handle_, key.c_str(), value.c_str(), version, &current);
+    version = current;
+    return stored;
+}
+
+size_t StoreDictPattern::StoreMany(const std::map<std::string, std::string>& items) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    
+    std::vector<const char*> keys;
+    std::vector<const unsigned char*> values;
+    std::vector<size_t> sizes;
+    keys.reserve(items.size());
+    values.reserve(items.size());
+    sizes.reserve(items.size());
+    
+    // Values keep their terminator, as Store does
+    for (const auto& item : items) {
+        keys.push_back(item.first.c_str());
+        values.push_back(reinterpret_cast<const unsigned char*>(item.second.c_str()));
+        sizes.push_back(item.second.size() + 1);
+    }
+    
+    return store_many_(handle_, keys.data(), values.data(), sizes.data(), keys.size());
+}
+
+std::map<std::string, std::string> StoreDictPattern::RetrieveMany(const std::vector<std::string>& keys) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    
+    std::vector<const char*> key_ptrs;
+    key_ptrs.reserve(keys.size());
+    for (const auto& key : keys) {
+        key_ptrs.push_back(key.c_str());
+    }
+    std::vector<unsigned char*> values(keys.size(), nullptr);
+    std::vector<size_t> sizes(keys.size(), 0);
+    
+    retrieve_many_(handle_, key_ptrs.data(), key_ptrs.size(), values.data(), sizes.data());
+    
+    // Missing keys are left out of the result
+    std::map<std::string, std::string> result;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (values[i]) {
+            size_t size = sizes[i];
+            if (size > 0 && values[i][size - 1] == '\0') {
+                size--;
+            }
+            result[keys[i]] = std::string(reinterpret_cast<const char*>(values[i]), size);
+        }
+    }
+    free_values_(values.data(), values.size());
+    return result;
+}
+
+bool StoreDictPattern::CreateCounter(const std::string& key, int64_t initial, uint32_t shards) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return create_counter_(handle_, key.c_str(), initial, shards);
+}
+
+// Missing keys start at 0
+int64_t StoreDictPattern::AtomicAdd(const std::string& key, int64_t delta) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    int64_t value = 0;
+    if (!atomic_add_(handle_, key.c_str(), delta, &value)) {
+        throw CrossIPCError("Key is not a counter: " + key);
+    }
+    return value;
+}
+
+int64_t StoreDictPattern::AtomicGet(const std::string& key) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    int64_t value = 0;
+    if (!atomic_get_(handle_, key.c_str(), &value)) {
+        throw CrossIPCError("Key is not a counter: " + key);
+    }
+    return value;
+}
+
+// Like std::atomic: on failure `expected` is updated to the value found
+bool StoreDictPattern::CompareExchange(const std::string& key, int64_t& expected, int64_t desired) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    int64_t actual = 0;
+    if (!compare_exchange_(handle_, key.c_str(), expected, desired, &actual)) {
+        throw CrossIPCError("Key is not a plain counter: " + key);
+    }
+    bool exchanged = actual == expected;
+    expected = actual;
+    return exchanged;
+}
+
+bool StoreDictPattern::Snapshot(const std::string& path) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return snapshot_(handle_, path.c_str());
+}
+
+bool StoreDictPattern::Restore(const std::string& path) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return restore_(handle_, path.c_str());
+}
+
+bool StoreDictPattern::StoreWithTtl(const std::string& key, const std::string& value, uint64_t ttl_ms) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return store_with_ttl_(handle_, key.c_str(), value.c_str(), ttl_ms);
+}
+
+size_t StoreDictPattern::Sweep(uint32_t max_buckets) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return sweep_(handle_, max_buckets);
+}
+
+// Values are copied out while the dictionary lock is held; the callback
+// must not call back into this dictionary
+bool StoreDictPattern::ScanTrampoline(const char* key, const unsigned char* value, size_t size, void* user_data) {
+    const ScanCallback& callback = *static_cast<const ScanCallback*>(user_data);
+    // Stored strings carry their terminator
+    if (size > 0 && value[size - 1] == '\0') {
+        size--;
+    }
+    return callback(key, std::string(reinterpret_cast<const char*>(value), size));
+}
+
+size_t StoreDictPattern::ScanPrefix(const std::string& prefix, const ScanCallback& callback) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    return scan_prefix_(handle_, prefix.c_str(), ScanTrampoline, const_cast<ScanCallback*>(&callback));
+}
+
+size_t StoreDictPattern::ScanRange(const std::string& start, const std::string& end, const ScanCallback& callback) {
+    if (!handle_) {
+        throw CrossIPCError("StoreDictPattern not initialized");
+    }
+    // An empty end leaves the range open above
+    return scan_range_(handle_, start.c_str(), end.empty() ? nullptr : end.c_str(), ScanTrampoline,
+        const_cast<ScanCallback*>(&callback));
+}
+
 void StoreDictPattern::Close() {
     if (handle_) {
         close_(handle_);
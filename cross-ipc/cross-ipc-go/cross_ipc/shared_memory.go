@@ -21,6 +21,11 @@ type SharedMemory struct {
 	unlink     *syscall.Proc
 	destroy    *syscall.Proc
 	isLocked   *syscall.Proc // New procedure for checking lock status
+
+	lockForWriting    *syscall.Proc
+	unlockFromWriting *syscall.Proc
+	lockForReading    *syscall.Proc
+	unlockFromReading *syscall.Proc
 }
 
 
@@ -81,6 +86,26 @@ func NewSharedMemory(id string, size int, verbose bool) (*SharedMemory, error) {
 		return nil, fmt.Errorf("failed to find SharedMemory_destroy: %w", err)
 	}
 
+	lockForWritingProc, err := dll.FindProc("SharedMemory_lock_for_writing_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find SharedMemory_lock_for_writing_api: %w", err)
+	}
+
+	unlockFromWritingProc, err := dll.FindProc("SharedMemory_unlock_from_writing_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find SharedMemory_unlock_from_writing_api: %w", err)
+	}
+
+	lockForReadingProc, err := dll.FindProc("SharedMemory_lock_for_reading_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find SharedMemory_lock_for_reading_api: %w", err)
+	}
+
+	unlockFromReadingProc, err := dll.FindProc("SharedMemory_unlock_from_reading_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find SharedMemory_unlock_from_reading_api: %w", err)
+	}
+
 	
 	isLockedProc, err := dll.FindProc("SharedMemory_is_locked")
 	if err != nil {
@@ -118,6 +143,11 @@ func NewSharedMemory(id string, size int, verbose bool) (*SharedMemory, error) {
 		unlink:     unlinkProc,
 		destroy:    destroyProc,
 		isLocked:   isLockedProc,
+
+		lockForWriting:    lockForWritingProc,
+		unlockFromWriting: unlockFromWritingProc,
+		lockForReading:    lockForReadingProc,
+		unlockFromReading: unlockFromReadingProc,
 	}, nil
 }
 
@@ -200,6 +230,29 @@ func (s *SharedMemory) IsLocked() (bool, error) {
 }
 
 
+// LockForWriting takes the exclusive lock, waiting out readers and other writers
+func (s *SharedMemory) LockForWriting(timeoutMs uint32) (bool, error) {
+	result, _, err := s.lockForWriting.Call(s.handle, uintptr(timeoutMs))
+	return result != 0, err
+}
+
+func (s *SharedMemory) UnlockFromWriting() (bool, error) {
+	result, _, err := s.unlockFromWriting.Call(s.handle)
+	return result != 0, err
+}
+
+// LockForReading takes a shared lock; it only waits while a writer is pending or active
+func (s *SharedMemory) LockForReading(timeoutMs uint32) (bool, error) {
+	result, _, err := s.lockForReading.Call(s.handle, uintptr(timeoutMs))
+	return result != 0, err
+}
+
+func (s *SharedMemory) UnlockFromReading() (bool, error) {
+	result, _, err := s.unlockFromReading.Call(s.handle)
+	return result != 0, err
+}
+
+
 func (s *SharedMemory) Clear() error {
 	_, _, err := s.clear.Call(s.handle)
 	return err
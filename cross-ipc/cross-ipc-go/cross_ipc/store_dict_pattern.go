@@ -3,19 +3,38 @@ package cross_ipc
 
 import (
 	"fmt"
+	"runtime"
+	"sync"
 	"syscall"
 	"unsafe"
 )
 
 // StoreDictPattern represents a dictionary-like pattern for storing and retrieving data
 type StoreDictPattern struct {
-	handle   uintptr
-	create   *syscall.Proc
-	setup    *syscall.Proc
-	store    *syscall.Proc
-	retrieve *syscall.Proc
-	close    *syscall.Proc
-	destroy  *syscall.Proc
+	handle          uintptr
+	create          *syscall.Proc
+	setup           *syscall.Proc
+	store           *syscall.Proc
+	retrieve        *syscall.Proc
+	retrieveVersion *syscall.Proc
+	storeIfVersion  *syscall.Proc
+	storeMany       *syscall.Proc
+	retrieveMany    *syscall.Proc
+	freeValues      *syscall.Proc
+	createCounter   *syscall.Proc
+	atomicAdd       *syscall.Proc
+	atomicGet       *syscall.Proc
+	compareExchange *syscall.Proc
+	snapshot        *syscall.Proc
+	restore         *syscall.Proc
+	setOrdered      *syscall.Proc
+	setCapacity     *syscall.Proc
+	storeWithTTL    *syscall.Proc
+	sweep           *syscall.Proc
+	scanPrefix      *syscall.Proc
+	scanRange       *syscall.Proc
+	close           *syscall.Proc
+	destroy         *syscall.Proc
 }
 
 
@@ -46,6 +65,91 @@ func NewStoreDictPattern(name string, size int, verbose bool) (*StoreDictPattern
 		return nil, fmt.Errorf("failed to find StoreDictPattern_retrieve_string_api: %w", err)
 	}
 
+	retrieveVersionProc, err := dll.FindProc("StoreDictPattern_retrieve_string_with_version_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_retrieve_string_with_version_api: %w", err)
+	}
+
+	storeIfVersionProc, err := dll.FindProc("StoreDictPattern_store_string_if_version_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_store_string_if_version_api: %w", err)
+	}
+
+	storeManyProc, err := dll.FindProc("StoreDictPattern_store_many_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_store_many_api: %w", err)
+	}
+
+	retrieveManyProc, err := dll.FindProc("StoreDictPattern_retrieve_many_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_retrieve_many_api: %w", err)
+	}
+
+	freeValuesProc, err := dll.FindProc("StoreDictPattern_free_values_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_free_values_api: %w", err)
+	}
+
+	createCounterProc, err := dll.FindProc("StoreDictPattern_create_counter_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_create_counter_api: %w", err)
+	}
+
+	atomicAddProc, err := dll.FindProc("StoreDictPattern_atomic_add_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_atomic_add_api: %w", err)
+	}
+
+	atomicGetProc, err := dll.FindProc("StoreDictPattern_atomic_get_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_atomic_get_api: %w", err)
+	}
+
+	compareExchangeProc, err := dll.FindProc("StoreDictPattern_compare_exchange_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_compare_exchange_api: %w", err)
+	}
+
+	snapshotProc, err := dll.FindProc("StoreDictPattern_snapshot_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_snapshot_api: %w", err)
+	}
+
+	restoreProc, err := dll.FindProc("StoreDictPattern_restore_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_restore_api: %w", err)
+	}
+
+	setOrderedProc, err := dll.FindProc("StoreDictPattern_set_ordered_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_set_ordered_api: %w", err)
+	}
+
+	setCapacityProc, err := dll.FindProc("StoreDictPattern_set_capacity_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_set_capacity_api: %w", err)
+	}
+
+	storeWithTTLProc, err := dll.FindProc("StoreDictPattern_store_string_with_ttl_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_store_string_with_ttl_api: %w", err)
+	}
+
+	sweepProc, err := dll.FindProc("StoreDictPattern_sweep_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_sweep_api: %w", err)
+	}
+
+	scanPrefixProc, err := dll.FindProc("StoreDictPattern_scan_prefix_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_scan_prefix_api: %w", err)
+	}
+
+	scanRangeProc, err := dll.FindProc("StoreDictPattern_scan_range_api")
+	if err != nil {
+		return nil, fmt.Errorf("failed to find StoreDictPattern_scan_range_api: %w", err)
+	}
+
 	closeProc, err := dll.FindProc("StoreDictPattern_close_api")
 	if err != nil {
 		return nil, fmt.Errorf("failed to find StoreDictPattern_close_api: %w", err)
@@ -74,17 +178,53 @@ func NewStoreDictPattern(name string, size int, verbose bool) (*StoreDictPattern
 	}
 
 	return &StoreDictPattern{
-		handle:   handle,
-		create:   createProc,
-		setup:    setupProc,
-		store:    storeProc,
-		retrieve: retrieveProc,
-		close:    closeProc,
-		destroy:  destroyProc,
+		handle:          handle,
+		create:          createProc,
+		setup:           setupProc,
+		store:           storeProc,
+		retrieve:        retrieveProc,
+		retrieveVersion: retrieveVersionProc,
+		storeIfVersion:  storeIfVersionProc,
+		storeMany:       storeManyProc,
+		retrieveMany:    retrieveManyProc,
+		freeValues:      freeValuesProc,
+		createCounter:   createCounterProc,
+		atomicAdd:       atomicAddProc,
+		atomicGet:       atomicGetProc,
+		compareExchange: compareExchangeProc,
+		snapshot:        snapshotProc,
+		restore:         restoreProc,
+		setOrdered:      setOrderedProc,
+		setCapacity:     setCapacityProc,
+		storeWithTTL:    storeWithTTLProc,
+		sweep:           sweepProc,
+		scanPrefix:      scanPrefixProc,
+		scanRange:       scanRangeProc,
+		close:           closeProc,
+		destroy:         destroyProc,
 	}, nil
 }
 
 
+// SetOrdered asks for the ordered index used by ScanPrefix and ScanRange;
+// it must be called before Setup
+func (d *StoreDictPattern) SetOrdered(ordered bool) (bool, error) {
+	orderedInt := 0
+	if ordered {
+		orderedInt = 1
+	}
+
+	result, _, err := d.setOrdered.Call(d.handle, uintptr(orderedInt))
+	return result&0xFF != 0, handleWindowsError(err)
+}
+
+// SetCapacity bounds the table to capacity arena bytes; writes past it
+// evict approximately least recently used entries. Call before Setup.
+func (d *StoreDictPattern) SetCapacity(capacity uint64) (bool, error) {
+	result, _, err := d.setCapacity.Call(d.handle, uintptr(capacity))
+	return result&0xFF != 0, handleWindowsError(err)
+}
+
 func (d *StoreDictPattern) Setup() (bool, error) {
 	result, _, err := d.setup.Call(d.handle)
 	return result != 0, err
@@ -121,6 +261,306 @@ func (d *StoreDictPattern) Retrieve(key string) (string, error) {
 }
 
 
+// RetrieveWithVersion returns the value of key and its entry version. The
+// version is 0 when the key is absent.
+func (d *StoreDictPattern) RetrieveWithVersion(key string) (string, uint64, error) {
+	keyBytes := stringToBytes(key)
+	var version uint64
+
+	valuePtr, _, _ := d.retrieveVersion.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(unsafe.Pointer(&version)),
+	)
+
+	if valuePtr == 0 {
+		return "", 0, nil
+	}
+	return ptrToString(valuePtr), version, nil
+}
+
+// StoreIfVersion stores value only while key is still at expectedVersion (0
+// for absent). It reports whether it did, and the entry's version after.
+func (d *StoreDictPattern) StoreIfVersion(key, value string, expectedVersion uint64) (bool, uint64, error) {
+	keyBytes := stringToBytes(key)
+	valueBytes := stringToBytes(value)
+	var version uint64
+
+	result, _, err := d.storeIfVersion.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(unsafe.Pointer(&valueBytes[0])),
+		uintptr(expectedVersion),
+		uintptr(unsafe.Pointer(&version)),
+	)
+
+	return result&0xFF != 0, version, handleWindowsError(err)
+}
+
+// StoreMany stores several values under one acquisition of the dictionary lock
+// and returns how many were stored
+func (d *StoreDictPattern) StoreMany(items map[string]string) (int, error) {
+	if len(items) == 0 {
+		return 0, nil
+	}
+
+	// The pointer slices hide these from the collector, so they are kept
+	// alive explicitly until the call returns
+	keyBytes := make([][]byte, 0, len(items))
+	valueBytes := make([][]byte, 0, len(items))
+	keys := make([]uintptr, 0, len(items))
+	values := make([]uintptr, 0, len(items))
+	sizes := make([]uintptr, 0, len(items))
+	for key, value := range items {
+		k := stringToBytes(key)
+		v := stringToBytes(value)
+		keyBytes = append(keyBytes, k)
+		valueBytes = append(valueBytes, v)
+		keys = append(keys, uintptr(unsafe.Pointer(&k[0])))
+		values = append(values, uintptr(unsafe.Pointer(&v[0])))
+		sizes = append(sizes, uintptr(len(v)))
+	}
+
+	stored, _, err := d.storeMany.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keys[0])),
+		uintptr(unsafe.Pointer(&values[0])),
+		uintptr(unsafe.Pointer(&sizes[0])),
+		uintptr(len(keys)),
+	)
+	runtime.KeepAlive(keyBytes)
+	runtime.KeepAlive(valueBytes)
+
+	return int(stored), handleWindowsError(err)
+}
+
+// RetrieveMany looks up several keys under one acquisition of the dictionary
+// lock. Missing keys are left out of the result.
+func (d *StoreDictPattern) RetrieveMany(keys []string) (map[string]string, error) {
+	result := make(map[string]string, len(keys))
+	if len(keys) == 0 {
+		return result, nil
+	}
+
+	keyBytes := make([][]byte, len(keys))
+	keyPtrs := make([]uintptr, len(keys))
+	for i, key := range keys {
+		keyBytes[i] = stringToBytes(key)
+		keyPtrs[i] = uintptr(unsafe.Pointer(&keyBytes[i][0]))
+	}
+	values := make([]uintptr, len(keys))
+	sizes := make([]uintptr, len(keys))
+
+	_, _, err := d.retrieveMany.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyPtrs[0])),
+		uintptr(len(keys)),
+		uintptr(unsafe.Pointer(&values[0])),
+		uintptr(unsafe.Pointer(&sizes[0])),
+	)
+	runtime.KeepAlive(keyBytes)
+	if err = handleWindowsError(err); err != nil {
+		return nil, err
+	}
+
+	for i, key := range keys {
+		if values[i] != 0 {
+			data := unsafe.Slice((*byte)(unsafe.Pointer(values[i])), sizes[i])
+			if n := len(data); n > 0 && data[n-1] == 0 {
+				data = data[:n-1]
+			}
+			result[key] = string(data)
+		}
+	}
+
+	d.freeValues.Call(uintptr(unsafe.Pointer(&values[0])), uintptr(len(values)))
+	return result, nil
+}
+
+
+// CreateCounter makes key a 64-bit counter. More than one shard spreads adds
+// over per-core slots, for counters too hot for a single cache line.
+func (d *StoreDictPattern) CreateCounter(key string, initial int64, shards uint32) (bool, error) {
+	keyBytes := stringToBytes(key)
+
+	result, _, err := d.createCounter.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(initial),
+		uintptr(shards),
+	)
+
+	return result&0xFF != 0, handleWindowsError(err)
+}
+
+// AtomicAdd adds delta to a counter, creating it at 0 if missing, and
+// returns the new value
+func (d *StoreDictPattern) AtomicAdd(key string, delta int64) (int64, error) {
+	keyBytes := stringToBytes(key)
+	var value int64
+
+	result, _, _ := d.atomicAdd.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(delta),
+		uintptr(unsafe.Pointer(&value)),
+	)
+
+	if result&0xFF == 0 {
+		return 0, fmt.Errorf("key %q is not a counter", key)
+	}
+	return value, nil
+}
+
+// AtomicGet returns the current value of a counter
+func (d *StoreDictPattern) AtomicGet(key string) (int64, error) {
+	keyBytes := stringToBytes(key)
+	var value int64
+
+	result, _, _ := d.atomicGet.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(unsafe.Pointer(&value)),
+	)
+
+	if result&0xFF == 0 {
+		return 0, fmt.Errorf("key %q is not a counter", key)
+	}
+	return value, nil
+}
+
+// CompareExchange sets a plain counter to desired if it holds expected. It
+// reports whether it did, and the value it found.
+func (d *StoreDictPattern) CompareExchange(key string, expected, desired int64) (bool, int64, error) {
+	keyBytes := stringToBytes(key)
+	var actual int64
+
+	result, _, _ := d.compareExchange.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(expected),
+		uintptr(desired),
+		uintptr(unsafe.Pointer(&actual)),
+	)
+
+	if result&0xFF == 0 {
+		return false, 0, fmt.Errorf("key %q is not a plain counter", key)
+	}
+	return actual == expected, actual, nil
+}
+
+
+// Snapshot writes the whole dictionary to path in its native layout
+func (d *StoreDictPattern) Snapshot(path string) (bool, error) {
+	pathBytes := stringToBytes(path)
+
+	result, _, err := d.snapshot.Call(d.handle, uintptr(unsafe.Pointer(&pathBytes[0])))
+	return result&0xFF != 0, handleWindowsError(err)
+}
+
+// Restore replaces the dictionary with a file written by Snapshot, without
+// any per-key work
+func (d *StoreDictPattern) Restore(path string) (bool, error) {
+	pathBytes := stringToBytes(path)
+
+	result, _, err := d.restore.Call(d.handle, uintptr(unsafe.Pointer(&pathBytes[0])))
+	return result&0xFF != 0, handleWindowsError(err)
+}
+
+// StoreWithTTL stores a value that reads as absent once ttlMs milliseconds
+// have passed; 0 never expires
+func (d *StoreDictPattern) StoreWithTTL(key, value string, ttlMs uint64) (bool, error) {
+	keyBytes := stringToBytes(key)
+	valueBytes := stringToBytes(value)
+
+	result, _, err := d.storeWithTTL.Call(
+		d.handle,
+		uintptr(unsafe.Pointer(&keyBytes[0])),
+		uintptr(unsafe.Pointer(&valueBytes[0])),
+		uintptr(ttlMs),
+	)
+	return result&0xFF != 0, handleWindowsError(err)
+}
+
+// Sweep removes expired entries from the next maxBuckets buckets (0: all)
+// and returns how many went
+func (d *StoreDictPattern) Sweep(maxBuckets uint32) (int, error) {
+	removed, _, err := d.sweep.Call(d.handle, uintptr(maxBuckets))
+	return int(removed), handleWindowsError(err)
+}
+
+// ScanFunc visits one entry of an ordered scan; return false to stop
+type ScanFunc func(key, value string) bool
+
+// The DLL calls back through a single trampoline, which finds the Go
+// visitor for the running scan by the id passed as user data
+var (
+	scanOnce     sync.Once
+	scanCallback uintptr
+	scanMu       sync.Mutex
+	scanNextID   uintptr
+	scanVisitors = make(map[uintptr]ScanFunc)
+)
+
+func scanTrampoline(key, value, size, id uintptr) uintptr {
+	scanMu.Lock()
+	visit := scanVisitors[id]
+	scanMu.Unlock()
+
+	// Stored strings carry their terminator
+	data := unsafe.Slice((*byte)(unsafe.Pointer(value)), size)
+	if size > 0 && data[size-1] == 0 {
+		data = data[:size-1]
+	}
+	if visit(ptrToString(key), string(data)) {
+		return 1
+	}
+	return 0
+}
+
+func (d *StoreDictPattern) runScan(proc *syscall.Proc, visit ScanFunc, args ...uintptr) (int, error) {
+	scanOnce.Do(func() {
+		scanCallback = syscall.NewCallback(scanTrampoline)
+	})
+
+	scanMu.Lock()
+	scanNextID++
+	id := scanNextID
+	scanVisitors[id] = visit
+	scanMu.Unlock()
+
+	defer func() {
+		scanMu.Lock()
+		delete(scanVisitors, id)
+		scanMu.Unlock()
+	}()
+
+	args = append([]uintptr{d.handle}, args...)
+	visited, _, err := proc.Call(append(args, scanCallback, id)...)
+	return int(visited), handleWindowsError(err)
+}
+
+// ScanPrefix visits every key starting with prefix in key order
+func (d *StoreDictPattern) ScanPrefix(prefix string, visit ScanFunc) (int, error) {
+	prefixBytes := stringToBytes(prefix)
+	defer runtime.KeepAlive(prefixBytes)
+	return d.runScan(d.scanPrefix, visit, uintptr(unsafe.Pointer(&prefixBytes[0])))
+}
+
+// ScanRange visits keys in [start, end) in key order; an empty end runs
+// to the last key
+func (d *StoreDictPattern) ScanRange(start, end string, visit ScanFunc) (int, error) {
+	startBytes := stringToBytes(start)
+	defer runtime.KeepAlive(startBytes)
+	endPtr := uintptr(0)
+	if end != "" {
+		endBytes := stringToBytes(end)
+		endPtr = uintptr(unsafe.Pointer(&endBytes[0]))
+		defer runtime.KeepAlive(endBytes)
+	}
+	return d.runScan(d.scanRange, visit, uintptr(unsafe.Pointer(&startBytes[0])), endPtr)
+}
+
 func (d *StoreDictPattern) Close() error {
 	if d.handle != 0 {
 		_, _, err := d.close.Call(d.handle)
@@ -11,7 +11,8 @@ from ._cross_ipc import (
     ShmDispenserPattern,
     
     # Enums
-    ShmDispenserMode
+    ShmDispenserMode,
+    NumaPolicy
 )
 
 __version__ = "0.1.0"
\ No newline at end of file
@@ -1,6 +1,8 @@
 import ctypes
+import itertools
 import os
-from ctypes import c_char_p, c_size_t, c_bool, c_void_p, POINTER, c_ubyte, c_int, c_ulong
+import weakref
+from ctypes import c_char_p, c_size_t, c_bool, c_void_p, POINTER, c_ubyte, c_int, c_ulong, c_uint32
 
 
 _dll_path = os.path.join(os.path.dirname(__file__), "./cross-ipc.dll")
@@ -54,6 +56,41 @@ _lib.SharedMemory_create.restype = c_void_p
 _lib.SharedMemory_destroy.argtypes = [c_void_p]
 _lib.SharedMemory_destroy.restype = None
 
+_lib.SharedMemory_set_options_api.argtypes = [c_void_p, ctypes.c_uint]
+_lib.SharedMemory_set_options_api.restype = None
+
+class NumaPolicy:
+    DEFAULT = 0  # first process to touch a page places it
+    PREFERRED = 1  # prefer the given node
+    INTERLEAVE = 2  # spread pages over all nodes
+    CONSUMER = 3  # prefer the node of the process that sets up the segment
+
+
+class _NumaStats(ctypes.Structure):
+    _fields_ = [
+        ("node_count", c_int),
+        ("policy", c_int),
+        ("node", c_int),
+        ("applied", c_bool),
+        ("resident_node", c_int),
+        ("resident_nodes", c_int),
+    ]
+
+    def as_dict(self):
+        return {name: getattr(self, name) for name, _ in self._fields_}
+
+_lib.SharedMemory_set_numa_api.argtypes = [c_void_p, c_int, c_int]
+_lib.SharedMemory_set_numa_api.restype = None
+
+_lib.SharedMemory_get_numa_stats_api.argtypes = [c_void_p, POINTER(_NumaStats)]
+_lib.SharedMemory_get_numa_stats_api.restype = None
+
+_lib.SharedMemory_set_durability_api.argtypes = [c_void_p, c_int, c_ulong]
+_lib.SharedMemory_set_durability_api.restype = c_bool
+
+_lib.SharedMemory_applied_options_api.argtypes = [c_void_p]
+_lib.SharedMemory_applied_options_api.restype = ctypes.c_uint
+
 _lib.SharedMemory_setup_api.argtypes = [c_void_p]
 _lib.SharedMemory_setup_api.restype = c_bool
 
@@ -63,12 +100,46 @@ _lib.SharedMemory_write_api.restype = None
 _lib.SharedMemory_write_bytes_api.argtypes = [c_void_p, POINTER(c_ubyte), c_size_t]
 _lib.SharedMemory_write_bytes_api.restype = None
 
+
+class _IoVec(ctypes.Structure):
+    _fields_ = [("iov_base", c_void_p), ("iov_len", c_size_t)]
+
+_lib.SharedMemory_writev_api.argtypes = [c_void_p, POINTER(_IoVec), c_size_t]
+_lib.SharedMemory_writev_api.restype = c_bool
+
+_lib.SharedMemory_write_at_api.argtypes = [c_void_p, c_size_t, c_char_p, c_size_t]
+_lib.SharedMemory_write_at_api.restype = c_bool
+
+_lib.SharedMemory_read_at_api.argtypes = [c_void_p, c_size_t, c_void_p, c_size_t]
+_lib.SharedMemory_read_at_api.restype = c_bool
+
 _lib.SharedMemory_read_api.argtypes = [c_void_p]
 _lib.SharedMemory_read_api.restype = c_char_p
 
 _lib.SharedMemory_read_bytes_api.argtypes = [c_void_p, POINTER(c_size_t)]
 _lib.SharedMemory_read_bytes_api.restype = POINTER(c_ubyte)
 
+_lib.SharedMemory_write_versioned_api.argtypes = [c_void_p, POINTER(c_ubyte), c_size_t, POINTER(c_uint32)]
+_lib.SharedMemory_write_versioned_api.restype = c_bool
+
+_lib.SharedMemory_read_consistent_api.argtypes = [c_void_p, POINTER(c_size_t), POINTER(c_uint32)]
+_lib.SharedMemory_read_consistent_api.restype = POINTER(c_ubyte)
+
+_lib.SharedMemory_borrow_api.argtypes = [c_void_p, POINTER(c_size_t), POINTER(c_uint32)]
+_lib.SharedMemory_borrow_api.restype = c_void_p
+
+_lib.SharedMemory_validate_borrow_api.argtypes = [c_void_p, c_uint32]
+_lib.SharedMemory_validate_borrow_api.restype = c_bool
+
+_lib.SharedMemory_grow_api.argtypes = [c_void_p, c_size_t]
+_lib.SharedMemory_grow_api.restype = c_bool
+
+_lib.SharedMemory_get_sequence_api.argtypes = [c_void_p]
+_lib.SharedMemory_get_sequence_api.restype = c_uint32
+
+_lib.SharedMemory_wait_for_change_api.argtypes = [c_void_p, c_uint32, c_ulong, POINTER(c_uint32)]
+_lib.SharedMemory_wait_for_change_api.restype = c_bool
+
 _lib.SharedMemory_clear_api.argtypes = [c_void_p]
 _lib.SharedMemory_clear_api.restype = None
 
@@ -85,6 +156,12 @@ _lib.SharedMemory_lock_for_writing_api.restype = c_bool
 _lib.SharedMemory_unlock_from_writing_api.argtypes = [c_void_p]
 _lib.SharedMemory_unlock_from_writing_api.restype = c_bool
 
+_lib.SharedMemory_lock_for_reading_api.argtypes = [c_void_p, c_ulong]
+_lib.SharedMemory_lock_for_reading_api.restype = c_bool
+
+_lib.SharedMemory_unlock_from_reading_api.argtypes = [c_void_p]
+_lib.SharedMemory_unlock_from_reading_api.restype = c_bool
+
 # StoreDictPattern API
 _lib.StoreDictPattern_create.argtypes = [c_char_p, c_size_t, c_bool]
 _lib.StoreDictPattern_create.restype = c_void_p
@@ -92,6 +169,9 @@ _lib.StoreDictPattern_create.restype = c_void_p
 _lib.StoreDictPattern_destroy.argtypes = [c_void_p]
 _lib.StoreDictPattern_destroy.restype = None
 
+_lib.StoreDictPattern_set_mode_api.argtypes = [c_void_p, c_int]
+_lib.StoreDictPattern_set_mode_api.restype = c_bool
+
 _lib.StoreDictPattern_setup_api.argtypes = [c_void_p]
 _lib.StoreDictPattern_setup_api.restype = c_bool
 
@@ -101,12 +181,119 @@ _lib.StoreDictPattern_store_string_api.restype = None
 _lib.StoreDictPattern_retrieve_string_api.argtypes = [c_void_p, c_char_p]
 _lib.StoreDictPattern_retrieve_string_api.restype = c_char_p
 
+_lib.StoreDictPattern_resolve_api.argtypes = [c_void_p, c_char_p]
+_lib.StoreDictPattern_resolve_api.restype = c_void_p
+
+_lib.StoreDictPattern_store_string_resolved_api.argtypes = [c_void_p, c_void_p, c_char_p]
+_lib.StoreDictPattern_store_string_resolved_api.restype = c_bool
+
+_lib.StoreDictPattern_retrieve_string_resolved_api.argtypes = [c_void_p, c_void_p]
+_lib.StoreDictPattern_retrieve_string_resolved_api.restype = c_char_p
+
+_lib.StoreDictPattern_retrieve_string_with_version_api.argtypes = [c_void_p, c_char_p, POINTER(ctypes.c_uint64)]
+_lib.StoreDictPattern_retrieve_string_with_version_api.restype = c_char_p
+
+_lib.StoreDictPattern_store_string_if_version_api.argtypes = [c_void_p, c_char_p, c_char_p, ctypes.c_uint64, POINTER(ctypes.c_uint64)]
+_lib.StoreDictPattern_store_string_if_version_api.restype = c_bool
+
+_lib.StoreDictPattern_store_many_api.argtypes = [c_void_p, POINTER(c_char_p), POINTER(c_char_p), POINTER(c_size_t), c_size_t]
+_lib.StoreDictPattern_store_many_api.restype = c_size_t
+
+_lib.StoreDictPattern_retrieve_many_api.argtypes = [c_void_p, POINTER(c_char_p), c_size_t, POINTER(c_void_p), POINTER(c_size_t)]
+_lib.StoreDictPattern_retrieve_many_api.restype = c_size_t
+
+_lib.StoreDictPattern_free_values_api.argtypes = [POINTER(c_void_p), c_size_t]
+_lib.StoreDictPattern_free_values_api.restype = None
+
 _lib.StoreDictPattern_close_api.argtypes = [c_void_p]
 _lib.StoreDictPattern_close_api.restype = None
 
 _lib.StoreDictPattern_load_api.argtypes = [c_void_p]
 _lib.StoreDictPattern_load_api.restype = None
 
+_lib.StoreDictPattern_refresh_if_changed_api.argtypes = [c_void_p]
+_lib.StoreDictPattern_refresh_if_changed_api.restype = c_bool
+
+_lib.StoreDictPattern_create_counter_api.argtypes = [c_void_p, c_char_p, ctypes.c_int64, c_uint32]
+_lib.StoreDictPattern_create_counter_api.restype = c_bool
+
+_lib.StoreDictPattern_atomic_add_api.argtypes = [c_void_p, c_char_p, ctypes.c_int64, POINTER(ctypes.c_int64)]
+_lib.StoreDictPattern_atomic_add_api.restype = c_bool
+
+_lib.StoreDictPattern_atomic_get_api.argtypes = [c_void_p, c_char_p, POINTER(ctypes.c_int64)]
+_lib.StoreDictPattern_atomic_get_api.restype = c_bool
+
+_lib.StoreDictPattern_compare_exchange_api.argtypes = [c_void_p, c_char_p, ctypes.c_int64, ctypes.c_int64, POINTER(ctypes.c_int64)]
+_lib.StoreDictPattern_compare_exchange_api.restype = c_bool
+
+_lib.StoreDictPattern_snapshot_api.argtypes = [c_void_p, c_char_p]
+_lib.StoreDictPattern_snapshot_api.restype = c_bool
+
+_lib.StoreDictPattern_restore_api.argtypes = [c_void_p, c_char_p]
+_lib.StoreDictPattern_restore_api.restype = c_bool
+
+# bool visit(key, value, value_size, user_data); returning False stops the scan
+SCAN_VISIT_CALLBACK = ctypes.CFUNCTYPE(c_bool, c_char_p, c_void_p, c_size_t, c_void_p)
+
+_lib.StoreDictPattern_set_capacity_api.argtypes = [c_void_p, ctypes.c_uint64]
+_lib.StoreDictPattern_set_capacity_api.restype = c_bool
+
+_lib.StoreDictPattern_store_string_with_ttl_api.argtypes = [c_void_p, c_char_p, c_char_p, ctypes.c_uint64]
+_lib.StoreDictPattern_store_string_with_ttl_api.restype = c_bool
+
+_lib.StoreDictPattern_sweep_api.argtypes = [c_void_p, c_uint32]
+_lib.StoreDictPattern_sweep_api.restype = c_size_t
+
+_lib.StoreDictPattern_set_ordered_api.argtypes = [c_void_p, c_bool]
+_lib.StoreDictPattern_set_ordered_api.restype = c_bool
+
+_lib.StoreDictPattern_scan_prefix_api.argtypes = [c_void_p, c_char_p, SCAN_VISIT_CALLBACK, c_void_p]
+_lib.StoreDictPattern_scan_prefix_api.restype = c_size_t
+
+_lib.StoreDictPattern_scan_range_api.argtypes = [c_void_p, c_char_p, c_char_p, SCAN_VISIT_CALLBACK, c_void_p]
+_lib.StoreDictPattern_scan_range_api.restype = c_size_t
+
+_lib.StoreDictPattern_compact_api.argtypes = [c_void_p]
+_lib.StoreDictPattern_compact_api.restype = c_bool
+
+
+class _ArenaStats(ctypes.Structure):
+    _fields_ = [
+        ("capacity", ctypes.c_uint64),
+        ("used", ctypes.c_uint64),
+        ("allocated", ctypes.c_uint64),
+        ("requested", ctypes.c_uint64),
+        ("free", ctypes.c_uint64),
+        ("largest_free", ctypes.c_uint64),
+        ("allocations", ctypes.c_uint64),
+        ("slabs", ctypes.c_uint32),
+        ("utilization", ctypes.c_double),
+        ("fragmentation", ctypes.c_double),
+    ]
+
+    def as_dict(self):
+        return {name: getattr(self, name) for name, _ in self._fields_}
+
+_lib.StoreDictPattern_arena_stats_api.argtypes = [c_void_p, POINTER(_ArenaStats)]
+_lib.StoreDictPattern_arena_stats_api.restype = c_bool
+
+
+class _CacheStats(ctypes.Structure):
+    _fields_ = [
+        ("capacity", ctypes.c_uint64),
+        ("used", ctypes.c_uint64),
+        ("entries", ctypes.c_uint64),
+        ("expiring", ctypes.c_uint64),
+        ("expirations", ctypes.c_uint64),
+        ("evictions", ctypes.c_uint64),
+    ]
+
+    def as_dict(self):
+        return {name: getattr(self, name) for name, _ in self._fields_}
+
+_lib.StoreDictPattern_cache_stats_api.argtypes = [c_void_p, POINTER(_CacheStats)]
+_lib.StoreDictPattern_cache_stats_api.restype = c_bool
+
 
 # Define the callback function type
 REQUEST_HANDLER_CALLBACK = ctypes.CFUNCTYPE(c_char_p, c_char_p, c_void_p)
@@ -126,6 +313,12 @@ _lib.ReqRespPattern_setup_client_api.restype = c_bool
 _lib.ReqRespPattern_request_api.argtypes = [c_void_p, c_char_p, c_char_p]
 _lib.ReqRespPattern_request_api.restype = c_char_p
 
+_lib.ReqRespPattern_resolve_api.argtypes = [c_void_p, c_char_p]
+_lib.ReqRespPattern_resolve_api.restype = c_int
+
+_lib.ReqRespPattern_request_resolved_api.argtypes = [c_void_p, c_int, c_char_p]
+_lib.ReqRespPattern_request_resolved_api.restype = c_char_p
+
 _lib.ReqRespPattern_respond_api.argtypes = [c_void_p, c_char_p, REQUEST_HANDLER_CALLBACK, c_void_p]
 _lib.ReqRespPattern_respond_api.restype = None
 
@@ -148,6 +341,12 @@ _lib.PubSubPattern_setup_api.restype = c_bool
 _lib.PubSubPattern_publish_string_api.argtypes = [c_void_p, c_char_p, c_char_p]
 _lib.PubSubPattern_publish_string_api.restype = None
 
+_lib.PubSubPattern_resolve_topic_api.argtypes = [c_void_p, c_char_p]
+_lib.PubSubPattern_resolve_topic_api.restype = c_void_p
+
+_lib.PubSubPattern_publish_string_resolved_api.argtypes = [c_void_p, c_void_p, c_char_p]
+_lib.PubSubPattern_publish_string_resolved_api.restype = c_bool
+
 _lib.PubSubPattern_subscribe_api.argtypes = [c_void_p, c_char_p, MESSAGE_HANDLER_CALLBACK, c_void_p]
 _lib.PubSubPattern_subscribe_api.restype = None
 
@@ -167,6 +366,12 @@ _lib.ShmDispenserPattern_create.restype = c_void_p
 _lib.ShmDispenserPattern_destroy.argtypes = [c_void_p]
 _lib.ShmDispenserPattern_destroy.restype = None
 
+_lib.ShmDispenserPattern_set_numa_api.argtypes = [c_void_p, c_int, c_int]
+_lib.ShmDispenserPattern_set_numa_api.restype = None
+
+_lib.ShmDispenserPattern_get_numa_stats_api.argtypes = [c_void_p, POINTER(_NumaStats)]
+_lib.ShmDispenserPattern_get_numa_stats_api.restype = None
+
 _lib.ShmDispenserPattern_setup_api.argtypes = [c_void_p, c_size_t, c_size_t]
 _lib.ShmDispenserPattern_setup_api.restype = c_bool
 
@@ -275,24 +480,83 @@ class OrdinaryPipe:
 
 class SharedMemory:
     
-    def __init__(self, id, size, verbose=False):
+    # Setup options (see SharedMemoryOption in shared_memory.h)
+    PERSISTENT = 0x1
+    PREFAULT = 0x2
+    HUGE_PAGES = 0x4
+    LOCK_PAGES = 0x8
+    TRIPLE_BUFFER = 0x10  # write_bytes publishes snapshots, read_bytes returns the newest
+    GROWABLE = 0x20  # writes that do not fit grow the segment
+    
+    # Durability policies for PERSISTENT segments
+    DURABILITY_NONE = 0  # leave write-back to the OS
+    DURABILITY_PERIODIC = 1  # background thread flushes dirty pages every interval
+    DURABILITY_SYNC = 2  # every write flushes before returning (default)
+    
+    def __init__(self, id, size, verbose=False, options=0):
+        # Views handed out by borrow() that are still referenced, keyed by a
+        # serial number; close() and grow() refuse to unmap under them
+        self._borrows = {}
+        self._borrow_ids = itertools.count()
         self._handle = _lib.SharedMemory_create(id.encode('utf-8'), size, verbose)
         if not self._handle:
             raise RuntimeError("Failed to create SharedMemory")
+        if options:
+            _lib.SharedMemory_set_options_api(self._handle, options)
     
     def setup(self):
         
         return _lib.SharedMemory_setup_api(self._handle)
     
+    def set_durability(self, durability, interval_ms=0):
+        """Choose when writes reach the backing file; interval_ms=0 uses the default"""
+        return _lib.SharedMemory_set_durability_api(self._handle, durability, interval_ms)
+    
+    def set_numa(self, policy, node=0):
+        """Choose NUMA placement (a NumaPolicy value); call before setup"""
+        _lib.SharedMemory_set_numa_api(self._handle, policy, node)
+    
+    def numa_stats(self):
+        """Node count, requested policy and the node the pages ended up on"""
+        stats = _NumaStats()
+        _lib.SharedMemory_get_numa_stats_api(self._handle, ctypes.byref(stats))
+        return stats.as_dict()
+    
+    def applied_options(self):
+        """Option flags that actually took effect during setup"""
+        return _lib.SharedMemory_applied_options_api(self._handle)
+    
     def write(self, data):
         """Write a string to shared memory"""
         _lib.SharedMemory_write_api(self._handle, data.encode('utf-8'))
     
     def write_bytes(self, data):
-        """Write bytes to shared memory"""
+        """Write bytes to shared memory as they are; read_bytes expects them to start
+        with a 4-byte length unless the segment is TRIPLE_BUFFER"""
         data_array = (c_ubyte * len(data))(*data)
         _lib.SharedMemory_write_bytes_api(self._handle, data_array, len(data))
     
+    def writev(self, fragments):
+        """Write several bytes objects back to back without joining them first"""
+        fragments = [bytes(fragment) for fragment in fragments]
+        iov = (_IoVec * len(fragments))()
+        for i, fragment in enumerate(fragments):
+            iov[i].iov_base = ctypes.cast(c_char_p(fragment), c_void_p).value
+            iov[i].iov_len = len(fragment)
+        return _lib.SharedMemory_writev_api(self._handle, iov, len(fragments))
+    
+    def write_at(self, offset, data):
+        """Overwrite len(data) bytes starting at offset, leaving the rest untouched"""
+        data = bytes(data)
+        return _lib.SharedMemory_write_at_api(self._handle, offset, data, len(data))
+    
+    def read_at(self, offset, length):
+        """Read length bytes starting at offset, or None if the range is invalid"""
+        buffer = ctypes.create_string_buffer(length)
+        if not _lib.SharedMemory_read_at_api(self._handle, offset, buffer, length):
+            return None
+        return buffer.raw
+    
     def read(self):
         
         result = _lib.SharedMemory_read_api(self._handle)
@@ -309,12 +573,82 @@ class SharedMemory:
             return bytes(result[:size.value])
         return None
     
+    def write_versioned(self, data):
+        """Write length-prefixed bytes under the segment seqlock and return the new sequence"""
+        data_array = (c_ubyte * len(data)).from_buffer_copy(data)
+        sequence = c_uint32()
+        if _lib.SharedMemory_write_versioned_api(self._handle, data_array, len(data), ctypes.byref(sequence)):
+            return sequence.value
+        return None
+    
+    def read_consistent(self):
+        """Read the payload without locking; returns (bytes, sequence) or None"""
+        size = c_size_t()
+        sequence = c_uint32()
+        result = _lib.SharedMemory_read_consistent_api(self._handle, ctypes.byref(size), ctypes.byref(sequence))
+        if result:
+            return bytes(result[:size.value]), sequence.value
+        return None
+    
+    def borrow(self):
+        """Return (memoryview, generation) over the payload without copying it.
+        
+        The view points straight into the mapping; check is_borrow_valid(generation)
+        after using it to make sure no writer changed the data underneath.
+        
+        The memory behind the view goes away when the mapping does: on close(),
+        on grow(), and when a write to a GROWABLE segment or another process's
+        grow makes this handle remap. Touching the view after that crashes the
+        interpreter rather than raising, and is_borrow_valid cannot tell. Copy
+        out what you need and release() the view (or drop every reference to it
+        and its slices) before anything that may remap; close() and grow()
+        raise BufferError while views are still alive.
+        """
+        size = c_size_t()
+        generation = c_uint32()
+        address = _lib.SharedMemory_borrow_api(self._handle, ctypes.byref(size), ctypes.byref(generation))
+        if not address:
+            return None
+        array = (c_ubyte * size.value).from_address(address)
+        # The mapping must outlive the view, so the view keeps this handle alive
+        array._owner = self
+        key = next(self._borrow_ids)
+        self._borrows[key] = weakref.ref(array, lambda _, key=key, borrows=self._borrows: borrows.pop(key, None))
+        view = memoryview(array).cast('B').toreadonly()
+        return view, generation.value
+    
+    def _check_no_borrows(self, action):
+        if self._borrows:
+            raise BufferError("cannot %s while %d borrowed view(s) are alive; release them first"
+                              % (action, len(self._borrows)))
+    
+    def is_borrow_valid(self, generation):
+        
+        return _lib.SharedMemory_validate_borrow_api(self._handle, generation)
+    
+    def grow(self, new_size):
+        """Grow the data region; other processes remap on their next access"""
+        self._check_no_borrows("grow")
+        return _lib.SharedMemory_grow_api(self._handle, new_size)
+    
+    def sequence(self):
+        """Current write sequence, a starting point for wait_for_change"""
+        return _lib.SharedMemory_get_sequence_api(self._handle)
+    
+    def wait_for_change(self, last_sequence, timeout_ms=5000):
+        """Block until a write completes after last_sequence; returns the new sequence or None on timeout"""
+        sequence = c_uint32()
+        if _lib.SharedMemory_wait_for_change_api(self._handle, last_sequence, timeout_ms, ctypes.byref(sequence)):
+            return sequence.value
+        return None
+    
     def clear(self):
         """Clear the shared memory"""
         _lib.SharedMemory_clear_api(self._handle)
     
     def close(self):
         """Close the shared memory resources"""
+        self._check_no_borrows("close")
         _lib.SharedMemory_close_api(self._handle)
     
     def unlink(self):
@@ -329,6 +663,23 @@ class SharedMemory:
         
         return _lib.SharedMemory_unlock_from_writing_api(self._handle)
     
+    def lock_for_reading(self, timeout_ms=5000):
+        """Take a shared read lock; readers only wait for writers"""
+        return _lib.SharedMemory_lock_for_reading_api(self._handle, timeout_ms)
+    
+    def unlock_from_reading(self):
+        
+        return _lib.SharedMemory_unlock_from_reading_api(self._handle)
+    
+    def read_bytes_with_lock(self, timeout_ms=5000):
+        
+        if self.lock_for_reading(timeout_ms):
+            try:
+                return self.read_bytes()
+            finally:
+                self.unlock_from_reading()
+        return None
+    
     def write_with_lock(self, data, timeout_ms=5000):
         
         if self.lock_for_writing(timeout_ms):
@@ -357,11 +708,22 @@ class SharedMemory:
 
 class StoreDictPattern:
     
-    def __init__(self, name, size=1024, verbose=False):
+    # Storage layouts for a new segment; attaching handles follow the existing one
+    MODE_TABLE = 0  # records updated in place in a shared hash table
+    MODE_LOG = 1  # records appended to a log, compacted in the background
+    
+    def __init__(self, name, size=1024, verbose=False, mode=MODE_TABLE, ordered=False, capacity=0):
         self._handle = _lib.StoreDictPattern_create(
             name.encode('utf-8'), size, verbose)
         if not self._handle:
             raise RuntimeError("Failed to create StoreDictPattern")
+        if mode:
+            _lib.StoreDictPattern_set_mode_api(self._handle, mode)
+        if ordered:
+            _lib.StoreDictPattern_set_ordered_api(self._handle, True)
+        if capacity:
+            # Bounded: writes evict least recently used entries instead of failing
+            _lib.StoreDictPattern_set_capacity_api(self._handle, capacity)
     
     def setup(self):
         
@@ -372,9 +734,14 @@ class StoreDictPattern:
         _lib.StoreDictPattern_store_string_api(
             self._handle, key.encode('utf-8'), value.encode('utf-8'))
     
+    def store_with_ttl(self, key, value, ttl_ms):
+        """Store a string value that reads as absent once ttl_ms has passed"""
+        return _lib.StoreDictPattern_store_string_with_ttl_api(
+            self._handle, key.encode('utf-8'), value.encode('utf-8'), ttl_ms)
+    
     def retrieve(self, key):
         """Retrieve a string value for the given key"""
-        # First load the latest data from shared memory
+        # Only does work when another process has changed the dictionary
         self.load()
         
         result = _lib.StoreDictPattern_retrieve_string_api(
@@ -383,10 +750,165 @@ class StoreDictPattern:
             return result.decode('utf-8')
         return None
     
+    def resolve(self, key):
+        """Handle for key that store_resolved/retrieve_resolved take without rehashing it"""
+        handle = _lib.StoreDictPattern_resolve_api(self._handle, key.encode('utf-8'))
+        if not handle:
+            raise RuntimeError(f"Failed to resolve key '{key}'")
+        return handle
+    
+    def store_resolved(self, handle, value):
+        return _lib.StoreDictPattern_store_string_resolved_api(
+            self._handle, handle, value.encode('utf-8'))
+    
+    def retrieve_resolved(self, handle):
+        result = _lib.StoreDictPattern_retrieve_string_resolved_api(self._handle, handle)
+        if result:
+            return result.decode('utf-8')
+        return None
+    
+    def retrieve_with_version(self, key):
+        """Value and entry version of `key`, or (None, 0) if it is absent"""
+        version = ctypes.c_uint64()
+        result = _lib.StoreDictPattern_retrieve_string_with_version_api(
+            self._handle, key.encode('utf-8'), ctypes.byref(version))
+        if result:
+            return result.decode('utf-8'), version.value
+        return None, 0
+    
+    def store_if_version(self, key, value, expected_version):
+        """Store only if `key` is still at `expected_version` (0: absent); returns (stored, current version)"""
+        version = ctypes.c_uint64()
+        stored = _lib.StoreDictPattern_store_string_if_version_api(
+            self._handle, key.encode('utf-8'), value.encode('utf-8'), expected_version, ctypes.byref(version))
+        return stored, version.value
+    
+    def store_many(self, items):
+        """Store several string values at once; returns how many were stored"""
+        items = list(items.items() if isinstance(items, dict) else items)
+        count = len(items)
+        if count == 0:
+            return 0
+        keys = (c_char_p * count)(*[key.encode('utf-8') for key, _ in items])
+        values = [value.encode('utf-8') + b'\0' for _, value in items]
+        sizes = (c_size_t * count)(*[len(value) for value in values])
+        return _lib.StoreDictPattern_store_many_api(
+            self._handle, keys, (c_char_p * count)(*values), sizes, count)
+    
+    def retrieve_many(self, keys):
+        """Retrieve several string values at once, as a dict with None for missing keys"""
+        keys = list(keys)
+        count = len(keys)
+        if count == 0:
+            return {}
+        self.load()
+        
+        key_array = (c_char_p * count)(*[key.encode('utf-8') for key in keys])
+        values = (c_void_p * count)()
+        sizes = (c_size_t * count)()
+        _lib.StoreDictPattern_retrieve_many_api(self._handle, key_array, count, values, sizes)
+        
+        result = {}
+        for i, key in enumerate(keys):
+            if values[i]:
+                data = ctypes.string_at(values[i], sizes[i])
+                result[key] = data.rstrip(b'\0').decode('utf-8')
+            else:
+                result[key] = None
+        _lib.StoreDictPattern_free_values_api(values, count)
+        return result
+    
+    def create_counter(self, key, initial=0, shards=1):
+        """Make `key` a 64-bit counter; shards > 1 spreads adds over per-core slots"""
+        return _lib.StoreDictPattern_create_counter_api(self._handle, key.encode('utf-8'), initial, shards)
+    
+    def atomic_add(self, key, delta=1):
+        """Add to a counter, creating it at 0 if missing; returns the new value or None"""
+        value = ctypes.c_int64()
+        if not _lib.StoreDictPattern_atomic_add_api(self._handle, key.encode('utf-8'), delta, ctypes.byref(value)):
+            return None
+        return value.value
+    
+    def atomic_get(self, key):
+        """Current value of a counter, or None if `key` is not one"""
+        value = ctypes.c_int64()
+        if not _lib.StoreDictPattern_atomic_get_api(self._handle, key.encode('utf-8'), ctypes.byref(value)):
+            return None
+        return value.value
+    
+    def compare_exchange(self, key, expected, desired):
+        """Set a counter to `desired` if it holds `expected`; returns (swapped, value found)"""
+        actual = ctypes.c_int64()
+        if not _lib.StoreDictPattern_compare_exchange_api(
+                self._handle, key.encode('utf-8'), expected, desired, ctypes.byref(actual)):
+            return False, None
+        return actual.value == expected, actual.value
+    
     def load(self):
         
         _lib.StoreDictPattern_load_api(self._handle)
     
+    def refresh_if_changed(self):
+        """True if the dictionary changed since this handle last looked"""
+        return _lib.StoreDictPattern_refresh_if_changed_api(self._handle)
+    
+    def snapshot(self, path):
+        """Write the whole dictionary to `path` in its native layout"""
+        return _lib.StoreDictPattern_snapshot_api(self._handle, os.fsencode(path))
+    
+    def restore(self, path):
+        """Replace the dictionary with a snapshot written by snapshot()"""
+        return _lib.StoreDictPattern_restore_api(self._handle, os.fsencode(path))
+    
+    def _scan(self, run, limit):
+        items = []
+        
+        def visit(key, value, size, user_data):
+            data = ctypes.string_at(value, size) if size else b''
+            # Stored strings carry their terminator
+            if data.endswith(b'\0'):
+                data = data[:-1]
+            items.append((key.decode('utf-8'), data.decode('utf-8')))
+            return limit is None or len(items) < limit
+        
+        run(SCAN_VISIT_CALLBACK(visit))
+        return items
+    
+    def scan_prefix(self, prefix, limit=None):
+        """(key, value) pairs whose key starts with `prefix`, in key order"""
+        encoded = prefix.encode('utf-8')
+        return self._scan(lambda visit: _lib.StoreDictPattern_scan_prefix_api(
+            self._handle, encoded, visit, None), limit)
+    
+    def scan_range(self, start, end=None, limit=None):
+        """(key, value) pairs with start <= key < end in key order; no end runs to the last key"""
+        encoded_start = start.encode('utf-8')
+        encoded_end = end.encode('utf-8') if end else None
+        return self._scan(lambda visit: _lib.StoreDictPattern_scan_range_api(
+            self._handle, encoded_start, encoded_end, visit, None), limit)
+    
+    def compact(self):
+        """Reclaim space held by replaced and removed entries now"""
+        return _lib.StoreDictPattern_compact_api(self._handle)
+    
+    def sweep(self, max_buckets=0):
+        """Remove expired entries from the next max_buckets buckets (0: all); returns how many"""
+        return _lib.StoreDictPattern_sweep_api(self._handle, max_buckets)
+    
+    def cache_stats(self):
+        """Expiry and eviction counters, or None in log mode"""
+        stats = _CacheStats()
+        if not _lib.StoreDictPattern_cache_stats_api(self._handle, ctypes.byref(stats)):
+            return None
+        return stats.as_dict()
+    
+    def arena_stats(self):
+        """Space held by the in-segment allocator, or None in log mode"""
+        stats = _ArenaStats()
+        if not _lib.StoreDictPattern_arena_stats_api(self._handle, ctypes.byref(stats)):
+            return None
+        return stats.as_dict()
+    
     def close(self):
         
         _lib.StoreDictPattern_close_api(self._handle)
@@ -421,6 +943,17 @@ class ReqRespPattern:
             return result.decode('utf-8')
         return None
     
+    def resolve(self, id):
+        """Pipe handle for request_resolved, or -1 if id was never set up"""
+        return _lib.ReqRespPattern_resolve_api(self._handle, id.encode('utf-8'))
+    
+    def request_resolved(self, pipe, message):
+        result = _lib.ReqRespPattern_request_resolved_api(
+            self._handle, pipe, message.encode('utf-8'))
+        if result:
+            return result.decode('utf-8')
+        return None
+    
     def respond(self, id, handler, user_data=None):
         
         # Create a wrapper function that handles string encoding/decoding
@@ -481,6 +1014,17 @@ class PubSubPattern:
         _lib.PubSubPattern_publish_string_api(
             self._handle, topic.encode('utf-8'), message.encode('utf-8'))
     
+    def resolve_topic(self, topic):
+        """Handle for topic that publish_resolved takes without rehashing it"""
+        handle = _lib.PubSubPattern_resolve_topic_api(self._handle, topic.encode('utf-8'))
+        if not handle:
+            raise RuntimeError(f"Failed to resolve topic '{topic}'")
+        return handle
+    
+    def publish_resolved(self, topic_handle, message):
+        return _lib.PubSubPattern_publish_string_resolved_api(
+            self._handle, topic_handle, message.encode('utf-8'))
+    
     def subscribe(self, topic, handler, user_data=None):
         
         
@@ -526,6 +1070,16 @@ class ShmDispenserPattern:
         if not self._handle:
             raise RuntimeError("Failed to create ShmDispenserPattern")
     
+    def set_numa(self, policy, node=0):
+        """Choose NUMA placement (a NumaPolicy value); call before setup"""
+        _lib.ShmDispenserPattern_set_numa_api(self._handle, policy, node)
+    
+    def numa_stats(self):
+        """Node count, requested policy and the node the pages ended up on"""
+        stats = _NumaStats()
+        _lib.ShmDispenserPattern_get_numa_stats_api(self._handle, ctypes.byref(stats))
+        return stats.as_dict()
+    
     def setup(self, capacity, item_size):
         """Initialize the shared memory and prepare for use"""
         return _lib.ShmDispenserPattern_setup_api(self._handle, capacity, item_size)
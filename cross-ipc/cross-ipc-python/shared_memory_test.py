@@ -2,6 +2,7 @@
 import time
 import sys
 import os
+import threading
 from cross_ipc import SharedMemory
 
 def writer_mode():
@@ -73,17 +74,226 @@ def reader_mode():
     shm.close()
     print("Reader closed")
 
+def pattern(sequence, size):
+    """Payload whose every byte depends on `sequence`, so a torn copy shows"""
+    return bytes([sequence % 251]) * size
+
+
+def check_seqlock():
+    shm = SharedMemory("SyncTestSeqlock", 64 * 1024)
+    assert shm.setup()
+    reader_shm = SharedMemory("SyncTestSeqlock", 64 * 1024)
+    assert reader_shm.setup()
+
+    sequence = shm.write_versioned(pattern(1, 1000))
+    data, read_sequence = reader_shm.read_consistent()
+    assert data == pattern(1, 1000) and read_sequence == sequence
+
+    # Readers racing a writer never see a mix of two payloads
+    done = threading.Event()
+    torn = []
+    reads = [0]
+
+    def reader():
+        handle = SharedMemory("SyncTestSeqlock", 64 * 1024)
+        handle.setup()
+        while not done.is_set():
+            result = handle.read_consistent()
+            if result:
+                payload = result[0]
+                reads[0] += 1
+                if payload != payload[:1] * len(payload):
+                    torn.append(len(payload))
+        handle.close()
+
+    threads = [threading.Thread(target=reader) for _ in range(4)]
+    for thread in threads:
+        thread.start()
+    for i in range(20000):
+        shm.write_versioned(pattern(i, 100 + (i * 37) % 30000))
+    done.set()
+    for thread in threads:
+        thread.join()
+    assert not torn, torn[:5]
+
+    reader_shm.close()
+    shm.close()
+    print(f"Seqlock: {reads[0]} concurrent reads, none torn")
+
+
+def check_borrow():
+    shm = SharedMemory("SyncTestBorrow", 64 * 1024)
+    assert shm.setup()
+    reader_shm = SharedMemory("SyncTestBorrow", 64 * 1024)
+    assert reader_shm.setup()
+    shm.write_versioned(pattern(1, 1000))
+
+    # A borrowed view is valid until the next write, and the handle refuses
+    # to unmap underneath it
+    view, generation = reader_shm.borrow()
+    assert bytes(view[4:8]) == pattern(1, 4)
+    assert reader_shm.is_borrow_valid(generation)
+    try:
+        reader_shm.grow(128 * 1024)
+        assert False, "grow() must refuse while a view is alive"
+    except BufferError:
+        pass
+    shm.write_versioned(pattern(2, 1000))
+    assert not reader_shm.is_borrow_valid(generation)
+    view.release()
+    del view
+
+    reader_shm.close()
+    shm.close()
+    print("Borrow: views invalidated by writes, unmapping refused while held")
+
+
+def check_wait_for_change():
+    shm = SharedMemory("SyncTestWait", 4096)
+    assert shm.setup()
+    start = shm.sequence()
+
+    # A waiter with nothing to wake it times out
+    began = time.monotonic()
+    assert shm.wait_for_change(start, 100) is None
+    assert time.monotonic() - began >= 0.09
+
+    woken = []
+
+    def waiter():
+        woken.append(shm.wait_for_change(start, 5000))
+
+    thread = threading.Thread(target=waiter)
+    thread.start()
+    time.sleep(0.1)
+    shm.write("changed")
+    thread.join()
+    assert woken[0] is not None and woken[0] != start
+
+    shm.close()
+    print("wait_for_change: times out when idle, wakes on a write")
+
+
+def check_grow_across_handles():
+    options = SharedMemory.GROWABLE
+    grower = SharedMemory("SyncTestGrow", 256, options=options)
+    assert grower.setup()
+    follower = SharedMemory("SyncTestGrow", 256, options=options)
+    assert follower.setup()
+
+    grower.write_versioned(b"small")
+    assert follower.read_consistent()[0] == b"small"
+
+    # Writes that do not fit grow the segment; the other handle remaps on
+    # its next access and sees the whole payload
+    big = bytes(range(256)) * 4096
+    grower.write_versioned(big)
+    assert follower.read_consistent()[0] == big
+
+    assert follower.grow(4 * 1024 * 1024)
+    big = big * 2
+    follower.write_versioned(big)
+    assert grower.read_consistent()[0] == big
+
+    # A ranged write past the end grows too, and keeps what was there
+    assert grower.write_at(6 * 1024 * 1024, b"tail")
+    assert follower.read_at(6 * 1024 * 1024, 4) == b"tail"
+    assert follower.read_at(4, 16) == big[:16]
+
+    follower.close()
+    grower.close()
+    print("Grow: other handles remap and see grown contents")
+
+
+def check_grow_shared_handle():
+    shm = SharedMemory("SyncTestGrowShared", 4096, options=SharedMemory.GROWABLE)
+    assert shm.setup()
+    shm.write_versioned(pattern(1, 1000))
+
+    # Readers on the same handle as the writer: each of its grows remaps the
+    # view they read from, and must wait for the reads in flight
+    done = threading.Event()
+    torn = []
+
+    def reader():
+        while not done.is_set():
+            result = shm.read_consistent()
+            if result is None:
+                torn.append(None)
+            elif result[0] != result[0][:1] * len(result[0]):
+                torn.append(len(result[0]))
+            shm.sequence()
+
+    threads = [threading.Thread(target=reader) for _ in range(4)]
+    for thread in threads:
+        thread.start()
+    for i in range(200):
+        assert shm.write_versioned(pattern(i, 1000 + i * 9000)) is not None
+    done.set()
+    for thread in threads:
+        thread.join()
+    assert not torn, torn[:5]
+
+    shm.close()
+    print("Grow: threads sharing the growing handle keep reading whole payloads")
+
+
+def check_triple_buffer():
+    options = SharedMemory.TRIPLE_BUFFER
+    writer = SharedMemory("SyncTestTriple", 3 * 1024, options=options)
+    assert writer.setup()
+    reader_shm = SharedMemory("SyncTestTriple", 3 * 1024, options=options)
+    assert reader_shm.setup()
+
+    # Snapshots come back exactly as written, whichever call wrote them
+    writer.write_bytes(pattern(1, 100))
+    assert reader_shm.read_bytes() == pattern(1, 100)
+    writer.writev([b"head", pattern(2, 50)])
+    assert reader_shm.read_bytes() == b"head" + pattern(2, 50)
+    sequence = writer.write_versioned(pattern(3, 1024))
+    assert reader_shm.read_consistent() == (pattern(3, 1024), sequence)
+    view, generation = reader_shm.borrow()
+    assert bytes(view) == pattern(3, 1024)
+    view.release()
+    del view
+
+    # A slot holds a third of the segment, all of it payload
+    writer.write_bytes(pattern(4, 1025))
+    assert reader_shm.read_bytes() == pattern(3, 1024)
+
+    reader_shm.close()
+    writer.close()
+    print("Triple buffer: snapshots read back as written")
+
+
+def run_checks():
+    check_seqlock()
+    check_borrow()
+    check_triple_buffer()
+    check_wait_for_change()
+    check_grow_across_handles()
+    check_grow_shared_handle()
+
+
 def main():
+    # Non-interactive behaviour checks
+    if len(sys.argv) > 1 and sys.argv[1] == "check":
+        run_checks()
+        return
+
     print("Shared Memory Synchronization Test")
     print("This test demonstrates proper synchronization between processes.")
     
     print("Choose mode:")
     print("1. Writer")
     print("2. Reader")
-    choice = input("Enter your choice (1-2): ")
+    print("3. Run behaviour checks")
+    choice = input("Enter your choice (1-3): ")
     
     if choice == '1':
         writer_mode()
+    elif choice == '3':
+        run_checks()
     else:
         reader_mode()
 
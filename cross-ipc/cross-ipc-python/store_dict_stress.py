@@ -0,0 +1,122 @@
+import argparse
+import multiprocessing
+import sys
+import time
+
+from cross_ipc import StoreDictPattern
+
+# Stress test for lock-free StoreDictPattern reads: reader processes look up
+# a fixed set of keys while writer processes keep replacing them with values
+# of changing length (so records move) and adding churn keys (so the table
+# rebuilds and the segment grows). Every value describes itself, so a reader
+# can tell a torn or mismatched copy from a good one.
+
+DEFAULT_NAME = "store_dict_stress"
+DEFAULT_READERS = 4
+DEFAULT_WRITERS = 2
+DEFAULT_READS = 5_000_000
+HOT_KEYS = 64
+CHURN_KEYS = 4096
+
+
+def make_value(key, sequence):
+    """`key|sequence|` followed by a run whose letter and length follow from sequence"""
+    fill = chr(ord('a') + sequence % 26) * ((sequence * 7) % 500)
+    return f"{key}|{sequence}|{fill}"
+
+
+def value_is_whole(key, value):
+    parts = value.split("|", 2)
+    if len(parts) != 3 or parts[0] != key or not parts[1].isdigit():
+        return False
+    sequence = int(parts[1])
+    return parts[2] == chr(ord('a') + sequence % 26) * ((sequence * 7) % 500)
+
+
+def hot_key(i):
+    return f"hot-{i}"
+
+
+def writer(name, writer_id, stop, stores):
+    store = StoreDictPattern(name, 64 * 1024)
+    store.setup()
+    sequence = writer_id
+    count = 0
+    while not stop.is_set():
+        # Hot keys: replaced with a value of another size, so the record moves
+        for i in range(HOT_KEYS):
+            key = hot_key(i)
+            store.store(key, make_value(key, sequence))
+            sequence += 2
+        # Churn: fresh keys rebuild the table until CHURN_KEYS exist, then
+        # the same keys are replaced
+        base = (count * HOT_KEYS) % CHURN_KEYS
+        store.store_many({f"churn-{writer_id}-{base + i}": make_value("churn", i) for i in range(HOT_KEYS)})
+        count += 1
+    with stores.get_lock():
+        stores.value += count * HOT_KEYS * 2
+    store.close()
+
+
+def reader(name, reads, torn, done_reads):
+    store = StoreDictPattern(name, 64 * 1024)
+    store.setup()
+    bad = 0
+    done = 0
+    while done < reads:
+        key = hot_key(done % HOT_KEYS)
+        value = store.retrieve(key)
+        # Hot keys are never removed, so a miss is as wrong as a torn copy
+        if value is None or not value_is_whole(key, value):
+            bad += 1
+            if bad <= 5:
+                print(f"Bad read of {key}: {value and value[:80]!r}")
+        done += 1
+    with torn.get_lock():
+        torn.value += bad
+    with done_reads.get_lock():
+        done_reads.value += done
+    store.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Lock-free StoreDictPattern read stress test")
+    parser.add_argument("--name", default=DEFAULT_NAME)
+    parser.add_argument("--readers", type=int, default=DEFAULT_READERS)
+    parser.add_argument("--writers", type=int, default=DEFAULT_WRITERS, choices=[1, 2])
+    parser.add_argument("--reads", type=int, default=DEFAULT_READS, help="total reads across all readers")
+    args = parser.parse_args()
+
+    # The owner keeps the segment alive for the whole run
+    owner = StoreDictPattern(args.name, 64 * 1024)
+    owner.setup()
+    owner.store_many({hot_key(i): make_value(hot_key(i), 0) for i in range(HOT_KEYS)})
+
+    stop = multiprocessing.Event()
+    torn = multiprocessing.Value('q', 0)
+    done_reads = multiprocessing.Value('q', 0)
+    stores = multiprocessing.Value('q', 0)
+
+    writers = [multiprocessing.Process(target=writer, args=(args.name, i, stop, stores))
+               for i in range(args.writers)]
+    readers = [multiprocessing.Process(target=reader, args=(args.name, args.reads // args.readers, torn, done_reads))
+               for _ in range(args.readers)]
+
+    print(f"{args.readers} readers, {args.writers} writers, {args.reads} reads")
+    started = time.perf_counter()
+    for process in writers + readers:
+        process.start()
+    for process in readers:
+        process.join()
+    stop.set()
+    for process in writers:
+        process.join()
+    elapsed = time.perf_counter() - started
+
+    owner.close()
+    print(f"{done_reads.value} reads and {stores.value} stores in {elapsed:.1f}s, {torn.value} torn")
+    return 1 if torn.value or done_reads.value == 0 else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,15 +1,284 @@
+import os
+import tempfile
+import threading
+import time
+
 from cross_ipc import StoreDictPattern
 
 
-dict_pattern = StoreDictPattern("test_dict", 1024, False)
-dict_pattern.setup()
+def test_store_retrieve():
+    dict_pattern = StoreDictPattern("test_dict", 1024, False)
+    dict_pattern.setup()
+
+    dict_pattern.store("hello", "world")
+
+    # Retrieve the value
+    value = dict_pattern.retrieve("hello")
+    print(f"Retrieved: {value}")
+    assert value == "world"
+
+    dict_pattern.close()
+
+
+def test_rebuild_under_readers():
+    name = "test_dict_rebuild"
+    writer = StoreDictPattern(name, 4096)
+    writer.setup()
+    stable = {f"stable-{i}": f"value-{i}-" + "x" * (i * 10) for i in range(10)}
+    writer.store_many(stable)
+
+    done = threading.Event()
+    failures = []
+    reads = [0]
+
+    # Each reader has its own handle, as another process would, and reads
+    # lock-free while the writer keeps rebuilding and growing the table
+    def reader():
+        handle = StoreDictPattern(name, 4096)
+        handle.setup()
+        while not done.is_set():
+            for key, expected in stable.items():
+                value = handle.retrieve(key)
+                reads[0] += 1
+                if value != expected:
+                    failures.append((key, value))
+        handle.close()
+
+    threads = [threading.Thread(target=reader) for _ in range(3)]
+    for thread in threads:
+        thread.start()
+    for i in range(2000):
+        writer.store(f"fill-{i}", f"fill-value-{i}")
+    done.set()
+    for thread in threads:
+        thread.join()
+
+    assert not failures, failures[:5]
+    assert writer.retrieve("fill-1999") == "fill-value-1999"
+    writer.close()
+    print(f"Table rebuilds: {reads[0]} concurrent reads, none torn or lost")
+
+
+def test_log_mode():
+    name = "test_dict_log"
+    store = StoreDictPattern(name, 4096, mode=StoreDictPattern.MODE_LOG)
+    store.setup()
+    for generation in range(20):
+        store.store_many({f"key-{i}": f"value-{i}-{generation}" for i in range(50)})
+
+    # Another handle replays the log; compaction drops the dead records
+    # without changing what either handle reads
+    other = StoreDictPattern(name, 4096)
+    other.setup()
+    assert other.retrieve("key-7") == "value-7-19"
+    store.compact()
+    assert store.retrieve("key-49") == "value-49-19"
+    store.store("key-0", "after compaction")
+    assert other.retrieve("key-0") == "after compaction"
+    assert other.retrieve("key-50") is None
+
+    other.close()
+    store.close()
+    print("Log mode: replay and compaction keep the latest values")
+
+
+def test_counters():
+    name = "test_dict_counters"
+    owner = StoreDictPattern(name, 4096)
+    owner.setup()
+    assert owner.create_counter("plain", 0)
+    assert owner.create_counter("sharded", 0, shards=8)
+
+    def adder():
+        handle = StoreDictPattern(name, 4096)
+        handle.setup()
+        for _ in range(5000):
+            handle.atomic_add("plain", 1)
+            handle.atomic_add("sharded", 1)
+        handle.close()
+
+    threads = [threading.Thread(target=adder) for _ in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    assert owner.atomic_get("plain") == 20000
+    assert owner.atomic_get("sharded") == 20000
+    assert owner.atomic_add("plain", -5) == 19995
+
+    assert owner.compare_exchange("plain", 19995, 7) == (True, 19995)
+    assert owner.compare_exchange("plain", 19995, 8) == (False, 7)
+    assert owner.atomic_get("missing") is None
+    assert owner.atomic_add("fresh", 3) == 3
+
+    # Reshaping retires the old block; retired blocks are reclaimed, so the
+    # arena does not keep growing with each reshape
+    for i in range(20):
+        owner.create_counter("reshaped", 0, shards=8 if i % 2 else 1)
+    settled = owner.arena_stats()["allocated"]
+    for i in range(500):
+        owner.create_counter("reshaped", 0, shards=8 if i % 2 else 1)
+    assert owner.arena_stats()["allocated"] <= settled + 64 * 1024
+
+    owner.close()
+    print("Counters: plain and sharded totals exact under concurrent adds")
+
+
+def test_store_if_version():
+    store = StoreDictPattern("test_dict_versions", 4096)
+    store.setup()
+
+    assert store.retrieve_with_version("key") == (None, 0)
+    stored, version = store.store_if_version("key", "first", 0)
+    assert stored and version > 0
+    assert store.retrieve_with_version("key") == ("first", version)
+
+    # A stale expectation loses and reports the version that won
+    stored, current = store.store_if_version("key", "second", version)
+    assert stored and current > version
+    stored, reported = store.store_if_version("key", "third", version)
+    assert not stored and reported == current
+    assert store.retrieve("key") == "second"
+
+    # Creating an existing key with version 0 fails too
+    stored, _ = store.store_if_version("key", "fourth", 0)
+    assert not stored
+
+    store.close()
+    print("store_if_version: stale writes rejected")
+
+
+def test_snapshot_restore():
+    path = os.path.join(tempfile.gettempdir(), "test_dict_snapshot.snap")
+    store = StoreDictPattern("test_dict_snapshot", 4096)
+    store.setup()
+    store.store_many({f"key-{i}": f"value-{i}" for i in range(100)})
+    store.create_counter("count", 41)
+    assert store.snapshot(path)
+
+    store.store("key-0", "changed")
+    store.store("extra", "not in the snapshot")
+    store.atomic_add("count", 100)
+
+    assert store.restore(path)
+    assert store.retrieve("key-0") == "value-0"
+    assert store.retrieve("key-99") == "value-99"
+    assert store.retrieve("extra") is None
+    assert store.atomic_add("count", 1) == 42
+
+    # Another handle sees the restored contents
+    other = StoreDictPattern("test_dict_snapshot", 4096)
+    other.setup()
+    assert other.retrieve("key-50") == "value-50"
+    other.close()
+
+    store.close()
+    os.remove(path)
+    print("Snapshot/restore: contents and counters come back")
+
+
+def test_scans():
+    store = StoreDictPattern("test_dict_scans", 4096, ordered=True)
+    store.setup()
+    for key in ["user:3", "admin:1", "user:1", "user:10", "user:2", "users", "zeta"]:
+        store.store(key, key.upper())
+
+    assert [key for key, _ in store.scan_prefix("user:")] == ["user:1", "user:10", "user:2", "user:3"]
+    assert store.scan_prefix("admin") == [("admin:1", "ADMIN:1")]
+    assert store.scan_prefix("nobody") == []
+    assert [key for key, _ in store.scan_prefix("user:", limit=2)] == ["user:1", "user:10"]
+
+    assert [key for key, _ in store.scan_range("user:10", "user:3")] == ["user:10", "user:2"]
+    assert [key for key, _ in store.scan_range("users")] == ["users", "zeta"]
+
+    # Replacing a value keeps one entry per key in order
+    store.store("user:2", "replaced")
+    assert ("user:2", "replaced") in store.scan_prefix("user:")
+    assert len(store.scan_prefix("")) == 7
+
+    store.close()
+    print("Ordered scans: prefix, range and limit")
+
+
+def test_ttl_and_eviction():
+    store = StoreDictPattern("test_dict_ttl_expiry", 4096)
+    store.setup()
+    assert store.store_with_ttl("brief", "soon gone", 200)
+    store.store("kept", "forever")
+    assert store.retrieve("brief") == "soon gone"
+    time.sleep(0.3)
+    assert store.retrieve("brief") is None
+    assert store.retrieve("kept") == "forever"
+    assert store.cache_stats()["expirations"] >= 1
+
+    # Expired entries nobody reads are removed by the sweeper
+    for i in range(50):
+        store.store_with_ttl(f"idle-{i}", "x", 100)
+    time.sleep(0.2)
+    store.sweep()
+    assert store.cache_stats()["expiring"] == 0
+    store.close()
+
+    capacity = 32 * 1024
+    bounded = StoreDictPattern("test_dict_bounded", 4096, capacity=capacity)
+    bounded.setup()
+    for i in range(2000):
+        bounded.store(f"entry-{i}", "v" * 100)
+        if i % 10 == 0:
+            # Keep one entry hot so the CLOCK hand passes it over
+            assert bounded.retrieve("entry-0") == "v" * 100
+    assert bounded.cache_stats()["evictions"] > 0
+    assert bounded.retrieve("entry-1999") == "v" * 100
+    assert bounded.retrieve("entry-0") == "v" * 100
+
+    # Counters can be evicted from a bounded table as well: these alone
+    # need more than the capacity
+    for i in range(1000):
+        assert bounded.create_counter(f"counter-{i}", i)
+    assert bounded.cache_stats()["entries"] < 1000
+    assert bounded.atomic_get("counter-999") == 999
+    bounded.close()
+    print("TTL expiry and CLOCK eviction stay within capacity")
+
+
+def test_ttl_survives_snapshot_restore():
+    path = os.path.join(tempfile.gettempdir(), "test_dict_ttl.snap")
+
+    source = StoreDictPattern("test_dict_ttl", 4096)
+    source.setup()
+    source.store("plain", "kept")
+    source.store_with_ttl("short", "gone soon", 1000)
+    source.store_with_ttl("long", "still here", 60000)
+    assert source.snapshot(path)
+    source.close()
 
+    # Deadlines are wall-clock times, so they mean the same thing to the
+    # segment the image is restored into
+    target = StoreDictPattern("test_dict_ttl_restored", 4096)
+    target.setup()
+    assert target.restore(path)
+    assert target.retrieve("plain") == "kept"
+    assert target.retrieve("short") == "gone soon"
+    assert target.retrieve("long") == "still here"
 
-dict_pattern.store("hello", "world")
+    time.sleep(1.2)
+    assert target.retrieve("short") is None
+    assert target.retrieve("long") == "still here"
+    assert target.retrieve("plain") == "kept"
 
-# Retrieve the value
-value = dict_pattern.retrieve("hello")
-print(f"Retrieved: {value}")
+    target.close()
+    os.remove(path)
+    print("TTL entries survive snapshot/restore")
 
 
-dict_pattern.close() 
\ No newline at end of file
+if __name__ == "__main__":
+    test_store_retrieve()
+    test_rebuild_under_readers()
+    test_log_mode()
+    test_counters()
+    test_store_if_version()
+    test_snapshot_restore()
+    test_scans()
+    test_ttl_and_eviction()
+    test_ttl_survives_snapshot_restore()
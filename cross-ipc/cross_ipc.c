@@ -1,12 +1,16 @@
 #include "cross_ipc.h"
+#ifdef _WIN32
 #include "store_dict_pattern.h"
 #include "pub_sub_pattern.h"
 #include "dispenser_pattern.h"
 #include "shm_dispenser_pattern.h"
 #include "req_resp_pattern.h"
+#endif
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+
 
 CROSS_IPC_API StoreDictPattern* StoreDictPattern_create(const char* name, size_t size, bool verbose) {
     StoreDictPattern* dict = (StoreDictPattern*)malloc(sizeof(StoreDictPattern));
@@ -23,6 +27,14 @@ CROSS_IPC_API void StoreDictPattern_destroy(StoreDictPattern* dict) {
     }
 }
 
+CROSS_IPC_API bool StoreDictPattern_set_mode_api(StoreDictPattern* dict, int mode) {
+    return dict->set_mode(dict, (StoreDictMode)mode);
+}
+
+CROSS_IPC_API bool StoreDictPattern_set_capacity_api(StoreDictPattern* dict, uint64_t capacity) {
+    return dict->set_capacity(dict, capacity);
+}
+
 CROSS_IPC_API bool StoreDictPattern_setup_api(StoreDictPattern* dict) {
     return dict->setup(dict);
 }
@@ -31,10 +43,80 @@ CROSS_IPC_API void StoreDictPattern_store_string_api(StoreDictPattern* dict, con
     dict->store_string(dict, key, value);
 }
 
+CROSS_IPC_API bool StoreDictPattern_store_string_with_ttl_api(StoreDictPattern* dict, const char* key, const char* value,
+    uint64_t ttl_ms) {
+    return dict->store_with_ttl(dict, key, (const unsigned char*)value, strlen(value) + 1, ttl_ms);
+}
+
 CROSS_IPC_API char* StoreDictPattern_retrieve_string_api(StoreDictPattern* dict, const char* key) {
     return dict->retrieve_string(dict, key);
 }
 
+CROSS_IPC_API const IpcName* StoreDictPattern_resolve_api(StoreDictPattern* dict, const char* key) {
+    return dict->resolve(dict, key);
+}
+
+CROSS_IPC_API bool StoreDictPattern_store_string_resolved_api(StoreDictPattern* dict, const IpcName* key, const char* value) {
+    return dict->store_resolved(dict, key, (const unsigned char*)value, strlen(value) + 1);
+}
+
+CROSS_IPC_API char* StoreDictPattern_retrieve_string_resolved_api(StoreDictPattern* dict, const IpcName* key) {
+    size_t size = 0;
+    unsigned char* value = dict->retrieve_resolved(dict, key, &size);
+    if (!value) {
+        return NULL;
+    }
+
+    char* result = (char*)realloc(value, size + 1);
+    if (!result) {
+        free(value);
+        return NULL;
+    }
+    result[size] = '\0';
+    return result;
+}
+
+CROSS_IPC_API char* StoreDictPattern_retrieve_string_with_version_api(StoreDictPattern* dict, const char* key,
+    uint64_t* out_version) {
+    size_t size = 0;
+    unsigned char* value = dict->retrieve_with_version(dict, key, &size, out_version);
+    if (!value) {
+        return NULL;
+    }
+
+    char* result = (char*)realloc(value, size + 1);
+    if (!result) {
+        free(value);
+        return NULL;
+    }
+    result[size] = '\0';
+    return result;
+}
+
+CROSS_IPC_API bool StoreDictPattern_store_string_if_version_api(StoreDictPattern* dict, const char* key, const char* value,
+    uint64_t expected_version, uint64_t* out_version) {
+    return dict->store_if_version(dict, key, (const unsigned char*)value, strlen(value) + 1,
+        expected_version, out_version);
+}
+
+CROSS_IPC_API size_t StoreDictPattern_store_many_api(StoreDictPattern* dict, const char** keys,
+    const unsigned char** values, const size_t* sizes, size_t count) {
+    return dict->store_many(dict, keys, values, sizes, count);
+}
+
+CROSS_IPC_API size_t StoreDictPattern_retrieve_many_api(StoreDictPattern* dict, const char** keys, size_t count,
+    unsigned char** out_values, size_t* out_sizes) {
+    return dict->retrieve_many(dict, keys, count, out_values, out_sizes);
+}
+
+// Values from retrieve_many were allocated by this DLL's heap and must be freed here
+CROSS_IPC_API void StoreDictPattern_free_values_api(unsigned char** values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(values[i]);
+        values[i] = NULL;
+    }
+}
+
 CROSS_IPC_API void StoreDictPattern_close_api(StoreDictPattern* dict) {
     dict->close(dict);
 }
@@ -45,6 +127,65 @@ CROSS_IPC_API void StoreDictPattern_load_api(StoreDictPattern* dict) {
     }
 }
 
+CROSS_IPC_API bool StoreDictPattern_refresh_if_changed_api(StoreDictPattern* dict) {
+    return dict->refresh_if_changed(dict);
+}
+
+CROSS_IPC_API bool StoreDictPattern_create_counter_api(StoreDictPattern* dict, const char* key, int64_t initial, uint32_t shards) {
+    return dict->create_counter(dict, key, initial, shards);
+}
+
+CROSS_IPC_API bool StoreDictPattern_atomic_add_api(StoreDictPattern* dict, const char* key, int64_t delta, int64_t* out_value) {
+    return dict->atomic_add(dict, key, delta, out_value);
+}
+
+CROSS_IPC_API bool StoreDictPattern_atomic_get_api(StoreDictPattern* dict, const char* key, int64_t* out_value) {
+    return dict->atomic_get(dict, key, out_value);
+}
+
+CROSS_IPC_API bool StoreDictPattern_compare_exchange_api(StoreDictPattern* dict, const char* key, int64_t expected,
+    int64_t desired, int64_t* out_actual) {
+    return dict->compare_exchange(dict, key, expected, desired, out_actual);
+}
+
+CROSS_IPC_API bool StoreDictPattern_snapshot_api(StoreDictPattern* dict, const char* path) {
+    return dict->snapshot(dict, path);
+}
+
+CROSS_IPC_API bool StoreDictPattern_restore_api(StoreDictPattern* dict, const char* path) {
+    return dict->restore(dict, path);
+}
+
+CROSS_IPC_API bool StoreDictPattern_set_ordered_api(StoreDictPattern* dict, bool ordered) {
+    return dict->set_ordered(dict, ordered);
+}
+
+CROSS_IPC_API size_t StoreDictPattern_scan_prefix_api(StoreDictPattern* dict, const char* prefix,
+    bool (*fn)(const char*, const unsigned char*, size_t, void*), void* user_data) {
+    return dict->scan_prefix(dict, prefix, fn, user_data);
+}
+
+CROSS_IPC_API size_t StoreDictPattern_scan_range_api(StoreDictPattern* dict, const char* start, const char* end,
+    bool (*fn)(const char*, const unsigned char*, size_t, void*), void* user_data) {
+    return dict->scan_range(dict, start, end, fn, user_data);
+}
+
+CROSS_IPC_API bool StoreDictPattern_compact_api(StoreDictPattern* dict) {
+    return dict->compact(dict);
+}
+
+CROSS_IPC_API size_t StoreDictPattern_sweep_api(StoreDictPattern* dict, uint32_t max_buckets) {
+    return dict->sweep(dict, max_buckets);
+}
+
+CROSS_IPC_API bool StoreDictPattern_cache_stats_api(StoreDictPattern* dict, StoreDictCacheStats* out_stats) {
+    return dict->cache_stats(dict, out_stats);
+}
+
+CROSS_IPC_API bool StoreDictPattern_arena_stats_api(StoreDictPattern* dict, ShmArenaStats* out_stats) {
+    return dict->arena_stats(dict, out_stats);
+}
+
 
 
 typedef struct {
@@ -85,6 +226,14 @@ CROSS_IPC_API void PubSubPattern_publish_string_api(PubSubPattern* pubsub, const
     pubsub->publish_string(pubsub, topic, message);
 }
 
+CROSS_IPC_API const IpcName* PubSubPattern_resolve_topic_api(PubSubPattern* pubsub, const char* topic) {
+    return pubsub->resolve_topic(pubsub, topic);
+}
+
+CROSS_IPC_API bool PubSubPattern_publish_string_resolved_api(PubSubPattern* pubsub, const IpcName* topic, const char* message) {
+    return pubsub->publish_resolved(pubsub, topic, (const unsigned char*)message, strlen(message) + 1);
+}
+
 CROSS_IPC_API void PubSubPattern_subscribe_api(PubSubPattern* pubsub, const char* topic,
     MessageHandlerCallback callback, void* user_data) {
     CallbackWrapper* wrapper = (CallbackWrapper*)malloc(sizeof(CallbackWrapper));
@@ -114,6 +263,14 @@ CROSS_IPC_API void ShmDispenserPattern_destroy(ShmDispenserPattern* dispenser) {
     }
 }
 
+CROSS_IPC_API void ShmDispenserPattern_set_numa_api(ShmDispenserPattern* dispenser, int policy, int node) {
+    dispenser->set_numa(dispenser, (ShmNumaPolicy)policy, node);
+}
+
+CROSS_IPC_API void ShmDispenserPattern_get_numa_stats_api(ShmDispenserPattern* dispenser, ShmNumaStats* out_stats) {
+    dispenser->get_numa_stats(dispenser, out_stats);
+}
+
 CROSS_IPC_API bool ShmDispenserPattern_setup_api(ShmDispenserPattern* dispenser, size_t capacity, size_t item_size) {
     return dispenser->setup(dispenser, capacity, item_size);
 }
@@ -230,6 +387,7 @@ CROSS_IPC_API char* OrdinaryPipe_receive_message_api(OrdinaryPipe* pipe) {
 CROSS_IPC_API void OrdinaryPipe_close_pipe_api(OrdinaryPipe* pipe) {
     oclose_pipe(pipe);
 }
+#endif
 
 
 CROSS_IPC_API SharedMemory* SharedMemory_create(const char* id, size_t size, bool verbose) {
@@ -247,6 +405,26 @@ CROSS_IPC_API void SharedMemory_destroy(SharedMemory* shm) {
     }
 }
 
+CROSS_IPC_API void SharedMemory_set_options_api(SharedMemory* shm, unsigned int options) {
+    shm->set_options(shm, options);
+}
+
+CROSS_IPC_API void SharedMemory_set_numa_api(SharedMemory* shm, int policy, int node) {
+    shm->set_numa(shm, (ShmNumaPolicy)policy, node);
+}
+
+CROSS_IPC_API void SharedMemory_get_numa_stats_api(SharedMemory* shm, ShmNumaStats* out_stats) {
+    shm->get_numa_stats(shm, out_stats);
+}
+
+CROSS_IPC_API bool SharedMemory_set_durability_api(SharedMemory* shm, int durability, DWORD interval_ms) {
+    return shm->set_durability(shm, (SharedMemoryDurability)durability, interval_ms);
+}
+
+CROSS_IPC_API unsigned int SharedMemory_applied_options_api(SharedMemory* shm) {
+    return shm->get_applied_options(shm);
+}
+
 CROSS_IPC_API bool SharedMemory_setup_api(SharedMemory* shm) {
     return shm->setup(shm);
 }
@@ -256,6 +434,18 @@ CROSS_IPC_API void SharedMemory_write_api(SharedMemory* shm, const char* data) {
     shm->write(shm, data, data_len);
 }
 
+CROSS_IPC_API bool SharedMemory_writev_api(SharedMemory* shm, const struct iovec* iov, size_t iovcnt) {
+    return shm->writev(shm, iov, iovcnt);
+}
+
+CROSS_IPC_API bool SharedMemory_write_at_api(SharedMemory* shm, size_t offset, const void* data, size_t data_size) {
+    return shm->write_at(shm, offset, data, data_size);
+}
+
+CROSS_IPC_API bool SharedMemory_read_at_api(SharedMemory* shm, size_t offset, void* out, size_t length) {
+    return shm->read_at(shm, offset, out, length);
+}
+
 CROSS_IPC_API void SharedMemory_write_bytes_api(SharedMemory* shm, const unsigned char* data, size_t data_size) {
     shm->write_bytes(shm, data, data_size);
 }
@@ -268,6 +458,34 @@ CROSS_IPC_API unsigned char* SharedMemory_read_bytes_api(SharedMemory* shm, size
     return shm->read_bytes(shm, out_size);
 }
 
+CROSS_IPC_API bool SharedMemory_write_versioned_api(SharedMemory* shm, const unsigned char* data, size_t data_size, uint32_t* out_sequence) {
+    return shm->write_versioned(shm, data, data_size, out_sequence);
+}
+
+CROSS_IPC_API unsigned char* SharedMemory_read_consistent_api(SharedMemory* shm, size_t* out_size, uint32_t* out_sequence) {
+    return shm->read_consistent(shm, out_size, out_sequence);
+}
+
+CROSS_IPC_API const unsigned char* SharedMemory_borrow_api(SharedMemory* shm, size_t* out_size, uint32_t* out_generation) {
+    return shm->borrow(shm, out_size, out_generation);
+}
+
+CROSS_IPC_API bool SharedMemory_grow_api(SharedMemory* shm, size_t new_size) {
+    return shm->grow(shm, new_size);
+}
+
+CROSS_IPC_API uint32_t SharedMemory_get_sequence_api(SharedMemory* shm) {
+    return shm->get_sequence(shm);
+}
+
+CROSS_IPC_API bool SharedMemory_wait_for_change_api(SharedMemory* shm, uint32_t last_sequence, DWORD timeout_ms, uint32_t* out_sequence) {
+    return shm->wait_for_change(shm, last_sequence, timeout_ms, out_sequence);
+}
+
+CROSS_IPC_API bool SharedMemory_validate_borrow_api(SharedMemory* shm, uint32_t generation) {
+    return shm->validate_borrow(shm, generation);
+}
+
 CROSS_IPC_API void SharedMemory_clear_api(SharedMemory* shm) {
     shm->clear(shm);
 }
@@ -289,6 +507,15 @@ CROSS_IPC_API bool SharedMemory_unlock_from_writing_api(SharedMemory* shm) {
     return shm->unlock_from_writing(shm);
 }
 
+CROSS_IPC_API bool SharedMemory_lock_for_reading_api(SharedMemory* shm, DWORD timeout_ms) {
+    return shm->lock_for_reading(shm, timeout_ms);
+}
+
+CROSS_IPC_API bool SharedMemory_unlock_from_reading_api(SharedMemory* shm) {
+    return shm->unlock_from_reading(shm);
+}
+
+#ifdef _WIN32
 
 CROSS_IPC_API ReqRespPattern* ReqRespPattern_create(bool verbose) {
     ReqRespPattern* rr = (ReqRespPattern*)malloc(sizeof(ReqRespPattern));
@@ -317,6 +544,14 @@ CROSS_IPC_API char* ReqRespPattern_request_api(ReqRespPattern* rr, const char* i
     return ReqRespPattern_request(rr, id, message);
 }
 
+CROSS_IPC_API int ReqRespPattern_resolve_api(ReqRespPattern* rr, const char* id) {
+    return ReqRespPattern_resolve(rr, id);
+}
+
+CROSS_IPC_API char* ReqRespPattern_request_resolved_api(ReqRespPattern* rr, int pipe, const char* message) {
+    return ReqRespPattern_request_resolved(rr, pipe, message);
+}
+
 CROSS_IPC_API void ReqRespPattern_respond_api(ReqRespPattern* rr, const char* id, RequestHandlerCallback handler, void* user_data) {
     ReqRespPattern_respond(rr, id, handler, user_data);
 }
@@ -324,4 +559,4 @@ CROSS_IPC_API void ReqRespPattern_respond_api(ReqRespPattern* rr, const char* id
 CROSS_IPC_API void ReqRespPattern_close_api(ReqRespPattern* rr) {
     ReqRespPattern_close(rr);
 }
-
+#endif
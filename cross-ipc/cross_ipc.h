@@ -6,29 +6,63 @@
 #include <stddef.h>
 
 // Include the necessary headers
+#include "cross_ipc_export.h"
+#include "shared_memory.h"
+#include "shm_arena.h"
+#include "name_table.h"
+#ifdef _WIN32
 #include "named_pipe.h"
 #include "ordinary_pipe.h"
-#include "shared_memory.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#ifdef CROSS_IPC_EXPORTS
-#define CROSS_IPC_API __declspec(dllexport)
-#else
-#define CROSS_IPC_API __declspec(dllimport)
-#endif
-
+#ifdef _WIN32
 	// StoreDictPattern API
 	typedef struct StoreDictPattern StoreDictPattern;
+	typedef struct StoreDictCacheStats StoreDictCacheStats;
 
 	CROSS_IPC_API StoreDictPattern* StoreDictPattern_create(const char* name, size_t size, bool verbose);
 	CROSS_IPC_API void StoreDictPattern_destroy(StoreDictPattern* dict);
+	CROSS_IPC_API bool StoreDictPattern_set_mode_api(StoreDictPattern* dict, int mode);
+	CROSS_IPC_API bool StoreDictPattern_set_capacity_api(StoreDictPattern* dict, uint64_t capacity);
 	CROSS_IPC_API bool StoreDictPattern_setup_api(StoreDictPattern* dict);
 	CROSS_IPC_API void StoreDictPattern_store_string_api(StoreDictPattern* dict, const char* key, const char* value);
+	CROSS_IPC_API bool StoreDictPattern_store_string_with_ttl_api(StoreDictPattern* dict, const char* key, const char* value,
+		uint64_t ttl_ms);
 	CROSS_IPC_API char* StoreDictPattern_retrieve_string_api(StoreDictPattern* dict, const char* key);
+	CROSS_IPC_API const IpcName* StoreDictPattern_resolve_api(StoreDictPattern* dict, const char* key);
+	CROSS_IPC_API bool StoreDictPattern_store_string_resolved_api(StoreDictPattern* dict, const IpcName* key, const char* value);
+	CROSS_IPC_API char* StoreDictPattern_retrieve_string_resolved_api(StoreDictPattern* dict, const IpcName* key);
+	CROSS_IPC_API char* StoreDictPattern_retrieve_string_with_version_api(StoreDictPattern* dict, const char* key,
+		uint64_t* out_version);
+	CROSS_IPC_API bool StoreDictPattern_store_string_if_version_api(StoreDictPattern* dict, const char* key, const char* value,
+		uint64_t expected_version, uint64_t* out_version);
+	CROSS_IPC_API size_t StoreDictPattern_store_many_api(StoreDictPattern* dict, const char** keys,
+		const unsigned char** values, const size_t* sizes, size_t count);
+	CROSS_IPC_API size_t StoreDictPattern_retrieve_many_api(StoreDictPattern* dict, const char** keys, size_t count,
+		unsigned char** out_values, size_t* out_sizes);
+	CROSS_IPC_API void StoreDictPattern_free_values_api(unsigned char** values, size_t count);
 	CROSS_IPC_API void StoreDictPattern_load_api(StoreDictPattern* dict);
+	CROSS_IPC_API bool StoreDictPattern_refresh_if_changed_api(StoreDictPattern* dict);
+	CROSS_IPC_API bool StoreDictPattern_create_counter_api(StoreDictPattern* dict, const char* key, int64_t initial, uint32_t shards);
+	CROSS_IPC_API bool StoreDictPattern_atomic_add_api(StoreDictPattern* dict, const char* key, int64_t delta, int64_t* out_value);
+	CROSS_IPC_API bool StoreDictPattern_atomic_get_api(StoreDictPattern* dict, const char* key, int64_t* out_value);
+	CROSS_IPC_API bool StoreDictPattern_compare_exchange_api(StoreDictPattern* dict, const char* key, int64_t expected,
+		int64_t desired, int64_t* out_actual);
+	CROSS_IPC_API bool StoreDictPattern_snapshot_api(StoreDictPattern* dict, const char* path);
+	CROSS_IPC_API bool StoreDictPattern_restore_api(StoreDictPattern* dict, const char* path);
+	CROSS_IPC_API bool StoreDictPattern_set_ordered_api(StoreDictPattern* dict, bool ordered);
+	CROSS_IPC_API size_t StoreDictPattern_scan_prefix_api(StoreDictPattern* dict, const char* prefix,
+		bool (*fn)(const char*, const unsigned char*, size_t, void*), void* user_data);
+	CROSS_IPC_API size_t StoreDictPattern_scan_range_api(StoreDictPattern* dict, const char* start, const char* end,
+		bool (*fn)(const char*, const unsigned char*, size_t, void*), void* user_data);
+	CROSS_IPC_API bool StoreDictPattern_compact_api(StoreDictPattern* dict);
+	CROSS_IPC_API size_t StoreDictPattern_sweep_api(StoreDictPattern* dict, uint32_t max_buckets);
+	CROSS_IPC_API bool StoreDictPattern_cache_stats_api(StoreDictPattern* dict, StoreDictCacheStats* out_stats);
+	CROSS_IPC_API bool StoreDictPattern_arena_stats_api(StoreDictPattern* dict, ShmArenaStats* out_stats);
 	CROSS_IPC_API void StoreDictPattern_close_api(StoreDictPattern* dict);
 
 	// PubSubPattern API
@@ -39,6 +73,8 @@ extern "C" {
 	CROSS_IPC_API void PubSubPattern_destroy(PubSubPattern* pubsub);
 	CROSS_IPC_API bool PubSubPattern_setup_api(PubSubPattern* pubsub);
 	CROSS_IPC_API void PubSubPattern_publish_string_api(PubSubPattern* pubsub, const char* topic, const char* message);
+	CROSS_IPC_API const IpcName* PubSubPattern_resolve_topic_api(PubSubPattern* pubsub, const char* topic);
+	CROSS_IPC_API bool PubSubPattern_publish_string_resolved_api(PubSubPattern* pubsub, const IpcName* topic, const char* message);
 	CROSS_IPC_API void PubSubPattern_subscribe_api(PubSubPattern* pubsub, const char* topic, MessageHandlerCallback callback, void* user_data);
 	CROSS_IPC_API void PubSubPattern_close_api(PubSubPattern* pubsub);
 
@@ -54,6 +90,8 @@ extern "C" {
 
 	CROSS_IPC_API ShmDispenserPattern* ShmDispenserPattern_create(const char* name, ShmDispenserMode mode, bool verbose);
 	CROSS_IPC_API void ShmDispenserPattern_destroy(ShmDispenserPattern* dispenser);
+	CROSS_IPC_API void ShmDispenserPattern_set_numa_api(ShmDispenserPattern* dispenser, int policy, int node);
+	CROSS_IPC_API void ShmDispenserPattern_get_numa_stats_api(ShmDispenserPattern* dispenser, ShmNumaStats* out_stats);
 	CROSS_IPC_API bool ShmDispenserPattern_setup_api(ShmDispenserPattern* dispenser, size_t capacity, size_t item_size);
 	CROSS_IPC_API bool ShmDispenserPattern_add_string_api(ShmDispenserPattern* dispenser, const char* item);
 	CROSS_IPC_API bool ShmDispenserPattern_add_string_front_api(ShmDispenserPattern* dispenser, const char* item);
@@ -82,15 +120,31 @@ extern "C" {
 	CROSS_IPC_API void OrdinaryPipe_send_message_api(OrdinaryPipe* pipe, const char* message);
 	CROSS_IPC_API char* OrdinaryPipe_receive_message_api(OrdinaryPipe* pipe);
 	CROSS_IPC_API void OrdinaryPipe_close_pipe_api(OrdinaryPipe* pipe);
+#endif
 
 	// SharedMemory API
 	CROSS_IPC_API SharedMemory* SharedMemory_create(const char* id, size_t size, bool verbose);
 	CROSS_IPC_API void SharedMemory_destroy(SharedMemory* shm);
+	CROSS_IPC_API void SharedMemory_set_options_api(SharedMemory* shm, unsigned int options);
+	CROSS_IPC_API void SharedMemory_set_numa_api(SharedMemory* shm, int policy, int node);
+	CROSS_IPC_API void SharedMemory_get_numa_stats_api(SharedMemory* shm, ShmNumaStats* out_stats);
+	CROSS_IPC_API bool SharedMemory_set_durability_api(SharedMemory* shm, int durability, DWORD interval_ms);
+	CROSS_IPC_API unsigned int SharedMemory_applied_options_api(SharedMemory* shm);
 	CROSS_IPC_API bool SharedMemory_setup_api(SharedMemory* shm);
 	CROSS_IPC_API void SharedMemory_write_api(SharedMemory* shm, const char* data);
 	CROSS_IPC_API void SharedMemory_write_bytes_api(SharedMemory* shm, const unsigned char* data, size_t data_size);
+	CROSS_IPC_API bool SharedMemory_writev_api(SharedMemory* shm, const struct iovec* iov, size_t iovcnt);
+	CROSS_IPC_API bool SharedMemory_write_at_api(SharedMemory* shm, size_t offset, const void* data, size_t data_size);
+	CROSS_IPC_API bool SharedMemory_read_at_api(SharedMemory* shm, size_t offset, void* out, size_t length);
 	CROSS_IPC_API char* SharedMemory_read_api(SharedMemory* shm);
 	CROSS_IPC_API unsigned char* SharedMemory_read_bytes_api(SharedMemory* shm, size_t* out_size);
+	CROSS_IPC_API bool SharedMemory_write_versioned_api(SharedMemory* shm, const unsigned char* data, size_t data_size, uint32_t* out_sequence);
+	CROSS_IPC_API unsigned char* SharedMemory_read_consistent_api(SharedMemory* shm, size_t* out_size, uint32_t* out_sequence);
+	CROSS_IPC_API const unsigned char* SharedMemory_borrow_api(SharedMemory* shm, size_t* out_size, uint32_t* out_generation);
+	CROSS_IPC_API bool SharedMemory_validate_borrow_api(SharedMemory* shm, uint32_t generation);
+	CROSS_IPC_API bool SharedMemory_grow_api(SharedMemory* shm, size_t new_size);
+	CROSS_IPC_API uint32_t SharedMemory_get_sequence_api(SharedMemory* shm);
+	CROSS_IPC_API bool SharedMemory_wait_for_change_api(SharedMemory* shm, uint32_t last_sequence, DWORD timeout_ms, uint32_t* out_sequence);
 	CROSS_IPC_API void SharedMemory_clear_api(SharedMemory* shm);
 	CROSS_IPC_API void SharedMemory_close_api(SharedMemory* shm);
 	CROSS_IPC_API void SharedMemory_unlink_api(SharedMemory* shm);
@@ -98,7 +152,10 @@ extern "C" {
 	// New lock-related API functions for SharedMemory
 	CROSS_IPC_API bool SharedMemory_lock_for_writing_api(SharedMemory* shm, DWORD timeout_ms);
 	CROSS_IPC_API bool SharedMemory_unlock_from_writing_api(SharedMemory* shm);
+	CROSS_IPC_API bool SharedMemory_lock_for_reading_api(SharedMemory* shm, DWORD timeout_ms);
+	CROSS_IPC_API bool SharedMemory_unlock_from_reading_api(SharedMemory* shm);
 
+#ifdef _WIN32
 	// ReqRespPattern API
 	typedef struct ReqRespPattern ReqRespPattern;
 	typedef char* (*RequestHandlerCallback)(const char* request, void* user_data);
@@ -108,8 +165,11 @@ extern "C" {
 	CROSS_IPC_API bool ReqRespPattern_setup_server_api(ReqRespPattern* rr, const char* id);
 	CROSS_IPC_API bool ReqRespPattern_setup_client_api(ReqRespPattern* rr, const char* id);
 	CROSS_IPC_API char* ReqRespPattern_request_api(ReqRespPattern* rr, const char* id, const char* message);
+	CROSS_IPC_API int ReqRespPattern_resolve_api(ReqRespPattern* rr, const char* id);
+	CROSS_IPC_API char* ReqRespPattern_request_resolved_api(ReqRespPattern* rr, int pipe, const char* message);
 	CROSS_IPC_API void ReqRespPattern_respond_api(ReqRespPattern* rr, const char* id, RequestHandlerCallback handler, void* user_data);
 	CROSS_IPC_API void ReqRespPattern_close_api(ReqRespPattern* rr);
+#endif
 
 #ifdef __cplusplus
 }
@@ -117,6 +117,7 @@ def run_receiver(name, num_messages):
         start_time = time.time()
         timeout = 60  # 60 seconds timeout
         last_data = None
+        sequence = shm.sequence()
         
         while received_count < num_messages:
             # Check for timeout
@@ -124,12 +125,16 @@ def run_receiver(name, num_messages):
                 print(f"Timeout after {timeout} seconds. Received {received_count}/{num_messages} messages.")
                 break
             
+            # Sleep until the sender completes a write instead of polling
+            changed = shm.wait_for_change(sequence, 100)
+            if changed is None:
+                continue
+            sequence = changed
             
             data = shm.read()
             
-            
+            # The sender clears before each write, so skip the empty state
             if not data or data == last_data:
-                time.sleep(0.01)
                 continue
                 
             last_data = data
@@ -162,9 +167,6 @@ def run_receiver(name, num_messages):
                 print("Received invalid JSON message")
             except Exception as e:
                 print(f"Error processing message: {e}")
-            
-            
-            time.sleep(0.01)
         
         # Calculate and print statistics
         if received_count == 0:
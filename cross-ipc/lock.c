@@ -1,13 +1,36 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
 #include "lock.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
 
 void FileLock_init(FileLock* lock, const char* base_path, bool verbose) {
     
     lock->verbose = verbose;
+#ifdef _WIN32
     lock->lock_handle = INVALID_HANDLE_VALUE;
+#else
+    lock->lock_fd = -1;
+#endif
     
     
     size_t path_len = strlen(base_path);
@@ -25,6 +48,7 @@ void FileLock_init(FileLock* lock, const char* base_path, bool verbose) {
 }
 
 bool FileLock_acquire(FileLock* self, DWORD timeout_ms) {
+#ifdef _WIN32
     if (self->lock_handle != INVALID_HANDLE_VALUE) {
         if (self->verbose) {
             printf("Lock already acquired\n");
@@ -95,18 +119,63 @@ bool FileLock_acquire(FileLock* self, DWORD timeout_ms) {
         printf("Lock acquired\n");
     }
     return true;
+#else
+    if (self->lock_fd != -1) {
+        if (self->verbose) {
+            printf("Lock already acquired\n");
+        }
+        return true;
+    }
+
+    int fd = open(self->lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd == -1) {
+        if (self->verbose) {
+            printf("Failed to acquire lock: error %d\n", errno);
+        }
+        return false;
+    }
+
+    unsigned long long start_time = ipc_now_ms();
+    while (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        if (errno != EWOULDBLOCK || (ipc_now_ms() - start_time) >= timeout_ms) {
+            if (self->verbose) {
+                printf("Failed to acquire lock: timeout after %lu ms\n", timeout_ms);
+            }
+            close(fd);
+            return false;
+        }
+        ipc_sleep_ms(10);
+    }
+
+    self->lock_fd = fd;
+
+    if (self->verbose) {
+        printf("Lock acquired\n");
+    }
+    return true;
+#endif
 }
 
 bool FileLock_release(FileLock* self) {
+#ifdef _WIN32
     if (self->lock_handle == INVALID_HANDLE_VALUE) {
+#else
+    if (self->lock_fd == -1) {
+#endif
         if (self->verbose) {
             printf("No lock to release\n");
         }
         return false;
     }
     
+#ifdef _WIN32
     CloseHandle(self->lock_handle);
     self->lock_handle = INVALID_HANDLE_VALUE;
+#else
+    flock(self->lock_fd, LOCK_UN);
+    close(self->lock_fd);
+    self->lock_fd = -1;
+#endif
     
     if (self->verbose) {
         printf("Lock released\n");
@@ -116,10 +185,18 @@ bool FileLock_release(FileLock* self) {
 
 void FileLock_close(FileLock* self) {
     
+#ifdef _WIN32
     if (self->lock_handle != INVALID_HANDLE_VALUE) {
         CloseHandle(self->lock_handle);
         self->lock_handle = INVALID_HANDLE_VALUE;
     }
+#else
+    if (self->lock_fd != -1) {
+        flock(self->lock_fd, LOCK_UN);
+        close(self->lock_fd);
+        self->lock_fd = -1;
+    }
+#endif
     
     
     if (self->lock_path) {
@@ -131,3 +208,499 @@ void FileLock_close(FileLock* self) {
         printf("FileLock closed\n");
     }
 }
+
+
+bool ipc_futex_wait(volatile uint32_t* addr, uint32_t expected, DWORD timeout_ms) {
+#ifdef __linux__
+    struct timespec ts;
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+
+    // Shared (non-private) futex so waiters in other processes are woken too
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, expected, &ts, NULL, 0) == 0) {
+        return true;
+    }
+    return errno != ETIMEDOUT;
+#else
+    unsigned long long start_time = ipc_now_ms();
+    while (ipc_atomic_load_u32(addr) == expected) {
+        if ((ipc_now_ms() - start_time) >= timeout_ms) {
+            return false;
+        }
+        ipc_sleep_ms(1);
+    }
+    return true;
+#endif
+}
+
+void ipc_futex_wake(volatile uint32_t* addr, int count) {
+#ifdef __linux__
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+#else
+    (void)addr;
+    (void)count;
+#endif
+}
+
+
+// Low 32 bits of the process start time (clock ticks since boot on Linux,
+// milliseconds on Windows), never 0 for a live process. A recycled pid would
+// have to start on the same tick to be mistaken for the old process.
+uint32_t ipc_process_token(uint32_t pid) {
+    uint64_t start = 0;
+#ifdef _WIN32
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (process == NULL) {
+        return 0;
+    }
+    FILETIME created, exited, kernel, user;
+    if (GetProcessTimes(process, &created, &exited, &kernel, &user)) {
+        start = (((uint64_t)created.dwHighDateTime << 32) | created.dwLowDateTime) / 10000;
+    }
+    CloseHandle(process);
+#elif defined(__linux__)
+    char path[64];
+    char stat[1024];
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 0;
+    }
+    ssize_t length = read(fd, stat, sizeof(stat) - 1);
+    close(fd);
+    if (length <= 0) {
+        return 0;
+    }
+    stat[length] = '\0';
+
+    // starttime is field 22; the command name in field 2 may hold spaces or
+    // parentheses, so count from the last ')'
+    char* field = strrchr(stat, ')');
+    for (int i = 2; field && i < 22; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    if (!field) {
+        return 0;
+    }
+    start = strtoull(field + 1, NULL, 10);
+#else
+    (void)pid;
+#endif
+    uint32_t token = (uint32_t)start;
+    return token ? token : (start ? 1 : 0);
+}
+
+uint32_t ipc_pid_namespace(void) {
+#ifdef __linux__
+    struct stat ns;
+    if (stat("/proc/self/ns/pid", &ns) == 0) {
+        return (uint32_t)ns.st_ino;
+    }
+#endif
+    return 0;
+}
+
+bool ipc_process_alive(uint32_t pid, uint32_t token, uint32_t ns) {
+    if (ns != 0 && ns != ipc_pid_namespace()) {
+        return true;
+    }
+
+    uint32_t current = ipc_process_token(pid);
+    if (token != 0 && current != 0) {
+        return current == token;
+    }
+
+#ifdef _WIN32
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+    if (process == NULL) {
+        return GetLastError() != ERROR_INVALID_PARAMETER;
+    }
+    bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return alive;
+#else
+    return kill((pid_t)pid, 0) == 0 || errno != ESRCH;
+#endif
+}
+
+
+void ShmMutex_init(ShmMutex* mutex, const char* name, bool verbose) {
+    mutex->word = NULL;
+    mutex->owner = NULL;
+    mutex->held = false;
+    mutex->recovered = false;
+    mutex->verbose = verbose;
+
+#ifdef _WIN32
+    char mutex_name[MAX_PATH];
+    sprintf_s(mutex_name, sizeof(mutex_name), "%s_write_lock", name);
+
+    mutex->mutex_handle = CreateMutexA(NULL, FALSE, mutex_name);
+    if (mutex->mutex_handle == NULL && verbose) {
+        printf("Failed to create mutex %s: error %lu\n", mutex_name, GetLastError());
+    }
+#else
+    (void)name;
+#endif
+
+    // Assign method pointers
+    mutex->acquire = ShmMutex_acquire;
+    mutex->release = ShmMutex_release;
+    mutex->close = ShmMutex_close;
+
+    if (mutex->verbose) {
+        printf("ShmMutex initialized for %s\n", name);
+    }
+}
+
+#ifndef _WIN32
+// The owner words are cleared before the lock word on release and set after
+// it on acquire, so a token read here is either the current owner's or 0.
+// A stale reading only matters if the lock word is unchanged, which the
+// takeover's compare-and-swap checks.
+static bool owner_alive(ShmMutex* self, uint32_t owner) {
+    uint32_t token = self->owner ? ipc_atomic_load_u32(&self->owner[0]) : 0;
+    uint32_t ns = self->owner ? ipc_atomic_load_u32(&self->owner[1]) : 0;
+    return ipc_process_alive(owner, token, ns);
+}
+
+// Reading the token costs a /proc lookup, so it is taken once per process.
+// A forked child has a pid, and so a token, of its own.
+static volatile uint32_t cached_pid;
+static volatile uint32_t cached_token;
+static volatile uint32_t cached_ns;
+
+static void record_owner(ShmMutex* self, uint32_t pid) {
+    if (!self->owner) {
+        return;
+    }
+    if (ipc_atomic_load_u32(&cached_pid) != pid) {
+        ipc_atomic_store_u32(&cached_token, ipc_process_token(pid));
+        ipc_atomic_store_u32(&cached_ns, ipc_pid_namespace());
+        ipc_atomic_store_u32(&cached_pid, pid);
+    }
+    ipc_atomic_store_u32(&self->owner[1], ipc_atomic_load_u32(&cached_ns));
+    ipc_atomic_store_u32(&self->owner[0], ipc_atomic_load_u32(&cached_token));
+}
+#endif
+
+bool ShmMutex_acquire(ShmMutex* self, DWORD timeout_ms) {
+    if (self->held) {
+        if (self->verbose) {
+            printf("Lock already acquired\n");
+        }
+        return true;
+    }
+
+    self->recovered = false;
+
+#ifdef _WIN32
+    if (self->mutex_handle == NULL) {
+        return false;
+    }
+
+    DWORD result = WaitForSingleObject(self->mutex_handle, timeout_ms);
+    if (result == WAIT_ABANDONED) {
+        // The previous owner exited while holding the lock; ownership passes to us
+        self->recovered = true;
+    }
+    else if (result != WAIT_OBJECT_0) {
+        if (self->verbose) {
+            printf("Failed to acquire lock: %s\n", result == WAIT_TIMEOUT ? "timeout" : "wait failed");
+        }
+        return false;
+    }
+#else
+    if (self->word == NULL) {
+        if (self->verbose) {
+            printf("Failed to acquire lock: segment is not mapped\n");
+        }
+        return false;
+    }
+
+    uint32_t self_pid = (uint32_t)getpid();
+    bool acquired = false;
+
+    for (int i = 0; i < SHM_MUTEX_SPIN_COUNT && !acquired; i++) {
+        acquired = ipc_atomic_cas_u32(self->word, 0, self_pid);
+        if (!acquired) {
+            ipc_cpu_relax();
+        }
+    }
+
+    unsigned long long start_time = ipc_now_ms();
+    while (!acquired) {
+        uint32_t current = ipc_atomic_load_u32(self->word);
+
+        if (current == 0) {
+            // Keep the waiters bit: others may still be sleeping behind us
+            acquired = ipc_atomic_cas_u32(self->word, 0, self_pid | SHM_MUTEX_WAITERS);
+            continue;
+        }
+
+        uint32_t owner = current & ~SHM_MUTEX_WAITERS;
+        if (owner != self_pid && !owner_alive(self, owner)) {
+            // Drop the dead owner's token first, so nobody judges us by it
+            if (self->owner) {
+                ipc_atomic_store_u32(&self->owner[0], 0);
+            }
+            if (ipc_atomic_cas_u32(self->word, current, self_pid | SHM_MUTEX_WAITERS)) {
+                self->recovered = true;
+                acquired = true;
+            }
+            continue;
+        }
+
+        unsigned long long elapsed = ipc_now_ms() - start_time;
+        if (elapsed >= timeout_ms) {
+            if (self->verbose) {
+                printf("Failed to acquire lock: timeout after %lu ms\n", timeout_ms);
+            }
+            return false;
+        }
+
+        if (!(current & SHM_MUTEX_WAITERS) &&
+            !ipc_atomic_cas_u32(self->word, current, current | SHM_MUTEX_WAITERS)) {
+            continue;
+        }
+
+        // Sleep in slices so a crashed owner is noticed without waiting out the timeout
+        DWORD slice = timeout_ms - (DWORD)elapsed;
+        ipc_futex_wait(self->word, current | SHM_MUTEX_WAITERS, slice < 100 ? slice : 100);
+    }
+
+    record_owner(self, self_pid);
+#endif
+
+    self->held = true;
+
+    if (self->verbose) {
+        printf(self->recovered ? "Lock acquired from a dead owner\n" : "Lock acquired\n");
+    }
+    return true;
+}
+
+bool ShmMutex_release(ShmMutex* self) {
+    if (!self->held) {
+        if (self->verbose) {
+            printf("No lock to release\n");
+        }
+        return false;
+    }
+
+    self->held = false;
+
+#ifdef _WIN32
+    ReleaseMutex(self->mutex_handle);
+#else
+    if (self->owner) {
+        ipc_atomic_store_u32(&self->owner[0], 0);
+    }
+    if (ipc_atomic_exchange_u32(self->word, 0) & SHM_MUTEX_WAITERS) {
+        ipc_futex_wake(self->word, 1);
+    }
+#endif
+
+    if (self->verbose) {
+        printf("Lock released\n");
+    }
+    return true;
+}
+
+void ShmMutex_close(ShmMutex* self) {
+    if (self->held) {
+        ShmMutex_release(self);
+    }
+
+#ifdef _WIN32
+    if (self->mutex_handle != NULL) {
+        CloseHandle(self->mutex_handle);
+        self->mutex_handle = NULL;
+    }
+#endif
+
+    self->word = NULL;
+    self->owner = NULL;
+
+    if (self->verbose) {
+        printf("ShmMutex closed\n");
+    }
+}
+
+
+void ShmRwLock_init(ShmRwLock* lock, const char* name, bool verbose) {
+    ShmMutex_init(&lock->writer, name, verbose);
+    lock->state = NULL;
+    lock->reads_held = 0;
+    lock->recovered = false;
+    lock->verbose = verbose;
+
+    // Assign method pointers
+    lock->acquire_read = ShmRwLock_acquire_read;
+    lock->release_read = ShmRwLock_release_read;
+    lock->acquire_write = ShmRwLock_acquire_write;
+    lock->release_write = ShmRwLock_release_write;
+    lock->close = ShmRwLock_close;
+}
+
+static void clear_writer_flag(ShmRwLock* self) {
+    uint32_t current;
+    do {
+        current = ipc_atomic_load_u32(self->state);
+    } while (!ipc_atomic_cas_u32(self->state, current, current & ~SHM_RWLOCK_WRITER));
+
+    ipc_futex_wake(self->state, INT_MAX);
+}
+
+// A writer flag with no live writer behind it means the writer died. Taking
+// the mutex succeeds only in that case (or once the writer has finished).
+static bool recover_dead_writer(ShmRwLock* self) {
+    if (!self->writer.acquire(&self->writer, 0)) {
+        return false;
+    }
+
+    bool recovered = self->writer.recovered;
+    if (recovered) {
+        clear_writer_flag(self);
+        self->recovered = true;
+    }
+    self->writer.release(&self->writer);
+    return recovered;
+}
+
+bool ShmRwLock_acquire_read(ShmRwLock* self, DWORD timeout_ms) {
+    if (self->state == NULL || self->writer.held) {
+        if (self->verbose) {
+            printf("Failed to acquire read lock: %s\n",
+                self->state == NULL ? "segment is not mapped" : "write lock is held by this handle");
+        }
+        return false;
+    }
+
+    self->recovered = false;
+    unsigned long long start_time = ipc_now_ms();
+
+    while (true) {
+        uint32_t current = ipc_atomic_load_u32(self->state);
+
+        if (!(current & SHM_RWLOCK_WRITER)) {
+            if (ipc_atomic_cas_u32(self->state, current, current + 1)) {
+                break;
+            }
+            continue;
+        }
+
+        unsigned long long elapsed = ipc_now_ms() - start_time;
+        if (elapsed >= timeout_ms) {
+            if (self->verbose) {
+                printf("Failed to acquire read lock: timeout after %lu ms\n", timeout_ms);
+            }
+            return false;
+        }
+
+        DWORD slice = timeout_ms - (DWORD)elapsed;
+        if (!ipc_futex_wait(self->state, current, slice < 100 ? slice : 100)) {
+            recover_dead_writer(self);
+        }
+    }
+
+    self->reads_held++;
+
+    if (self->verbose) {
+        printf("Read lock acquired\n");
+    }
+    return true;
+}
+
+bool ShmRwLock_release_read(ShmRwLock* self) {
+    if (self->reads_held == 0 || self->state == NULL) {
+        if (self->verbose) {
+            printf("No read lock to release\n");
+        }
+        return false;
+    }
+
+    self->reads_held--;
+
+    // The last reader out lets a pending writer in
+    uint32_t previous = ipc_atomic_fetch_add_u32(self->state, (uint32_t)-1);
+    if (previous == (SHM_RWLOCK_WRITER | 1)) {
+        ipc_futex_wake(self->state, INT_MAX);
+    }
+
+    if (self->verbose) {
+        printf("Read lock released\n");
+    }
+    return true;
+}
+
+bool ShmRwLock_acquire_write(ShmRwLock* self, DWORD timeout_ms) {
+    if (self->reads_held > 0) {
+        if (self->verbose) {
+            printf("Failed to acquire write lock: read lock is held by this handle\n");
+        }
+        return false;
+    }
+
+    unsigned long long start_time = ipc_now_ms();
+    if (!self->writer.acquire(&self->writer, timeout_ms)) {
+        return false;
+    }
+    self->recovered = self->writer.recovered;
+
+    if (self->state == NULL) {
+        return true;
+    }
+
+    // The flag may already be set if we took over from a dead writer
+    uint32_t current;
+    do {
+        current = ipc_atomic_load_u32(self->state);
+    } while (!(current & SHM_RWLOCK_WRITER) &&
+        !ipc_atomic_cas_u32(self->state, current, current | SHM_RWLOCK_WRITER));
+
+    while ((current = ipc_atomic_load_u32(self->state)) != SHM_RWLOCK_WRITER) {
+        unsigned long long elapsed = ipc_now_ms() - start_time;
+        if (elapsed >= timeout_ms) {
+            if (self->verbose) {
+                printf("Failed to acquire write lock: %u readers still active\n",
+                    current & ~SHM_RWLOCK_WRITER);
+            }
+            clear_writer_flag(self);
+            self->writer.release(&self->writer);
+            return false;
+        }
+
+        DWORD slice = timeout_ms - (DWORD)elapsed;
+        ipc_futex_wait(self->state, current, slice < 100 ? slice : 100);
+    }
+
+    return true;
+}
+
+bool ShmRwLock_release_write(ShmRwLock* self) {
+    if (!self->writer.held) {
+        if (self->verbose) {
+            printf("No lock to release\n");
+        }
+        return false;
+    }
+
+    if (self->state != NULL) {
+        clear_writer_flag(self);
+    }
+    return self->writer.release(&self->writer);
+}
+
+void ShmRwLock_close(ShmRwLock* self) {
+    while (self->reads_held > 0) {
+        ShmRwLock_release_read(self);
+    }
+    if (self->writer.held) {
+        ShmRwLock_release_write(self);
+    }
+
+    self->state = NULL;
+    self->writer.close(&self->writer);
+}
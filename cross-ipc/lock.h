@@ -2,13 +2,17 @@
 #ifndef LOCK_H
 #define LOCK_H
 
-#include <windows.h>
 #include <stdbool.h>
+#include "platform.h"
 
 typedef struct FileLock {
     // Data members
     char* lock_path;
+#ifdef _WIN32
     HANDLE lock_handle;
+#else
+    int lock_fd;
+#endif
     bool verbose;
 
     // Method pointers
@@ -25,4 +29,84 @@ bool FileLock_acquire(FileLock* self, DWORD timeout_ms);
 bool FileLock_release(FileLock* self);
 void FileLock_close(FileLock* self);
 
+// Futex-style wait/wake on a word in shared memory. On Linux these are real
+// cross-process futex calls; elsewhere waiting falls back to short sleeps and
+// waking does nothing, so callers that must block on Windows bring their own
+// kernel object (see wait_for_change).
+bool ipc_futex_wait(volatile uint32_t* addr, uint32_t expected, DWORD timeout_ms);
+void ipc_futex_wake(volatile uint32_t* addr, int count);
+
+// Process identity for dead-owner checks. A pid alone can be recycled, so
+// owners also record a token taken from the process start time, and the pid
+// namespace the pid belongs to. Either is 0 where the platform cannot tell.
+uint32_t ipc_process_token(uint32_t pid);
+uint32_t ipc_pid_namespace(void);
+// False only when `pid` is known to have exited or to now name a process
+// other than the one `token` was taken from. A pid from another namespace
+// cannot be checked and counts as alive.
+bool ipc_process_alive(uint32_t pid, uint32_t token, uint32_t ns);
+
+#define SHM_MUTEX_WAITERS 0x80000000u  // Set in the lock word while someone sleeps on it
+#define SHM_MUTEX_SPIN_COUNT 100       // Userspace attempts before blocking
+
+// Process-shared mutex whose state lives in a shared memory word. The word
+// holds the owner's pid (0 when free), and the two owner words next to it
+// its start-time token and pid namespace; a waiter that finds the owner has
+// died takes the lock over and reports it through `recovered`.
+typedef struct ShmMutex {
+    // Data members
+    volatile uint32_t* word;  // Points into the segment header once mapped
+    volatile uint32_t* owner; // Owner token and namespace, 0 while unknown
+#ifdef _WIN32
+    HANDLE mutex_handle;      // Named kernel mutex, abandoned when its owner dies
+#endif
+    bool held;
+    bool recovered;           // Last acquire took over from a dead owner
+    bool verbose;
+
+    // Method pointers
+    bool (*acquire)(struct ShmMutex* self, DWORD timeout_ms);
+    bool (*release)(struct ShmMutex* self);
+    void (*close)(struct ShmMutex* self);
+} ShmMutex;
+
+// Constructor
+void ShmMutex_init(ShmMutex* mutex, const char* name, bool verbose);
+
+// Method implementations
+bool ShmMutex_acquire(ShmMutex* self, DWORD timeout_ms);
+bool ShmMutex_release(ShmMutex* self);
+void ShmMutex_close(ShmMutex* self);
+
+#define SHM_RWLOCK_WRITER 0x80000000u  // Set in the state word while a writer waits or holds
+
+// Writer-preferring reader-writer lock. Writers serialize on an ShmMutex and
+// then raise SHM_RWLOCK_WRITER, which stops new readers and waits for the
+// reader count in the low bits to drain.
+typedef struct ShmRwLock {
+    // Data members
+    ShmMutex writer;
+    volatile uint32_t* state;  // Reader count | SHM_RWLOCK_WRITER
+    unsigned int reads_held;   // Read locks taken through this handle
+    bool recovered;            // Last acquire cleaned up after a dead writer
+    bool verbose;
+
+    // Method pointers
+    bool (*acquire_read)(struct ShmRwLock* self, DWORD timeout_ms);
+    bool (*release_read)(struct ShmRwLock* self);
+    bool (*acquire_write)(struct ShmRwLock* self, DWORD timeout_ms);
+    bool (*release_write)(struct ShmRwLock* self);
+    void (*close)(struct ShmRwLock* self);
+} ShmRwLock;
+
+// Constructor
+void ShmRwLock_init(ShmRwLock* lock, const char* name, bool verbose);
+
+// Method implementations
+bool ShmRwLock_acquire_read(ShmRwLock* self, DWORD timeout_ms);
+bool ShmRwLock_release_read(ShmRwLock* self);
+bool ShmRwLock_acquire_write(ShmRwLock* self, DWORD timeout_ms);
+bool ShmRwLock_release_write(ShmRwLock* self);
+void ShmRwLock_close(ShmRwLock* self);
+
 #endif // LOCK_H
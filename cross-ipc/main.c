@@ -194,10 +194,16 @@ void StoreDictPattern_sender() {
     printf("Stored 3 key-value pairs in the dictionary.\n");
 
     
-    printf("Dictionary contains %zu keys:\n", store.entry_count);
-    for (size_t i = 0; i < store.entry_count; i++) {
-        printf("  %s: %s\n", store.entries[i].key, (char*)store.entries[i].value);
+    size_t key_count = 0;
+    char** keys = store.list_keys(&store, &key_count);
+    printf("Dictionary contains %zu keys:\n", key_count);
+    for (size_t i = 0; i < key_count; i++) {
+        char* value = store.retrieve_string(&store, keys[i]);
+        printf("  %s: %s\n", keys[i], value ? value : "(missing)");
+        free(value);
+        free(keys[i]);
     }
+    free(keys);
 
     printf("\n=================================================\n");
     printf("IMPORTANT: KEEP THIS WINDOW OPEN!\n");
@@ -228,10 +234,16 @@ void StoreDictPattern_receiver() {
     store.setup(&store);
 
     // List all keys
-    printf("Dictionary contains %zu keys:\n", store.entry_count);
-    for (size_t i = 0; i < store.entry_count; i++) {
-        printf("  %s: %s\n", store.entries[i].key, (char*)store.entries[i].value);
+    size_t key_count = 0;
+    char** keys = store.list_keys(&store, &key_count);
+    printf("Dictionary contains %zu keys:\n", key_count);
+    for (size_t i = 0; i < key_count; i++) {
+        char* value = store.retrieve_string(&store, keys[i]);
+        printf("  %s: %s\n", keys[i], value ? value : "(missing)");
+        free(value);
+        free(keys[i]);
     }
+    free(keys);
 
     printf("\nAdding a new key 'response'...\n");
     store.store_string(&store, "response", "Hello from the receiver!");
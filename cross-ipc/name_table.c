@@ -0,0 +1,176 @@
+#include "name_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NAME_TABLE_SSE2 1
+#endif
+
+#define NAME_TABLE_INITIAL_SLOTS 16
+
+uint64_t ipc_name_hash(const char* text, uint32_t* out_len) {
+    uint64_t hash = 14695981039346656037ULL;
+    const unsigned char* p = (const unsigned char*)text;
+    while (*p) {
+        hash ^= *p++;
+        hash *= 1099511628211ULL;
+    }
+    *out_len = (uint32_t)(p - (const unsigned char*)text) + 1;
+    return hash;
+}
+
+void ipc_name_make(IpcName* name, const char* text) {
+    name->hash = ipc_name_hash(text, &name->len);
+    name->id = -1;
+    name->text = text;
+}
+
+bool ipc_name_equal(const void* a, const void* b, size_t len) {
+    const unsigned char* x = (const unsigned char*)a;
+    const unsigned char* y = (const unsigned char*)b;
+
+#ifdef NAME_TABLE_SSE2
+    // Unaligned loads never reach past `len`; the tail falls through to memcmp
+    while (len >= 16) {
+        __m128i lhs = _mm_loadu_si128((const __m128i*)x);
+        __m128i rhs = _mm_loadu_si128((const __m128i*)y);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) != 0xFFFF) {
+            return false;
+        }
+        x += 16;
+        y += 16;
+        len -= 16;
+    }
+#endif
+    return memcmp(x, y, len) == 0;
+}
+
+void ipc_names_init(IpcNameTable* table) {
+    memset(table, 0, sizeof(*table));
+}
+
+void ipc_names_free(IpcNameTable* table) {
+    for (uint32_t i = 0; i < table->count; i++) {
+        free(table->names[i]);
+    }
+    free(table->slots);
+    free(table->names);
+    memset(table, 0, sizeof(*table));
+}
+
+static uint32_t slot_for(const IpcNameTable* table, const IpcName* name) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = (uint32_t)name->hash & mask;
+    for (;;) {
+        IpcName* slot = table->slots[i];
+        if (!slot || (slot->hash == name->hash && slot->len == name->len &&
+                ipc_name_equal(slot->text, name->text, name->len))) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// Keeps the slots at most half full
+static bool reserve_slots(IpcNameTable* table, uint32_t needed) {
+    if ((uint64_t)needed * 2 <= table->capacity) {
+        return true;
+    }
+
+    uint32_t capacity = table->capacity ? table->capacity : NAME_TABLE_INITIAL_SLOTS;
+    while ((uint64_t)needed * 2 > capacity) {
+        capacity *= 2;
+    }
+
+    IpcName** slots = (IpcName**)calloc(capacity, sizeof(IpcName*));
+    if (!slots) {
+        return false;
+    }
+    for (uint32_t i = 0; i < table->count; i++) {
+        IpcName* name = table->names[i];
+        uint32_t j = (uint32_t)name->hash & (capacity - 1);
+        while (slots[j]) {
+            j = (j + 1) & (capacity - 1);
+        }
+        slots[j] = name;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    return true;
+}
+
+const IpcName* ipc_names_find_name(const IpcNameTable* table, const IpcName* name) {
+    if (table->count == 0) {
+        return NULL;
+    }
+    return table->slots[slot_for(table, name)];
+}
+
+const IpcName* ipc_names_find(const IpcNameTable* table, const char* text) {
+    IpcName name;
+    ipc_name_make(&name, text);
+    return ipc_names_find_name(table, &name);
+}
+
+const IpcName* ipc_names_intern(IpcNameTable* table, const char* text) {
+    IpcName probe;
+    ipc_name_make(&probe, text);
+
+    const IpcName* existing = ipc_names_find_name(table, &probe);
+    if (existing) {
+        return existing;
+    }
+    if (table->count >= INT32_MAX || !reserve_slots(table, table->count + 1)) {
+        return NULL;
+    }
+
+    if (table->count >= table->names_capacity) {
+        uint32_t capacity = table->names_capacity ? table->names_capacity * 2 : NAME_TABLE_INITIAL_SLOTS;
+        IpcName** names = (IpcName**)realloc(table->names, capacity * sizeof(IpcName*));
+        if (!names) {
+            return NULL;
+        }
+        table->names = names;
+        table->names_capacity = capacity;
+    }
+
+    // The text lives right behind the entry
+    IpcName* name = (IpcName*)malloc(sizeof(IpcName) + probe.len);
+    if (!name) {
+        return NULL;
+    }
+    memcpy(name + 1, text, probe.len);
+    name->hash = probe.hash;
+    name->len = probe.len;
+    name->id = (int32_t)table->count;
+    name->text = (const char*)(name + 1);
+
+    table->slots[slot_for(table, name)] = name;
+    table->names[table->count++] = name;
+    return name;
+}
+
+void ipc_names_drop_last(IpcNameTable* table) {
+    if (table->count == 0) {
+        return;
+    }
+
+    IpcName* name = table->names[--table->count];
+    uint32_t mask = table->capacity - 1;
+    uint32_t hole = slot_for(table, name);
+    table->slots[hole] = NULL;
+
+    // Shift later members of the probe chain back so none is cut off
+    for (uint32_t i = (hole + 1) & mask; table->slots[i]; i = (i + 1) & mask) {
+        uint32_t home = (uint32_t)table->slots[i]->hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            table->slots[hole] = table->slots[i];
+            table->slots[i] = NULL;
+            hole = i;
+        }
+    }
+    free(name);
+}
@@ -0,0 +1,57 @@
+#pragma once
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Interned names for the patterns that look things up by string: StoreDict
+// keys, PubSub topics and ReqResp pipe ids. A name is hashed once, when it is
+// resolved, and compared with SSE2 only when the hashes already agree.
+// Callers that resolve a name up front can hand the IpcName to the
+// *_resolved calls and skip hashing and the table lookup altogether.
+
+// A resolved name. Interned names own their text and never move, so a
+// pointer to one stays valid until the table is freed.
+typedef struct IpcName {
+    uint64_t hash;     // FNV-1a over the text; StoreDict keeps the same hash in its buckets
+    uint32_t len;      // Length including the terminator
+    int32_t id;        // Position in the table that interned it, or -1
+    const char* text;
+} IpcName;
+
+typedef struct IpcNameTable {
+    IpcName** slots;   // Open addressing, NULL for unused
+    uint32_t capacity; // Power of two
+    uint32_t count;
+    IpcName** names;   // By id, in interning order
+    uint32_t names_capacity;
+} IpcNameTable;
+
+// FNV-1a over `text`, also returning its length including the terminator
+uint64_t ipc_name_hash(const char* text, uint32_t* out_len);
+
+// Fills `name` for `text` without copying it; the result is only as
+// long-lived as `text`
+void ipc_name_make(IpcName* name, const char* text);
+
+// Compares `len` bytes, 16 at a time where SSE2 is available
+bool ipc_name_equal(const void* a, const void* b, size_t len);
+
+void ipc_names_init(IpcNameTable* table);
+void ipc_names_free(IpcNameTable* table);
+
+// Returns the interned copy of `text`, adding it if needed, or NULL when
+// out of memory. Ids are handed out densely from 0.
+const IpcName* ipc_names_intern(IpcNameTable* table, const char* text);
+
+// Forgets the most recently interned name, for callers whose own setup
+// failed after interning it. Its IpcName is freed.
+void ipc_names_drop_last(IpcNameTable* table);
+
+// Returns the interned copy of `text`, or NULL if it was never interned
+const IpcName* ipc_names_find(const IpcNameTable* table, const char* text);
+const IpcName* ipc_names_find_name(const IpcNameTable* table, const IpcName* name);
+
+#endif // NAME_TABLE_H
@@ -0,0 +1,258 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "numa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#ifdef _WIN32
+int ipc_numa_node_count(void) {
+    ULONG highest = 0;
+    if (!GetNumaHighestNodeNumber(&highest)) {
+        return 1;
+    }
+    return (int)highest + 1;
+}
+
+int ipc_numa_current_node(void) {
+    PROCESSOR_NUMBER processor;
+    USHORT node = 0;
+
+    GetCurrentProcessorNumberEx(&processor);
+    if (!GetNumaProcessorNodeEx(&processor, &node)) {
+        return 0;
+    }
+    return (int)node;
+}
+
+int ipc_numa_current_cpu(void) {
+    return (int)GetCurrentProcessorNumber();
+}
+#else
+#define NUMA_ONLINE_NODES "/sys/devices/system/node/online"
+#define NUMA_MAX_NODES 256
+
+// From <numaif.h>, which is not always installed
+#define IPC_MPOL_PREFERRED 1
+#define IPC_MPOL_INTERLEAVE 3
+#define IPC_MPOL_MF_MOVE (1 << 1)
+
+#define MASK_BITS (8 * sizeof(unsigned long))
+
+// Parses the online node list ("0", "0-1", "0,2-3") into `mask`.
+// Returns the highest node number plus one, or 1 when it cannot be read.
+static int read_online_nodes(unsigned long* mask) {
+    memset(mask, 0, NUMA_MAX_NODES / 8);
+
+    FILE* file = fopen(NUMA_ONLINE_NODES, "r");
+    if (!file) {
+        mask[0] = 1;
+        return 1;
+    }
+
+    char list[256] = { 0 };
+    bool read = fgets(list, sizeof(list), file) != NULL;
+    fclose(file);
+    if (!read) {
+        mask[0] = 1;
+        return 1;
+    }
+
+    int highest = 0;
+    char* cursor = list;
+    while (*cursor >= '0' && *cursor <= '9') {
+        int first = (int)strtol(cursor, &cursor, 10);
+        int last = first;
+        if (*cursor == '-') {
+            last = (int)strtol(cursor + 1, &cursor, 10);
+        }
+
+        for (int node = first; node <= last && node < NUMA_MAX_NODES; node++) {
+            mask[node / MASK_BITS] |= 1UL << (node % MASK_BITS);
+            if (node > highest) {
+                highest = node;
+            }
+        }
+
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+    return highest + 1;
+}
+
+int ipc_numa_node_count(void) {
+    unsigned long mask[NUMA_MAX_NODES / MASK_BITS];
+    return read_online_nodes(mask);
+}
+
+int ipc_numa_current_node(void) {
+#ifdef SYS_getcpu
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) {
+        return (int)node;
+    }
+#endif
+    return 0;
+}
+
+int ipc_numa_current_cpu(void) {
+#ifdef SYS_getcpu
+    unsigned int cpu = 0;
+    if (syscall(SYS_getcpu, &cpu, NULL, NULL) == 0) {
+        return (int)cpu;
+    }
+#endif
+    return 0;
+}
+#endif
+
+int ipc_numa_target_node(ShmNumaPolicy policy, int node) {
+    switch (policy) {
+    case SHM_NUMA_PREFERRED:
+        return node;
+    case SHM_NUMA_CONSUMER:
+        return node >= 0 ? node : ipc_numa_current_node();
+    default:
+        return -1;
+    }
+}
+
+#ifdef _WIN32
+void* ipc_numa_map_view(HANDLE section, DWORD access, size_t map_size, ShmNumaPolicy policy, int node, bool* out_applied) {
+    int target = ipc_numa_target_node(policy, node);
+    *out_applied = false;
+
+    if (target >= 0 && target < ipc_numa_node_count() && ipc_numa_node_count() > 1) {
+        void* view = MapViewOfFileExNuma(section, access, 0, 0, map_size, NULL, (DWORD)target);
+        if (view != NULL) {
+            *out_applied = true;
+            return view;
+        }
+    }
+
+    // Single-node machines, interleave and failures all get an ordinary view
+    return MapViewOfFile(section, access, 0, 0, map_size);
+}
+#else
+bool ipc_numa_place(void* addr, size_t length, ShmNumaPolicy policy, int node) {
+#ifdef SYS_mbind
+    unsigned long mask[NUMA_MAX_NODES / MASK_BITS];
+    int node_count = read_online_nodes(mask);
+
+    // Nothing to choose between on a single node
+    if (policy == SHM_NUMA_DEFAULT || node_count <= 1) {
+        return false;
+    }
+
+    int mode = IPC_MPOL_INTERLEAVE;
+    if (policy != SHM_NUMA_INTERLEAVE) {
+        int target = ipc_numa_target_node(policy, node);
+        if (target < 0 || target >= node_count || !(mask[target / MASK_BITS] & (1UL << (target % MASK_BITS)))) {
+            return false;
+        }
+        memset(mask, 0, sizeof(mask));
+        mask[target / MASK_BITS] = 1UL << (target % MASK_BITS);
+        mode = IPC_MPOL_PREFERRED;
+    }
+
+    // MOVE migrates pages this process already faulted; pages shared with
+    // others stay put, but every later fault follows the policy
+    return syscall(SYS_mbind, addr, length, mode, mask, (unsigned long)NUMA_MAX_NODES + 1, IPC_MPOL_MF_MOVE) == 0;
+#else
+    (void)addr;
+    (void)length;
+    (void)policy;
+    (void)node;
+    return false;
+#endif
+}
+#endif
+
+// Samples pages evenly across the range and reports which node holds them.
+// Pages that are not resident yet are skipped.
+void ipc_numa_fill_stats(ShmNumaStats* stats, const void* addr, size_t length,
+    ShmNumaPolicy policy, int node, bool applied) {
+    stats->node_count = ipc_numa_node_count();
+    stats->policy = (int)policy;
+    stats->node = ipc_numa_target_node(policy, node);
+    stats->applied = applied;
+    stats->resident_node = -1;
+    stats->resident_nodes = 0;
+
+    if (!addr || length == 0) {
+        return;
+    }
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    size_t page_size = info.dwPageSize;
+#else
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+
+    size_t page_count = (length + page_size - 1) / page_size;
+    size_t samples = page_count < SHM_NUMA_SAMPLE_PAGES ? page_count : SHM_NUMA_SAMPLE_PAGES;
+    int nodes[SHM_NUMA_SAMPLE_PAGES];
+    size_t found = 0;
+
+#ifdef _WIN32
+    PSAPI_WORKING_SET_EX_INFORMATION pages[SHM_NUMA_SAMPLE_PAGES];
+    for (size_t i = 0; i < samples; i++) {
+        pages[i].VirtualAddress = (PVOID)((const unsigned char*)addr + (i * page_count / samples) * page_size);
+    }
+    if (QueryWorkingSetEx(GetCurrentProcess(), pages, (DWORD)(samples * sizeof(pages[0])))) {
+        for (size_t i = 0; i < samples; i++) {
+            if (pages[i].VirtualAttributes.Valid) {
+                nodes[found++] = (int)pages[i].VirtualAttributes.Node;
+            }
+        }
+    }
+#elif defined(SYS_move_pages)
+    void* pages[SHM_NUMA_SAMPLE_PAGES];
+    int status[SHM_NUMA_SAMPLE_PAGES];
+    for (size_t i = 0; i < samples; i++) {
+        pages[i] = (void*)((const unsigned char*)addr + (i * page_count / samples) * page_size);
+    }
+    // With no target nodes move_pages only reports where each page is
+    if (syscall(SYS_move_pages, 0, (unsigned long)samples, pages, NULL, status, 0) == 0) {
+        for (size_t i = 0; i < samples; i++) {
+            if (status[i] >= 0) {
+                nodes[found++] = status[i];
+            }
+        }
+    }
+#endif
+
+    // Majority vote; the sample is small enough for a quadratic count
+    int best_count = 0;
+    for (size_t i = 0; i < found; i++) {
+        int count = 0;
+        bool seen = false;
+        for (size_t j = 0; j < found; j++) {
+            if (nodes[j] == nodes[i]) {
+                count++;
+                seen = seen || j < i;
+            }
+        }
+        if (!seen) {
+            stats->resident_nodes++;
+        }
+        if (count > best_count) {
+            best_count = count;
+            stats->resident_node = nodes[i];
+        }
+    }
+}
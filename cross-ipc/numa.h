@@ -0,0 +1,52 @@
+#pragma once
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "platform.h"
+
+// Where the physical pages of a segment should live. Without a policy the
+// first process to touch a page decides, which is usually the producer.
+typedef enum ShmNumaPolicy {
+    SHM_NUMA_DEFAULT = 0,     // Leave placement to the OS (first touch)
+    SHM_NUMA_PREFERRED = 1,   // Prefer the given node, spill elsewhere when it is full
+    SHM_NUMA_INTERLEAVE = 2,  // Spread pages round-robin over all nodes
+    SHM_NUMA_CONSUMER = 3     // Prefer the node the attaching process is running on
+} ShmNumaPolicy;
+
+// Placement report for a mapped segment
+typedef struct ShmNumaStats {
+    int node_count;       // Nodes on this machine; 1 when NUMA is unavailable
+    int policy;           // ShmNumaPolicy that was requested
+    int node;             // Target node (resolved for SHM_NUMA_CONSUMER), -1 if none
+    bool applied;         // The OS accepted the policy
+    int resident_node;    // Node holding most sampled resident pages, -1 if none are resident
+    int resident_nodes;   // Distinct nodes seen among the sampled pages
+} ShmNumaStats;
+
+#define SHM_NUMA_SAMPLE_PAGES 64  // Pages inspected by ipc_numa_fill_stats
+
+int ipc_numa_node_count(void);
+int ipc_numa_current_node(void);
+// Processor the calling thread is running on right now, 0 if unknown
+int ipc_numa_current_cpu(void);
+
+// Resolves SHM_NUMA_CONSUMER to the calling process's node unless `node`
+// already holds one. Returns -1 when the policy has no single target node.
+int ipc_numa_target_node(ShmNumaPolicy policy, int node);
+
+#ifdef _WIN32
+// Windows picks the node when a view is mapped, so placement replaces
+// MapViewOfFile. Interleaving is not available for sections.
+void* ipc_numa_map_view(HANDLE section, DWORD access, size_t map_size, ShmNumaPolicy policy, int node, bool* out_applied);
+#else
+// Binds `length` bytes at `addr` (page aligned) before they are faulted in.
+// Only shmem/tmpfs mappings share the policy with other processes.
+bool ipc_numa_place(void* addr, size_t length, ShmNumaPolicy policy, int node);
+#endif
+
+void ipc_numa_fill_stats(ShmNumaStats* stats, const void* addr, size_t length,
+    ShmNumaPolicy policy, int node, bool applied);
+
+#endif // NUMA_H
@@ -0,0 +1,189 @@
+#pragma once
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// Small compatibility layer so the shared memory transport can be built on
+// both Windows and POSIX systems. The pattern modules remain Windows-only.
+
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+// Same layout as the POSIX struct, for SharedMemory_writev
+struct iovec {
+    void* iov_base;
+    size_t iov_len;
+};
+#else
+#include <sys/uio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef unsigned long DWORD;
+
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
+#define _strdup strdup
+#define sprintf_s snprintf
+#endif
+
+#include <stdbool.h>
+
+#ifdef _MSC_VER
+#define IPC_INLINE static __inline
+#else
+#define IPC_INLINE static inline
+#endif
+
+// Monotonic millisecond clock, used for lock timeouts
+IPC_INLINE unsigned long long ipc_now_ms(void) {
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + (unsigned long long)(ts.tv_nsec / 1000000);
+#endif
+}
+
+// Wall-clock milliseconds since the Unix epoch. Unlike ipc_now_ms it means
+// the same thing in every process and across reboots, so deadlines stored
+// in a segment or a snapshot use it; it can step when the clock is set.
+IPC_INLINE unsigned long long ipc_wall_ms(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    unsigned long long ticks = ((unsigned long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (ticks - 116444736000000000ULL) / 10000ULL;  // 100 ns ticks since 1601
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000ULL + (unsigned long long)(ts.tv_nsec / 1000000);
+#endif
+}
+
+IPC_INLINE void ipc_sleep_ms(DWORD ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+IPC_INLINE void ipc_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+// Atomics on words that live in shared memory. Loads have acquire and
+// stores release semantics; read-modify-write operations are full barriers.
+IPC_INLINE uint32_t ipc_atomic_load_u32(volatile uint32_t* ptr) {
+#ifdef _WIN32
+    return (uint32_t)ReadAcquire((volatile LONG*)ptr);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+IPC_INLINE void ipc_atomic_store_u32(volatile uint32_t* ptr, uint32_t value) {
+#ifdef _WIN32
+    WriteRelease((volatile LONG*)ptr, (LONG)value);
+#else
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Returns the value held before the addition
+IPC_INLINE uint32_t ipc_atomic_fetch_add_u32(volatile uint32_t* ptr, uint32_t value) {
+#ifdef _WIN32
+    return (uint32_t)InterlockedExchangeAdd((volatile LONG*)ptr, (LONG)value);
+#else
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+IPC_INLINE bool ipc_atomic_cas_u32(volatile uint32_t* ptr, uint32_t expected, uint32_t desired) {
+#ifdef _WIN32
+    return (uint32_t)InterlockedCompareExchange((volatile LONG*)ptr, (LONG)desired, (LONG)expected) == expected;
+#else
+    return __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Returns the value held before the OR
+IPC_INLINE uint32_t ipc_atomic_fetch_or_u32(volatile uint32_t* ptr, uint32_t value) {
+#ifdef _WIN32
+    return (uint32_t)InterlockedOr((volatile LONG*)ptr, (LONG)value);
+#else
+    return __atomic_fetch_or(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Returns the value that was replaced
+IPC_INLINE uint32_t ipc_atomic_exchange_u32(volatile uint32_t* ptr, uint32_t value) {
+#ifdef _WIN32
+    return (uint32_t)InterlockedExchange((volatile LONG*)ptr, (LONG)value);
+#else
+    return __atomic_exchange_n(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// 64-bit variants for counters; `ptr` must be 8-byte aligned
+IPC_INLINE int64_t ipc_atomic_load_i64(volatile int64_t* ptr) {
+#ifdef _WIN32
+    return (int64_t)ReadAcquire64((volatile LONG64*)ptr);
+#else
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// Returns the value held before the addition
+IPC_INLINE int64_t ipc_atomic_fetch_add_i64(volatile int64_t* ptr, int64_t value) {
+#ifdef _WIN32
+    return (int64_t)InterlockedExchangeAdd64((volatile LONG64*)ptr, (LONG64)value);
+#else
+    return __atomic_fetch_add(ptr, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Returns the value held before the exchange; it took place if that equals `expected`
+IPC_INLINE int64_t ipc_atomic_cmpxchg_i64(volatile int64_t* ptr, int64_t expected, int64_t desired) {
+#ifdef _WIN32
+    return (int64_t)InterlockedCompareExchange64((volatile LONG64*)ptr, (LONG64)desired, (LONG64)expected);
+#else
+    __atomic_compare_exchange_n(ptr, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return expected;
+#endif
+}
+
+IPC_INLINE void ipc_cpu_relax(void) {
+#if defined(_MSC_VER)
+    YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+IPC_INLINE void ipc_atomic_fence(void) {
+#ifdef _WIN32
+    MemoryBarrier();
+#else
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+}
+
+#endif // PLATFORM_H
@@ -15,6 +15,9 @@ static unsigned char* pack_message(const unsigned char* payload, size_t payload_
 static bool unpack_message(const unsigned char* data, size_t data_size, uint32_t* out_msg_id, unsigned char** out_payload, size_t* out_payload_size);
 static unsigned __stdcall polling_thread_func(void* arg);
 
+// Upper bound on how long an idle polling thread sleeps before rechecking running
+#define POLL_STOP_CHECK_MS 100
+
 
 void PubSubPattern_init(PubSubPattern* pubsub, const char* name, size_t size, bool verbose) {
     
@@ -24,6 +27,7 @@ void PubSubPattern_init(PubSubPattern* pubsub, const char* name, size_t size, bo
     pubsub->topics = NULL;
     pubsub->topic_count = 0;
     pubsub->topic_capacity = 0;
+    ipc_names_init(&pubsub->topic_names);
     pubsub->running = false;
     pubsub->polling_thread = NULL;
     pubsub->message_counter = 0;
@@ -33,6 +37,8 @@ void PubSubPattern_init(PubSubPattern* pubsub, const char* name, size_t size, bo
     pubsub->setup = PubSubPattern_setup;
     pubsub->publish = PubSubPattern_publish;
     pubsub->publish_string = PubSubPattern_publish_string;
+    pubsub->resolve_topic = PubSubPattern_resolve_topic;
+    pubsub->publish_resolved = PubSubPattern_publish_resolved;
     pubsub->subscribe = PubSubPattern_subscribe;
     pubsub->create_topic = PubSubPattern_create_topic;
     pubsub->close = PubSubPattern_close;
@@ -87,6 +93,31 @@ void PubSubPattern_publish_string(PubSubPattern* self, const char* topic, const
     self->publish(self, topic, (const unsigned char*)message, strlen(message) + 1);
 }
 
+const IpcName* PubSubPattern_resolve_topic(PubSubPattern* self, const char* topic) {
+    return self->store.resolve(&self->store, topic);
+}
+
+bool PubSubPattern_publish_resolved(PubSubPattern* self, const IpcName* topic, const unsigned char* message, size_t message_size) {
+    self->message_counter = (self->message_counter + 1) % 0xFFFFFFFF;
+
+    size_t packed_size;
+    unsigned char* packed_message = pack_message(message, message_size, self->message_counter, &packed_size);
+    if (!packed_message) {
+        if (self->verbose) {
+            printf("Failed to pack message for topic '%s'\n", topic->text);
+        }
+        return false;
+    }
+
+    bool stored = self->store.store_resolved(&self->store, topic, packed_message, packed_size);
+    free(packed_message);
+
+    if (self->verbose) {
+        printf("Published message to topic '%s' with ID %u\n", topic->text, self->message_counter);
+    }
+    return stored;
+}
+
 void PubSubPattern_subscribe(PubSubPattern* self, const char* topic, MessageHandler handler, void* user_data) {
     
     Topic* topic_obj = find_topic(self, topic);
@@ -155,6 +186,7 @@ void PubSubPattern_close(PubSubPattern* self) {
     }
 
     free(self->topics);
+    ipc_names_free(&self->topic_names);
     self->topics = NULL;
     self->topic_count = 0;
     self->topic_capacity = 0;
@@ -166,12 +198,8 @@ void PubSubPattern_close(PubSubPattern* self) {
 
 
 static Topic* find_topic(PubSubPattern* self, const char* topic_name) {
-    for (size_t i = 0; i < self->topic_count; i++) {
-        if (strcmp(self->topics[i].name, topic_name) == 0) {
-            return &self->topics[i];
-        }
-    }
-    return NULL;
+    const IpcName* key = ipc_names_find(&self->topic_names, topic_name);
+    return key ? &self->topics[key->id] : NULL;
 }
 
 static Topic* create_topic_internal(PubSubPattern* self, const char* topic_name) {
@@ -188,9 +216,16 @@ static Topic* create_topic_internal(PubSubPattern* self, const char* topic_name)
         self->topic_capacity = new_capacity;
     }
 
+    // Interned only once the slot exists, so ids and indices stay in step
+    const IpcName* key = ipc_names_intern(&self->topic_names, topic_name);
+    if (!key) {
+        return NULL;
+    }
+
     // Initialize the new topic
     Topic* topic = &self->topics[self->topic_count++];
     topic->name = _strdup(topic_name);
+    topic->key = key;
     topic->subscribers = NULL;
     topic->subscriber_count = 0;
     topic->subscriber_capacity = 0;
@@ -334,8 +369,21 @@ static bool unpack_message(const unsigned char* data, size_t data_size, uint32_t
 static unsigned __stdcall polling_thread_func(void* arg) {
     PubSubPattern* self = (PubSubPattern*)arg;
 
+    uint32_t sequence = self->store.shm.get_sequence(&self->store.shm);
+    bool first_pass = true;
+
     while (self->running) {
-        
+        // Block until a write lands (publishes from this process included),
+        // and skip the scan entirely when nothing was written. This leans on
+        // wait_for_change really sleeping in the kernel (futex on Linux, the
+        // segment's change semaphore on Windows); the timeout only bounds how
+        // long close() waits for the thread to notice running went false.
+        if (!first_pass &&
+            !self->store.shm.wait_for_change(&self->store.shm, sequence, POLL_STOP_CHECK_MS, &sequence)) {
+            continue;
+        }
+        first_pass = false;
+
         self->store.load(&self->store);
 
         // Get all keys (topics)
@@ -358,7 +406,7 @@ static unsigned __stdcall polling_thread_func(void* arg) {
 
                 
                 size_t data_size;
-                unsigned char* data = self->store.retrieve(&self->store, topic_name, &data_size);
+                unsigned char* data = self->store.retrieve_resolved(&self->store, topic->key, &data_size);
 
                 if (data && data_size >= 8) {  
                     
@@ -396,9 +444,6 @@ static unsigned __stdcall polling_thread_func(void* arg) {
             }
             free(keys);
         }
-
-        // Sleep for a longer time to reduce CPU usage
-        Sleep(100);  
     }
 
     return 0;
@@ -19,6 +19,7 @@ typedef struct {
 // Topic structure
 typedef struct {
     char* name;
+    const IpcName* key;  // Interned in topic_names; its id is the topic's index
     Subscriber* subscribers;
     size_t subscriber_count;
     size_t subscriber_capacity;
@@ -34,6 +35,7 @@ typedef struct PubSubPattern {
     Topic* topics;
     size_t topic_count;
     size_t topic_capacity;
+    IpcNameTable topic_names;
     bool running;
     HANDLE polling_thread;
     uint32_t message_counter;
@@ -43,6 +45,8 @@ typedef struct PubSubPattern {
     bool (*setup)(struct PubSubPattern* self);
     void (*publish)(struct PubSubPattern* self, const char* topic, const unsigned char* message, size_t message_size);
     void (*publish_string)(struct PubSubPattern* self, const char* topic, const char* message);
+    const IpcName* (*resolve_topic)(struct PubSubPattern* self, const char* topic);
+    bool (*publish_resolved)(struct PubSubPattern* self, const IpcName* topic, const unsigned char* message, size_t message_size);
     void (*subscribe)(struct PubSubPattern* self, const char* topic, MessageHandler handler, void* user_data);
     void (*create_topic)(struct PubSubPattern* self, const char* topic);
     void (*close)(struct PubSubPattern* self);
@@ -55,6 +59,9 @@ void PubSubPattern_init(PubSubPattern* pubsub, const char* name, size_t size, bo
 bool PubSubPattern_setup(PubSubPattern* self);
 void PubSubPattern_publish(PubSubPattern* self, const char* topic, const unsigned char* message, size_t message_size);
 void PubSubPattern_publish_string(PubSubPattern* self, const char* topic, const char* message);
+// Resolves a topic once for publish_resolved, which then skips hashing it
+const IpcName* PubSubPattern_resolve_topic(PubSubPattern* self, const char* topic);
+bool PubSubPattern_publish_resolved(PubSubPattern* self, const IpcName* topic, const unsigned char* message, size_t message_size);
 void PubSubPattern_subscribe(PubSubPattern* self, const char* topic, MessageHandler handler, void* user_data);
 void PubSubPattern_create_topic(PubSubPattern* self, const char* topic);
 void PubSubPattern_close(PubSubPattern* self);
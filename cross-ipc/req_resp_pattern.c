@@ -9,12 +9,8 @@
 
 
 static int find_pipe_index(ReqRespPattern* self, const char* id) {
-    for (size_t i = 0; i < self->pipe_count; i++) {
-        if (strcmp(self->pipe_ids[i], id) == 0) {
-            return (int)i;
-        }
-    }
-    return -1;
+    const IpcName* name = ipc_names_find(&self->pipe_names, id);
+    return name ? name->id : -1;
 }
 
 
@@ -68,17 +64,10 @@ static bool resize_arrays(ReqRespPattern* self, size_t new_capacity) {
 
 static unsigned __stdcall listen_for_requests(void* arg) {
     ReqRespPattern* self = ((void**)arg)[0];
-    char* id = ((void**)arg)[1];
+    int index = (int)(intptr_t)((void**)arg)[1];
+    const char* id = ((void**)arg)[2];
     free(arg); 
 
-    int index = find_pipe_index(self, id);
-    if (index < 0) {
-        if (self->verbose) {
-            printf("Error: Pipe ID '%s' not found in listener thread\n", id);
-        }
-        return 1;
-    }
-
     if (self->verbose) {
         printf("Started listener thread for pipe '%s'\n", id);
     }
@@ -189,11 +178,14 @@ void ReqRespPattern_init(ReqRespPattern* rr, bool verbose) {
     rr->listener_threads = NULL;
     rr->locks = NULL;
     rr->verbose = verbose;
+    ipc_names_init(&rr->pipe_names);
 
     // Initialize method pointers
     rr->setup_server = ReqRespPattern_setup_server;
     rr->setup_client = ReqRespPattern_setup_client;
     rr->request = ReqRespPattern_request;
+    rr->resolve = ReqRespPattern_resolve;
+    rr->request_resolved = ReqRespPattern_request_resolved;
     rr->respond = ReqRespPattern_respond;
     rr->close = ReqRespPattern_close;
 
@@ -249,6 +241,13 @@ bool ReqRespPattern_setup_server(ReqRespPattern* self, const char* id) {
         return false;
     }
 
+    // The interned id doubles as the pipe index
+    const IpcName* name = ipc_names_intern(&self->pipe_names, id);
+    if (!name) {
+        CloseHandle(pipe);
+        return false;
+    }
+
     
     self->server_pipes[self->pipe_count] = pipe;
     self->client_pipes[self->pipe_count] = INVALID_HANDLE_VALUE;
@@ -261,9 +260,12 @@ bool ReqRespPattern_setup_server(ReqRespPattern* self, const char* id) {
     self->running = true;
     
     
-    void** thread_args = (void**)malloc(2 * sizeof(void*));
+    // The pipe is only counted once its thread is running, so the thread is
+    // handed its slot instead of looking the id up
+    void** thread_args = (void**)malloc(3 * sizeof(void*));
     thread_args[0] = self;
-    thread_args[1] = self->pipe_ids[self->pipe_count];
+    thread_args[1] = (void*)(intptr_t)self->pipe_count;
+    thread_args[2] = (void*)name->text;
     
     self->listener_threads[self->pipe_count] = (HANDLE)_beginthreadex(
         NULL, 0, listen_for_requests, thread_args, 0, NULL
@@ -275,6 +277,7 @@ bool ReqRespPattern_setup_server(ReqRespPattern* self, const char* id) {
         }
         CloseHandle(pipe);
         free(self->pipe_ids[self->pipe_count]);
+        ipc_names_drop_last(&self->pipe_names);
         return false;
     }
 
@@ -340,6 +343,11 @@ bool ReqRespPattern_setup_client(ReqRespPattern* self, const char* id) {
         return false;
     }
 
+    if (!ipc_names_intern(&self->pipe_names, id)) {
+        CloseHandle(pipe);
+        return false;
+    }
+
     // Add the pipe to our arrays
     self->server_pipes[self->pipe_count] = INVALID_HANDLE_VALUE;
     self->client_pipes[self->pipe_count] = pipe;
@@ -366,6 +374,22 @@ char* ReqRespPattern_request(ReqRespPattern* self, const char* id, const char* m
         return NULL;
     }
 
+    return ReqRespPattern_request_resolved(self, index, message);
+}
+
+int ReqRespPattern_resolve(ReqRespPattern* self, const char* id) {
+    return find_pipe_index(self, id);
+}
+
+char* ReqRespPattern_request_resolved(ReqRespPattern* self, int index, const char* message) {
+    if (index < 0 || (size_t)index >= self->pipe_count) {
+        if (self->verbose) {
+            printf("Error: Pipe handle %d not found for request\n", index);
+        }
+        return NULL;
+    }
+    const char* id = self->pipe_ids[index];
+
     // Acquire the lock
     EnterCriticalSection(&self->locks[index]);
 
@@ -478,6 +502,7 @@ void ReqRespPattern_close(ReqRespPattern* self) {
         free(self->pipe_ids[i]);
         DeleteCriticalSection(&self->locks[i]);
     }
+    ipc_names_free(&self->pipe_names);
 
     free(self->server_pipes);
     free(self->client_pipes);
@@ -4,6 +4,7 @@
 
 #include <stdbool.h>
 #include <windows.h>
+#include "name_table.h"
 
 // Forward declaration
 typedef struct ReqRespPattern ReqRespPattern;
@@ -17,6 +18,7 @@ typedef struct ReqRespPattern {
     HANDLE* server_pipes;      // Array of server pipe handles
     HANDLE* client_pipes;      // Array of client pipe handles
     char** pipe_ids;           // Array of pipe IDs
+    IpcNameTable pipe_names;   // Interned pipe IDs; a name's id is its pipe index
     size_t pipe_count;         // Number of pipes
     size_t pipe_capacity;      // Capacity of pipe arrays
     RequestHandler* handlers;  // Array of handler functions
@@ -30,6 +32,8 @@ typedef struct ReqRespPattern {
     bool (*setup_server)(struct ReqRespPattern* self, const char* id);
     bool (*setup_client)(struct ReqRespPattern* self, const char* id);
     char* (*request)(struct ReqRespPattern* self, const char* id, const char* message);
+    int (*resolve)(struct ReqRespPattern* self, const char* id);
+    char* (*request_resolved)(struct ReqRespPattern* self, int pipe, const char* message);
     void (*respond)(struct ReqRespPattern* self, const char* id, RequestHandler handler, void* user_data);
     void (*close)(struct ReqRespPattern* self);
 } ReqRespPattern;
@@ -41,6 +45,10 @@ void ReqRespPattern_init(ReqRespPattern* rr, bool verbose);
 bool ReqRespPattern_setup_server(ReqRespPattern* self, const char* id);
 bool ReqRespPattern_setup_client(ReqRespPattern* self, const char* id);
 char* ReqRespPattern_request(ReqRespPattern* self, const char* id, const char* message);
+// Returns the pipe handle for `id`, or -1. Handles stay valid until close
+// and let request_resolved skip the name lookup.
+int ReqRespPattern_resolve(ReqRespPattern* self, const char* id);
+char* ReqRespPattern_request_resolved(ReqRespPattern* self, int pipe, const char* message);
 void ReqRespPattern_respond(ReqRespPattern* self, const char* id, RequestHandler handler, void* user_data);
 void ReqRespPattern_close(ReqRespPattern* self);
 
@@ -1,237 +1,1959 @@
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include "shared_memory.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <limits.h>
 
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-void SharedMemory_init(SharedMemory* shm, const char* id, size_t size, bool verbose) {
-    
-    shm->id = _strdup(id);
-    shm->size = size;
-    shm->hFile = INVALID_HANDLE_VALUE;
-    shm->hMapFile = NULL;
-    shm->pBuf = NULL;
-    shm->verbose = verbose;
+#define THP_SHMEM_SETTING "/sys/kernel/mm/transparent_hugepage/shmem_enabled"
 
-    // Create file path in temp directory
-    char temp_path[MAX_PATH];
-    GetTempPathA(MAX_PATH, temp_path);
+#define READ_RETRY_TIMEOUT_MS 1000
+#define GROW_LOCK_TIMEOUT_MS 5000  // How long grow waits for the write lock when the caller does not hold it
+
+
+static size_t mapping_size(SharedMemory* self) {
+    return SHM_HEADER_SIZE + self->size;
+}
+
+static size_t system_page_size(void) {
+    static size_t page_size = 0;
+    if (page_size == 0) {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        page_size = info.dwPageSize;
+#else
+        page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+    }
+    return page_size;
+}
+
+// Only persistent (file-backed) segments track dirty pages; the default
+// pagefile/tmpfs backing never touches the disk on the write path.
+static void resize_dirty_map(SharedMemory* self) {
+    if (!(self->options & SHM_OPTION_PERSISTENT)) {
+        return;
+    }
+
+    size_t pages = (mapping_size(self) + system_page_size() - 1) / system_page_size();
+    size_t old_words = (self->dirty_page_count + 31) / 32;
+    size_t words = (pages + 31) / 32;
+
+    uint32_t* bitmap = (uint32_t*)realloc((void*)self->dirty_pages, words * sizeof(uint32_t));
+    if (!bitmap) {
+        return;
+    }
+    if (words > old_words) {
+        memset(bitmap + old_words, 0, (words - old_words) * sizeof(uint32_t));
+    }
+
+    self->dirty_pages = bitmap;
+    self->dirty_page_count = pages;
+}
+
+// `offset` counts from the start of the mapping, header included. Bits are
+// set atomically because the flusher thread may be clearing them.
+static void mark_dirty(SharedMemory* self, size_t offset, size_t length) {
+    if (!self->dirty_pages || length == 0) {
+        return;
+    }
+
+    size_t page_size = system_page_size();
+    size_t first = offset / page_size;
+    size_t last = (offset + length - 1) / page_size;
+    if (last >= self->dirty_page_count) {
+        last = self->dirty_page_count - 1;
+    }
+
+    for (size_t page = first; page <= last; page++) {
+        uint32_t bit = 1u << (page % 32);
+        // Hot pages are usually still marked, so avoid the locked instruction
+        if (!(ipc_atomic_load_u32(&self->dirty_pages[page / 32]) & bit)) {
+            ipc_atomic_fetch_or_u32(&self->dirty_pages[page / 32], bit);
+        }
+    }
+}
+
+static void flush_pages(SharedMemory* self, size_t first_page, size_t end_page) {
+    size_t page_size = system_page_size();
+    size_t start = first_page * page_size;
+    size_t end = end_page * page_size;
+    if (end > mapping_size(self)) {
+        end = mapping_size(self);
+    }
+
+    // After growth on Windows the data lives in its own view of the same file
+    unsigned char* base = self->data - SHM_HEADER_SIZE;
+#ifdef _WIN32
+    FlushViewOfFile(base + start, end - start);
+#else
+    msync(base + start, end - start, MS_SYNC);
+#endif
+}
+
+// Takes each bitmap word's dirty bits in one exchange and writes back every
+// run of adjacent dirty pages with a single flush call
+static void flush_dirty(SharedMemory* self) {
+    if (!self->dirty_pages) {
+        return;
+    }
+
+    size_t words = (self->dirty_page_count + 31) / 32;
+    size_t run_start = 0;
+    bool in_run = false;
+
+    for (size_t word = 0; word < words; word++) {
+        uint32_t bits = 0;
+        if (ipc_atomic_load_u32(&self->dirty_pages[word])) {
+            bits = ipc_atomic_exchange_u32(&self->dirty_pages[word], 0);
+        }
+        if ((bits == 0 && !in_run) || (bits == 0xFFFFFFFFu && in_run)) {
+            continue;
+        }
+
+        for (size_t bit = 0; bit < 32; bit++) {
+            bool dirty = (bits >> bit) & 1;
+            if (dirty && !in_run) {
+                run_start = word * 32 + bit;
+                in_run = true;
+            }
+            else if (!dirty && in_run) {
+                flush_pages(self, run_start, word * 32 + bit);
+                in_run = false;
+            }
+        }
+    }
+
+    if (in_run) {
+        flush_pages(self, run_start, self->dirty_page_count);
+    }
+}
+
+// The flusher thread reads the mapping and bitmap, so remapping and close
+// take this lock while it runs. Without a flusher only the owning thread
+// touches them.
+static void flusher_lock(SharedMemory* self) {
+    if (!self->flusher_running) {
+        return;
+    }
+#ifdef _WIN32
+    EnterCriticalSection(&self->flush_lock);
+#else
+    pthread_mutex_lock(&self->flush_lock);
+#endif
+}
+
+static void flusher_unlock(SharedMemory* self) {
+    if (!self->flusher_running) {
+        return;
+    }
+#ifdef _WIN32
+    LeaveCriticalSection(&self->flush_lock);
+#else
+    pthread_mutex_unlock(&self->flush_lock);
+#endif
+}
+
+#ifdef _WIN32
+static unsigned __stdcall flusher_thread_func(void* arg) {
+    SharedMemory* self = (SharedMemory*)arg;
+
+    while (WaitForSingleObject(self->flusher_stop, self->flush_interval_ms) == WAIT_TIMEOUT) {
+        EnterCriticalSection(&self->flush_lock);
+        flush_dirty(self);
+        LeaveCriticalSection(&self->flush_lock);
+    }
+    return 0;
+}
+
+static bool start_flusher(SharedMemory* self) {
+    self->flusher_stop = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!self->flusher_stop) {
+        return false;
+    }
+    InitializeCriticalSection(&self->flush_lock);
+
+    self->flusher_running = true;
+    self->flusher_thread = (HANDLE)_beginthreadex(NULL, 0, flusher_thread_func, self, 0, NULL);
+    if (!self->flusher_thread) {
+        self->flusher_running = false;
+        DeleteCriticalSection(&self->flush_lock);
+        CloseHandle(self->flusher_stop);
+        self->flusher_stop = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void stop_flusher(SharedMemory* self) {
+    if (!self->flusher_running) {
+        return;
+    }
+
+    SetEvent(self->flusher_stop);
+    WaitForSingleObject(self->flusher_thread, INFINITE);
+    CloseHandle(self->flusher_thread);
+    CloseHandle(self->flusher_stop);
+    self->flusher_thread = NULL;
+    self->flusher_stop = NULL;
+    DeleteCriticalSection(&self->flush_lock);
+    self->flusher_running = false;
+}
+#else
+static void* flusher_thread_func(void* arg) {
+    SharedMemory* self = (SharedMemory*)arg;
+
+    pthread_mutex_lock(&self->flush_lock);
+    while (self->flusher_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += self->flush_interval_ms / 1000;
+        deadline.tv_nsec += (long)(self->flush_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        // Returns early only when stop_flusher signals
+        pthread_cond_timedwait(&self->flusher_wake, &self->flush_lock, &deadline);
+        if (self->flusher_running) {
+            flush_dirty(self);
+        }
+    }
+    pthread_mutex_unlock(&self->flush_lock);
+    return NULL;
+}
+
+static bool start_flusher(SharedMemory* self) {
+    pthread_mutex_init(&self->flush_lock, NULL);
+    pthread_cond_init(&self->flusher_wake, NULL);
+
+    self->flusher_running = true;
+    if (pthread_create(&self->flusher_thread, NULL, flusher_thread_func, self) != 0) {
+        self->flusher_running = false;
+        pthread_cond_destroy(&self->flusher_wake);
+        pthread_mutex_destroy(&self->flush_lock);
+        return false;
+    }
+    return true;
+}
+
+static void stop_flusher(SharedMemory* self) {
+    if (!self->flusher_running) {
+        return;
+    }
+
+    pthread_mutex_lock(&self->flush_lock);
+    self->flusher_running = false;
+    pthread_cond_signal(&self->flusher_wake);
+    pthread_mutex_unlock(&self->flush_lock);
+
+    pthread_join(self->flusher_thread, NULL);
+    pthread_cond_destroy(&self->flusher_wake);
+    pthread_mutex_destroy(&self->flush_lock);
+}
+#endif
+
+// Starts or stops the flusher to match the durability policy
+static bool apply_durability(SharedMemory* self) {
+    bool wanted = self->durability == SHM_DURABILITY_PERIODIC && self->pBuf && self->dirty_pages;
+    if (!wanted) {
+        stop_flusher(self);
+        return true;
+    }
+    if (self->flusher_running) {
+        return true;
+    }
+
+    if (!start_flusher(self)) {
+        if (self->verbose) {
+            printf("Failed to start the flusher thread, falling back to synchronous flushes\n");
+        }
+        self->durability = SHM_DURABILITY_SYNC;
+        return false;
+    }
+
+    if (self->verbose) {
+        printf("Flusher thread started (every %lu ms)\n", (unsigned long)self->flush_interval_ms);
+    }
+    return true;
+}
+
+// Called after every write: the header page always changes (sequence), plus
+// the data range that was written. `offset` is relative to the data region.
+static void persist_range(SharedMemory* self, size_t offset, size_t length) {
+    if (self->durability == SHM_DURABILITY_NONE) {
+        return;
+    }
+
+    mark_dirty(self, 0, SHM_HEADER_SIZE);
+    mark_dirty(self, SHM_HEADER_SIZE + offset, length);
+
+    // In periodic mode the flusher merges everything marked since its last pass
+    if (self->durability == SHM_DURABILITY_SYNC) {
+        flush_dirty(self);
+    }
+}
+
+// High-water mark of written data, so clear() only touches what was used
+static size_t used_size(SharedMemory* self) {
+    return (size_t)(((unsigned long long)self->header->used_size_high << 32) | self->header->used_size_low);
+}
+
+static void note_written(SharedMemory* self, size_t end) {
+    if (end > used_size(self)) {
+        self->header->used_size_low = (uint32_t)((unsigned long long)end & 0xFFFFFFFF);
+        self->header->used_size_high = (uint32_t)((unsigned long long)end >> 32);
+    }
+}
+
+static void attach_view(SharedMemory* self, void* view) {
+    self->pBuf = view;
+    self->header = (SharedMemoryHeader*)view;
+    self->data = (unsigned char*)view + SHM_HEADER_SIZE;
+    self->lock.writer.word = &self->header->write_lock;
+    self->lock.writer.owner = self->header->write_lock_owner;
+    self->lock.state = &self->header->rw_state;
+
+    // A freshly created segment is zero-filled; the first process to attach stamps it
+    if (!ipc_atomic_cas_u32(&self->header->magic, 0, SHM_HEADER_MAGIC) &&
+        self->header->magic != SHM_HEADER_MAGIC && self->verbose) {
+        printf("Warning: segment '%s' has an unknown header (magic 0x%08X)\n",
+            self->id, self->header->magic);
+    }
+}
+
+// Writers make the sequence odd for the duration of a write. Concurrent
+// writers must be serialized by the caller (lock_for_writing). Writes nest,
+// so a grow inside begin_update keeps the sequence odd until end_update.
+static void begin_write(SharedMemory* self) {
+    if (self->write_depth++ == 0) {
+        ipc_atomic_fetch_add_u32(&self->header->sequence, 1);
+    }
+}
+
+// Wakes wait_for_change sleepers; the syscall is skipped when nobody waits.
+// Windows has no cross-process futex, so there each sleeper blocks on the
+// "<id>_changed" semaphore and a writer releases it once per waiter. A unit
+// left over by a waiter that timed out meanwhile only costs a later waiter
+// one extra look at the sequence.
+static void notify_change(SharedMemory* self) {
+    ipc_atomic_fence();
+    uint32_t waiters = ipc_atomic_load_u32(&self->header->change_waiters);
+    if (waiters != 0) {
+#ifdef _WIN32
+        if (self->change_signal) {
+            ReleaseSemaphore(self->change_signal, (LONG)(waiters < LONG_MAX ? waiters : LONG_MAX), NULL);
+        }
+#else
+        ipc_futex_wake(&self->header->sequence, INT_MAX);
+#endif
+    }
+}
+
+#ifdef _WIN32
+static void open_change_signal(SharedMemory* self) {
+    char name[MAX_PATH];
+    sprintf_s(name, sizeof(name), "%s_changed", self->id);
+    self->change_signal = CreateSemaphoreA(NULL, 0, LONG_MAX, name);
+    if (!self->change_signal && self->verbose) {
+        printf("Failed to create change semaphore %s: error %lu\n", name, GetLastError());
+    }
+}
+#endif
+
+static uint32_t end_write(SharedMemory* self) {
+    if (--self->write_depth > 0) {
+        return self->header->sequence;
+    }
+
+    uint32_t sequence = ipc_atomic_fetch_add_u32(&self->header->sequence, 1) + 1;
+    notify_change(self);
+    return sequence;
+}
+
+// A writer that died mid-write leaves the sequence odd. Several processes may
+// notice at once, so only one CAS gets to close the write.
+static void repair_interrupted_write(SharedMemory* self) {
+    uint32_t sequence = ipc_atomic_load_u32(&self->header->sequence);
+    if ((sequence & 1) && ipc_atomic_cas_u32(&self->header->sequence, sequence, sequence + 1)) {
+        notify_change(self);
+        if (self->verbose) {
+            printf("Previous writer died mid-write, data may be incomplete\n");
+        }
+    }
+}
+
+// Triple-buffer mode splits the data region into SHM_TRIPLE_BUFFER_SLOTS
+// slots. A slot holds only the payload; its size lives in the header's
+// slot_size, guarded by the same per-slot sequence.
+// The writer always fills the slot after the published one, so a slot is only
+// reused two publishes later; readers copy the published slot and retry only
+// if its sequence moved underneath them.
+static bool triple_buffer_enabled(SharedMemory* self) {
+    return (self->options & SHM_OPTION_TRIPLE_BUFFER) != 0;
+}
+
+static size_t triple_buffer_slot_capacity(SharedMemory* self) {
+    return (self->size / SHM_TRIPLE_BUFFER_SLOTS) & ~(size_t)7;
+}
+
+static unsigned char* triple_buffer_slot(SharedMemory* self, uint32_t slot) {
+    return self->data + slot * triple_buffer_slot_capacity(self);
+}
+
+static size_t iov_total(const struct iovec* iov, size_t iovcnt) {
+    size_t total = 0;
+    for (size_t i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    return total;
+}
+
+static void iov_copy(unsigned char* target, const struct iovec* iov, size_t iovcnt) {
+    for (size_t i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len > 0) {
+            memcpy(target, iov[i].iov_base, iov[i].iov_len);
+            target += iov[i].iov_len;
+        }
+    }
+}
+
+static bool triple_buffer_publish(SharedMemory* self, const struct iovec* iov, size_t iovcnt, uint32_t* out_sequence) {
+    size_t data_size = iov_total(iov, iovcnt);
+    size_t capacity = triple_buffer_slot_capacity(self);
+    if (data_size > capacity || data_size > UINT32_MAX) {
+        if (self->verbose) {
+            printf("Data too large for triple-buffer slot: %zu > %zu\n", data_size, capacity);
+        }
+        return false;
+    }
+
+    uint32_t slot = (ipc_atomic_load_u32(&self->header->published) + 1) % SHM_TRIPLE_BUFFER_SLOTS;
+
+    ipc_atomic_fetch_add_u32(&self->header->slot_sequence[slot], 1);
+    self->header->slot_size[slot] = (uint32_t)data_size;
+    iov_copy(triple_buffer_slot(self, slot), iov, iovcnt);
+    ipc_atomic_fetch_add_u32(&self->header->slot_sequence[slot], 1);
+
+    // Publish the slot, then advance the generation (kept even in this mode)
+    ipc_atomic_store_u32(&self->header->published, slot);
+    uint32_t sequence = ipc_atomic_fetch_add_u32(&self->header->sequence, 2) + 2;
+    notify_change(self);
+
+    if (out_sequence) {
+        *out_sequence = sequence;
+    }
+
+    if (self->verbose) {
+        printf("Published %zu bytes to slot %u (sequence %u)\n", data_size, slot, sequence);
+    }
+
+    persist_range(self, slot * capacity, data_size);
+    return true;
+}
+
+// Copies the newest complete snapshot; the buffer gets a trailing NUL so
+// read() can hand it out as a string
+static unsigned char* triple_buffer_read(SharedMemory* self, size_t* out_size, uint32_t* out_sequence) {
+    size_t capacity = triple_buffer_slot_capacity(self);
+    unsigned char* buffer = NULL;
+    size_t buffer_size = 0;
+    unsigned long long start_time = ipc_now_ms();
+
+    *out_size = 0;
+
+    for (;;) {
+        if (!SharedMemory_pin(self)) {
+            free(buffer);
+            return NULL;
+        }
+        uint32_t sequence = ipc_atomic_load_u32(&self->header->sequence);
+        uint32_t slot = ipc_atomic_load_u32(&self->header->published) % SHM_TRIPLE_BUFFER_SLOTS;
+        uint32_t before = ipc_atomic_load_u32(&self->header->slot_sequence[slot]);
+
+        if ((before & 1) == 0) {
+            unsigned char* source = triple_buffer_slot(self, slot);
+            uint32_t data_size = self->header->slot_size[slot];
+
+            bool valid = data_size <= capacity;
+            if (valid) {
+                if (data_size + 1 > buffer_size) {
+                    unsigned char* grown = (unsigned char*)realloc(buffer, data_size + 1);
+                    if (!grown) {
+                        SharedMemory_unpin(self);
+                        if (self->verbose) {
+                            printf("Failed to allocate memory for data\n");
+                        }
+                        free(buffer);
+                        return NULL;
+                    }
+                    buffer = grown;
+                    buffer_size = data_size + 1;
+                }
+                memcpy(buffer, source, data_size);
+                buffer[data_size] = '\0';
+            }
+
+            ipc_atomic_fence();
+            bool settled = ipc_atomic_load_u32(&self->header->slot_sequence[slot]) == before;
+            SharedMemory_unpin(self);
+            if (settled) {
+                if (!valid) {
+                    if (self->verbose) {
+                        printf("Invalid size in triple-buffer slot %u: %u\n", slot, data_size);
+                    }
+                    free(buffer);
+                    return NULL;
+                }
+
+                *out_size = data_size;
+                if (out_sequence) {
+                    *out_sequence = sequence;
+                }
+                return buffer;
+            }
+        }
+        else {
+            SharedMemory_unpin(self);
+        }
+
+        // Only reached when the writer lapped this reader twice mid-copy
+        if (ipc_now_ms() - start_time >= READ_RETRY_TIMEOUT_MS) {
+            if (self->verbose) {
+                printf("Timed out waiting for a consistent read\n");
+            }
+            free(buffer);
+            return NULL;
+        }
+        ipc_yield();
+    }
+}
+
+#ifdef _WIN32
+// Large-page sections need SeLockMemoryPrivilege enabled in the process token
+static bool enable_lock_memory_privilege(void) {
+    HANDLE token;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+        return false;
+    }
+
+    TOKEN_PRIVILEGES privileges;
+    privileges.PrivilegeCount = 1;
+    privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
 
-    shm->file_path = (char*)malloc(MAX_PATH);
-    sprintf_s(shm->file_path, MAX_PATH, "%s\\%s.bin", temp_path, id);
+    bool enabled = LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid) &&
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL) &&
+        GetLastError() == ERROR_SUCCESS;
+
+    CloseHandle(token);
+    return enabled;
+}
+
+static void apply_memory_options(SharedMemory* self, void* view, size_t map_size) {
+    if (self->options & SHM_OPTION_PREFAULT) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+
+        // Touch one byte per page so the first real access does not fault
+        volatile unsigned char* bytes = (volatile unsigned char*)view;
+        for (size_t offset = 0; offset < map_size; offset += info.dwPageSize) {
+            (void)bytes[offset];
+        }
+        self->options_applied |= SHM_OPTION_PREFAULT;
+    }
+
+    if (self->options & SHM_OPTION_LOCK_PAGES) {
+        BOOL locked = VirtualLock(view, map_size);
+
+        // VirtualLock is bounded by the working set, so grow it once and retry
+        if (!locked && GetLastError() == ERROR_WORKING_SET_QUOTA) {
+            SIZE_T min_ws, max_ws;
+            if (GetProcessWorkingSetSize(GetCurrentProcess(), &min_ws, &max_ws) &&
+                SetProcessWorkingSetSize(GetCurrentProcess(), min_ws + map_size, max_ws + map_size)) {
+                locked = VirtualLock(view, map_size);
+            }
+        }
+
+        if (locked) {
+            self->options_applied |= SHM_OPTION_LOCK_PAGES;
+        }
+        else if (self->verbose) {
+            printf("VirtualLock failed with error: %lu\n", GetLastError());
+        }
+    }
+}
+#else
+static bool thp_shmem_enabled(void) {
+    FILE* file = fopen(THP_SHMEM_SETTING, "r");
+    if (!file) {
+        return false;
+    }
+
+    char setting[128] = { 0 };
+    bool enabled = fgets(setting, sizeof(setting), file) != NULL &&
+        strstr(setting, "[never]") == NULL && strstr(setting, "[deny]") == NULL;
+
+    fclose(file);
+    return enabled;
+}
+
+// Huge page advice and NUMA placement only affect pages faulted in after
+// them, so MAP_POPULATE cannot be used with either
+static bool late_prefault(SharedMemory* self) {
+    return (self->options & SHM_OPTION_HUGE_PAGES) || self->numa_policy != SHM_NUMA_DEFAULT;
+}
+
+static void place_view(SharedMemory* self, void* view, size_t map_size) {
+    if (self->numa_policy == SHM_NUMA_DEFAULT) {
+        return;
+    }
+
+    self->numa_applied = ipc_numa_place(view, map_size, self->numa_policy, self->numa_node);
+    if (!self->numa_applied && self->verbose) {
+        printf("NUMA placement not applied (%d node(s) online)\n", ipc_numa_node_count());
+    }
+}
+
+static void apply_memory_options(SharedMemory* self, void* view, size_t map_size) {
+    // Huge page advice has to come before the pages are faulted in
+    if (self->options & SHM_OPTION_HUGE_PAGES) {
+        if (!(self->options & SHM_OPTION_PERSISTENT) &&
+            madvise(view, map_size, MADV_HUGEPAGE) == 0 && thp_shmem_enabled()) {
+            self->options_applied |= SHM_OPTION_HUGE_PAGES;
+        }
+        else if (self->verbose) {
+            printf("Transparent huge pages are not available for this segment\n");
+        }
+    }
+
+#ifdef MADV_POPULATE_WRITE
+    if ((self->options & SHM_OPTION_PREFAULT) && late_prefault(self) &&
+        madvise(view, map_size, MADV_POPULATE_WRITE) != 0 && self->verbose) {
+        printf("MADV_POPULATE_WRITE failed with error: %d\n", errno);
+    }
+#endif
+
+    if (self->options & SHM_OPTION_PREFAULT) {
+        long page_size = sysconf(_SC_PAGESIZE);
+        size_t page_count = (map_size + (size_t)page_size - 1) / (size_t)page_size;
+        unsigned char* residency = (unsigned char*)malloc(page_count);
+
+        // Without MADV_POPULATE_WRITE, touch the pages MAP_POPULATE could not cover
+        if (late_prefault(self) && residency &&
+            mincore(view, map_size, residency) == 0) {
+            volatile unsigned char* bytes = (volatile unsigned char*)view;
+            for (size_t i = 0; i < page_count; i++) {
+                if (!(residency[i] & 1)) {
+                    (void)bytes[i * (size_t)page_size];
+                }
+            }
+        }
+
+        // Report success only if every page is actually resident
+        bool resident = residency != NULL && mincore(view, map_size, residency) == 0;
+        for (size_t i = 0; resident && i < page_count; i++) {
+            resident = (residency[i] & 1) != 0;
+        }
+        free(residency);
+
+        if (resident) {
+            self->options_applied |= SHM_OPTION_PREFAULT;
+        }
+        else if (self->verbose) {
+            printf("Prefaulting did not make every page resident\n");
+        }
+    }
+
+    if (self->options & SHM_OPTION_LOCK_PAGES) {
+        if (mlock(view, map_size) == 0) {
+            self->options_applied |= SHM_OPTION_LOCK_PAGES;
+        }
+        else if (self->verbose) {
+            printf("mlock failed with error: %d (check RLIMIT_MEMLOCK)\n", errno);
+        }
+    }
+}
+
+static void posix_object_name(SharedMemory* self, char* name, size_t name_size) {
+    snprintf(name, name_size, "/%s", self->id);
+}
+#endif
+
+#ifdef _WIN32
+// Sections cannot be resized, so each generation gets its own section
+// ("<id>_g<N>"). The header stays in the original view so the lock and
+// sequence words never move; only the data region is remapped.
+//
+// A pagefile section lives only while some handle has it open, and the
+// grower may exit before another handle has caught up. Every handle keeps
+// the newest section it mapped open, and a handle that finds its target
+// generation gone recreates it from its own view, so the segment stays
+// usable; writes made only in the lost section do not come back.
+static bool remap_view(SharedMemory* self, uint32_t generation, size_t new_size, bool create) {
+    size_t map_size = SHM_HEADER_SIZE + new_size;
+    DWORD size_high = (DWORD)((unsigned long long)map_size >> 32);
+    DWORD size_low = (DWORD)(map_size & 0xFFFFFFFF);
+    char name[MAX_PATH];
+    sprintf_s(name, sizeof(name), "%s_g%u", self->id, generation);
+
+    HANDLE hMapFile;
+    bool fresh = false;  // Only a section this call brought into existence starts empty
+    if (self->hFile != INVALID_HANDLE_VALUE) {
+        // File-backed: a larger section over the same file extends it in place
+        hMapFile = CreateFileMappingA(self->hFile, NULL, PAGE_READWRITE, size_high, size_low, NULL);
+    }
+    else {
+        hMapFile = create ? NULL : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+        if (create || (hMapFile == NULL && GetLastError() == ERROR_FILE_NOT_FOUND)) {
+            if (!create && self->verbose) {
+                printf("Generation %u (%s) was released by every holder; recreating it\n", generation, name);
+            }
+            hMapFile = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, size_high, size_low, name);
+            fresh = hMapFile != NULL && GetLastError() != ERROR_ALREADY_EXISTS;
+        }
+    }
+
+    if (hMapFile == NULL) {
+        if (self->verbose) {
+            printf("Failed to map generation %u (%s): error %lu\n", generation, name, GetLastError());
+        }
+        return false;
+    }
+
+    bool placed;
+    void* view = ipc_numa_map_view(hMapFile, FILE_MAP_ALL_ACCESS, map_size, self->numa_policy, self->numa_node, &placed);
+    if (view == NULL) {
+        if (self->verbose) {
+            printf("MapViewOfFile failed for generation %u: error %lu\n", generation, GetLastError());
+        }
+        CloseHandle(hMapFile);
+        return false;
+    }
+
+    // A new pagefile section starts empty, so carry the current contents over
+    if (fresh) {
+        size_t used = used_size(self);
+        memcpy((unsigned char*)view + SHM_HEADER_SIZE, self->data, used < self->size ? used : self->size);
+    }
+
+    if (self->data_view) {
+        UnmapViewOfFile(self->data_view);
+        CloseHandle(self->hDataMapFile);
+    }
+
+    self->data_view = view;
+    self->hDataMapFile = hMapFile;
+    self->numa_applied = placed;
+    self->data = (unsigned char*)view + SHM_HEADER_SIZE;
+    self->size = new_size;
+    self->map_generation = generation;
+    apply_memory_options(self, view, map_size);
+    resize_dirty_map(self);
+    return true;
+}
+#else
+// The object only ever grows, so a larger mapping of the same descriptor
+// sees everything the old one did; mappings in other processes stay valid.
+static bool remap_view(SharedMemory* self, uint32_t generation, size_t new_size, bool create) {
+    size_t map_size = SHM_HEADER_SIZE + new_size;
+
+    if (create && ftruncate(self->fd, (off_t)map_size) != 0) {
+        if (self->verbose) {
+            printf("ftruncate failed with error: %d\n", errno);
+        }
+        return false;
+    }
+
+    void* view = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+    if (view == MAP_FAILED) {
+        if (self->verbose) {
+            printf("mmap failed for generation %u: error %d\n", generation, errno);
+        }
+        return false;
+    }
+    place_view(self, view, map_size);
+
+    munmap(self->pBuf, mapping_size(self));
+    self->size = new_size;
+    self->map_generation = generation;
+    attach_view(self, view);
+    apply_memory_options(self, view, map_size);
+    resize_dirty_map(self);
+    return true;
+}
+#endif
+
+// Threads sharing a handle share its view: lock-free reads hold this
+// shared and a remap holds it exclusively, so no thread unmaps the view
+// another is still copying from.
+static void view_lock_shared(SharedMemory* self) {
+#ifdef _WIN32
+    AcquireSRWLockShared(&self->view_lock);
+#else
+    pthread_rwlock_rdlock(&self->view_lock);
+#endif
+}
+
+static void view_unlock_shared(SharedMemory* self) {
+#ifdef _WIN32
+    ReleaseSRWLockShared(&self->view_lock);
+#else
+    pthread_rwlock_unlock(&self->view_lock);
+#endif
+}
+
+static void view_lock_exclusive(SharedMemory* self) {
+#ifdef _WIN32
+    AcquireSRWLockExclusive(&self->view_lock);
+#else
+    pthread_rwlock_wrlock(&self->view_lock);
+#endif
+}
+
+static void view_unlock_exclusive(SharedMemory* self) {
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(&self->view_lock);
+#else
+    pthread_rwlock_unlock(&self->view_lock);
+#endif
+}
+
+// Maps the grown segment and publishes it. The new generation goes into
+// the header before this handle's readers may pin again; one that saw the
+// handle ahead of the header would map back to the old size.
+static bool grow_view(SharedMemory* self, uint32_t generation, size_t new_size) {
+    view_lock_exclusive(self);
+    flusher_lock(self);
+    bool grown = remap_view(self, generation, new_size, true);
+    flusher_unlock(self);
+    if (grown) {
+        // Size first, then the generation that makes other handles read it
+        self->header->grown_size_low = (uint32_t)((unsigned long long)new_size & 0xFFFFFFFF);
+        self->header->grown_size_high = (uint32_t)((unsigned long long)new_size >> 32);
+        ipc_atomic_store_u32(&self->header->map_generation, generation);
+    }
+    view_unlock_exclusive(self);
+    return grown;
+}
+
+static bool mapping_current(SharedMemory* self) {
+    view_lock_shared(self);
+    bool current = ipc_atomic_load_u32(&self->header->map_generation) == self->map_generation;
+    view_unlock_shared(self);
+    return current;
+}
+
+// Cheap check done at the start of each data access: one load of the header.
+// Returns false when the segment has grown and this handle could not follow;
+// its old view is then too small for offsets other handles hand out.
+static bool refresh_mapping(SharedMemory* self) {
+    if (mapping_current(self)) {
+        return true;
+    }
+
+    // Another thread of this handle may have followed while this one waited,
+    // so the target is read again once nobody else can remap
+    view_lock_exclusive(self);
+    flusher_lock(self);
+    uint32_t generation = ipc_atomic_load_u32(&self->header->map_generation);
+    size_t new_size = (size_t)(((unsigned long long)self->header->grown_size_high << 32) |
+        self->header->grown_size_low);
+    bool stale = generation != self->map_generation;
+    bool followed = !stale || remap_view(self, generation, new_size, false);
+    flusher_unlock(self);
+    view_unlock_exclusive(self);
+
+    if (!followed) {
+        if (self->verbose) {
+            printf("Failed to follow the segment to generation %u\n", generation);
+        }
+        return false;
+    }
+
+    if (stale && self->verbose) {
+        printf("Remapped to generation %u (%zu bytes)\n", generation, new_size);
+    }
+    return true;
+}
+
+static bool ensure_capacity(SharedMemory* self, size_t needed) {
+    if (needed <= self->size) {
+        return true;
+    }
+    if (!(self->options & SHM_OPTION_GROWABLE)) {
+        return false;
+    }
+
+    // Double so a stream of slightly larger writes does not remap every time
+    size_t new_size = self->size * 2;
+    return SharedMemory_grow(self, new_size > needed ? new_size : needed);
+}
+
+void SharedMemory_init(SharedMemory* shm, const char* id, size_t size, bool verbose) {
+    
+    shm->id = _strdup(id);
+    shm->size = size;
+#ifdef _WIN32
+    shm->hFile = INVALID_HANDLE_VALUE;
+    shm->hMapFile = NULL;
+    shm->hDataMapFile = NULL;
+    shm->data_view = NULL;
+#else
+    shm->fd = -1;
+#endif
+    shm->pBuf = NULL;
+    shm->header = NULL;
+    shm->data = NULL;
+    shm->verbose = verbose;
+    shm->options = SHM_OPTION_NONE;
+    shm->options_applied = SHM_OPTION_NONE;
+    shm->map_generation = 0;
+    shm->write_depth = 0;
+    shm->dirty_pages = NULL;
+    shm->dirty_page_count = 0;
+    shm->numa_policy = SHM_NUMA_DEFAULT;
+    shm->numa_node = 0;
+    shm->numa_applied = false;
+    shm->durability = SHM_DURABILITY_SYNC;
+    shm->flush_interval_ms = SHM_DEFAULT_FLUSH_INTERVAL_MS;
+    shm->flusher_running = false;
+#ifdef _WIN32
+    shm->flusher_thread = NULL;
+    shm->flusher_stop = NULL;
+    shm->change_signal = NULL;
+#endif
+
+    // Create file path in temp directory
+    char temp_path[MAX_PATH];
+#ifdef _WIN32
+    GetTempPathA(MAX_PATH, temp_path);
+#else
+    const char* tmpdir = getenv("TMPDIR");
+    snprintf(temp_path, MAX_PATH, "%s", (tmpdir && tmpdir[0]) ? tmpdir : "/tmp");
+#endif
+
+    // Sized from the parts, so a long id is never cut short into another file's name
+    size_t path_size = strlen(temp_path) + strlen(id) + sizeof("/.bin");
+    shm->file_path = (char*)malloc(path_size);
+    if (shm->file_path) {
+#ifdef _WIN32
+        sprintf_s(shm->file_path, path_size, "%s\\%s.bin", temp_path, id);
+#else
+        snprintf(shm->file_path, path_size, "%s/%s.bin", temp_path, id);
+#endif
+    }
+
+    
+    ShmRwLock_init(&shm->lock, id, verbose);
+
+    
+    shm->set_options = SharedMemory_set_options;
+    shm->set_durability = SharedMemory_set_durability;
+    shm->set_numa = SharedMemory_set_numa;
+    shm->get_numa_stats = SharedMemory_get_numa_stats;
+    shm->get_applied_options = SharedMemory_get_applied_options;
+    shm->setup = SharedMemory_setup;
+    shm->write = SharedMemory_write;
+    shm->write_bytes = SharedMemory_write_bytes;
+    shm->writev = SharedMemory_writev;
+    shm->write_at = SharedMemory_write_at;
+    shm->read_at = SharedMemory_read_at;
+    shm->read = SharedMemory_read;
+    shm->read_bytes = SharedMemory_read_bytes;
+    shm->write_versioned = SharedMemory_write_versioned;
+    shm->read_consistent = SharedMemory_read_consistent;
+    shm->borrow = SharedMemory_borrow;
+    shm->validate_borrow = SharedMemory_validate_borrow;
+    shm->get_sequence = SharedMemory_get_sequence;
+    shm->wait_for_change = SharedMemory_wait_for_change;
+    shm->grow = SharedMemory_grow;
+    shm->refresh = SharedMemory_refresh;
+    shm->pin = SharedMemory_pin;
+    shm->unpin = SharedMemory_unpin;
+    shm->begin_update = SharedMemory_begin_update;
+    shm->touch = SharedMemory_touch;
+    shm->end_update = SharedMemory_end_update;
+    shm->clear = SharedMemory_clear;
+    shm->close = SharedMemory_close;
+    shm->unlink = SharedMemory_unlink;
+    shm->lock_for_writing = SharedMemory_lock_for_writing;
+    shm->lock_for_reading = SharedMemory_lock_for_reading;
+    shm->unlock_from_reading = SharedMemory_unlock_from_reading;
+    shm->unlock_from_writing = SharedMemory_unlock_from_writing;
+
+    if (shm->verbose) {
+        printf("SharedMemory initialized with id '%s' and size %zu\n", id, size);
+        printf("Using file: %s\n", shm->file_path);
+    }
+}
+
+void SharedMemory_set_options(SharedMemory* self, unsigned int options) {
+    if (self->pBuf) {
+        if (self->verbose) {
+            printf("Options must be set before setup\n");
+        }
+        return;
+    }
+
+    self->options = options;
+}
+
+bool SharedMemory_set_durability(SharedMemory* self, SharedMemoryDurability durability, DWORD interval_ms) {
+    // Restart the flusher so a new interval takes effect, and write back
+    // whatever the old policy left pending
+    stop_flusher(self);
+    if (self->pBuf) {
+        flush_dirty(self);
+    }
+
+    self->durability = durability;
+    self->flush_interval_ms = interval_ms ? interval_ms : SHM_DEFAULT_FLUSH_INTERVAL_MS;
+
+    if (!(self->options & SHM_OPTION_PERSISTENT) && self->verbose) {
+        printf("Durability only applies to persistent segments\n");
+    }
+
+    return apply_durability(self);
+}
+
+void SharedMemory_set_numa(SharedMemory* self, ShmNumaPolicy policy, int node) {
+    if (self->pBuf) {
+        if (self->verbose) {
+            printf("NUMA placement must be set before setup\n");
+        }
+        return;
+    }
+
+    self->numa_policy = policy;
+    // The consumer's node is resolved at setup, on the thread that attaches
+    self->numa_node = policy == SHM_NUMA_CONSUMER ? -1 : node;
+}
+
+void SharedMemory_get_numa_stats(SharedMemory* self, ShmNumaStats* out_stats) {
+    if (self->pBuf) {
+        refresh_mapping(self);
+    }
+    ipc_numa_fill_stats(out_stats, self->pBuf ? self->data : NULL, self->pBuf ? self->size : 0,
+        self->numa_policy, self->numa_node, self->numa_applied);
+}
+
+unsigned int SharedMemory_get_applied_options(SharedMemory* self) {
+    return self->options_applied;
+}
+
+// Pins a consumer-first policy to the node this process attaches from, so
+// later growth places new pages on the same node
+static void resolve_numa_node(SharedMemory* self) {
+    if (self->numa_policy == SHM_NUMA_CONSUMER && self->numa_node < 0) {
+        self->numa_node = ipc_numa_current_node();
+    }
+}
+
+#ifdef _WIN32
+bool SharedMemory_setup(SharedMemory* self) {
+    size_t map_size = mapping_size(self);
+    resolve_numa_node(self);
+    DWORD size_high = (DWORD)((unsigned long long)map_size >> 32);
+    DWORD size_low = (DWORD)(map_size & 0xFFFFFFFF);
+
+    if (self->options & SHM_OPTION_PERSISTENT) {
+        self->hFile = CreateFileA(
+            self->file_path,
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE,
+            NULL,
+            OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,     // Normal file
+            NULL);                     // No template
+        
+        if (self->hFile == INVALID_HANDLE_VALUE) {
+            DWORD error = GetLastError();
+            if (self->verbose) {
+                printf("CreateFile failed with error: %d\n", error);
+            }
+            return false;
+        }
+
+
+        DWORD file_size_high;
+        DWORD file_size_low = GetFileSize(self->hFile, &file_size_high);
+
+        if (file_size_low == 0 && file_size_high == 0) {
+
+            LONG high_size = (LONG)size_high;
+
+            SetFilePointer(self->hFile, (LONG)size_low, &high_size, FILE_BEGIN);
+            SetEndOfFile(self->hFile);
+            SetFilePointer(self->hFile, 0, NULL, FILE_BEGIN);
+
+            if (self->verbose) {
+                printf("Created new file with size %zu bytes\n", map_size);
+            }
+        }
+        else if (self->verbose) {
+            printf("Opened existing file with size %lu bytes\n", file_size_low);
+        }
+    }
+
+    DWORD map_access = FILE_MAP_ALL_ACCESS;
+    self->options_applied = SHM_OPTION_NONE;
+
+    // Large pages are only available for pagefile-backed sections
+    if ((self->options & SHM_OPTION_HUGE_PAGES) && self->hFile == INVALID_HANDLE_VALUE) {
+        SIZE_T large_page = GetLargePageMinimum();
+
+        if (large_page != 0 && enable_lock_memory_privilege()) {
+            unsigned long long rounded = ((unsigned long long)map_size + large_page - 1) / large_page * large_page;
+
+            self->hMapFile = CreateFileMappingA(
+                INVALID_HANDLE_VALUE,
+                NULL,
+                PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+                (DWORD)(rounded >> 32),
+                (DWORD)(rounded & 0xFFFFFFFF),
+                self->id);
+
+            // An existing section keeps whatever page size its creator chose
+            if (self->hMapFile != NULL && GetLastError() != ERROR_ALREADY_EXISTS) {
+                map_access |= FILE_MAP_LARGE_PAGES;
+                self->options_applied |= SHM_OPTION_HUGE_PAGES;
+            }
+        }
+
+        if (!(self->options_applied & SHM_OPTION_HUGE_PAGES) && self->verbose) {
+            printf("Large pages are not available for this segment\n");
+        }
+    }
+
+    // Without a file handle the section is backed by the paging file
+    if (self->hMapFile == NULL) {
+        self->hMapFile = CreateFileMappingA(
+            self->hFile,               // File handle or INVALID_HANDLE_VALUE
+            NULL,                      
+            PAGE_READWRITE,            
+            size_high,
+            size_low,
+            self->id);                 
+    }
+
+    if (self->hMapFile == NULL) {
+        DWORD error = GetLastError();
+        if (self->verbose) {
+            printf("CreateFileMapping failed with error: %d\n", error);
+        }
+        if (self->hFile != INVALID_HANDLE_VALUE) {
+            CloseHandle(self->hFile);
+            self->hFile = INVALID_HANDLE_VALUE;
+        }
+        return false;
+    }
+
+    // Placement is chosen per view, so the NUMA policy rides on the mapping call
+    void* view = ipc_numa_map_view(self->hMapFile, map_access, map_size,
+        self->numa_policy, self->numa_node, &self->numa_applied);
+
+    if (view == NULL) {
+        DWORD error = GetLastError();
+        if (self->verbose) {
+            printf("MapViewOfFile failed with error: %d\n", error);
+        }
+        CloseHandle(self->hMapFile);
+        self->hMapFile = NULL;
+        if (self->hFile != INVALID_HANDLE_VALUE) {
+            CloseHandle(self->hFile);
+            self->hFile = INVALID_HANDLE_VALUE;
+        }
+        return false;
+    }
+
+    attach_view(self, view);
+    apply_memory_options(self, view, map_size);
+    open_change_signal(self);
+
+    // Join at the current size if another process has already grown the segment
+    if (!refresh_mapping(self)) {
+        SharedMemory_close(self);
+        return false;
+    }
+    resize_dirty_map(self);
+    apply_durability(self);
+
+    if (self->verbose) {
+        printf("SharedMemory setup complete (%s)\n",
+            (self->options & SHM_OPTION_PERSISTENT) ? "file-backed" : "pagefile-backed");
+    }
+
+    return true;
+}
+#else
+bool SharedMemory_setup(SharedMemory* self) {
+    char name[MAX_PATH];
+    size_t map_size = mapping_size(self);
+    resolve_numa_node(self);
+
+    if (self->options & SHM_OPTION_PERSISTENT) {
+        self->fd = open(self->file_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    }
+    else {
+        // POSIX shared memory lives on tmpfs, so nothing is ever written back to disk
+        posix_object_name(self, name, sizeof(name));
+        self->fd = shm_open(name, O_RDWR | O_CREAT, 0666);
+    }
+
+    if (self->fd == -1) {
+        if (self->verbose) {
+            printf("Opening shared memory object failed with error: %d\n", errno);
+        }
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(self->fd, &st) != 0) {
+        if (self->verbose) {
+            printf("fstat failed with error: %d\n", errno);
+        }
+        close(self->fd);
+        self->fd = -1;
+        return false;
+    }
+
+    // Mapping past the end of the object raises SIGBUS, so grow it first
+    if ((size_t)st.st_size < map_size) {
+        if (ftruncate(self->fd, (off_t)map_size) != 0) {
+            if (self->verbose) {
+                printf("ftruncate failed with error: %d\n", errno);
+            }
+            close(self->fd);
+            self->fd = -1;
+            return false;
+        }
+
+        if (self->verbose) {
+            printf("Created new segment with size %zu bytes\n", map_size);
+        }
+    }
+    else if (self->verbose) {
+        printf("Opened existing segment with size %lld bytes\n", (long long)st.st_size);
+    }
+
+    self->options_applied = SHM_OPTION_NONE;
+
+    // MAP_POPULATE would fault pages in before huge page advice or a NUMA
+    // policy can apply, so in that case prefaulting is left to apply_memory_options
+    int map_flags = MAP_SHARED;
+    if ((self->options & SHM_OPTION_PREFAULT) && !late_prefault(self)) {
+        map_flags |= MAP_POPULATE;
+    }
+
+    void* view = mmap(NULL, map_size, PROT_READ | PROT_WRITE, map_flags, self->fd, 0);
+    if (view == MAP_FAILED) {
+        if (self->verbose) {
+            printf("mmap failed with error: %d\n", errno);
+        }
+        close(self->fd);
+        self->fd = -1;
+        return false;
+    }
+
+    place_view(self, view, map_size);
+    attach_view(self, view);
+    apply_memory_options(self, view, map_size);
+
+    // Join at the current size if another process has already grown the segment
+    if (!refresh_mapping(self)) {
+        SharedMemory_close(self);
+        return false;
+    }
+    resize_dirty_map(self);
+    apply_durability(self);
+
+    if (self->verbose) {
+        printf("SharedMemory setup complete (%s)\n",
+            (self->options & SHM_OPTION_PERSISTENT) ? "file-backed" : "tmpfs-backed");
+    }
+
+    return true;
+}
+#endif
+
+bool SharedMemory_write(SharedMemory* self, const void* data, size_t data_size) {
+    if (!self || !self->pBuf || !data) {
+        return false;
+    }
+
+    if (!refresh_mapping(self)) {
+        return false;
+    }
+
+    if (!ensure_capacity(self, data_size)) {
+        if (self->verbose) {
+            printf("SharedMemory_write: Data size %zu exceeds shared memory size %zu\n", 
+                data_size, self->size);
+        }
+        return false;
+    }
+
+    if (triple_buffer_enabled(self)) {
+        struct iovec fragment = { (void*)data, data_size };
+        return triple_buffer_publish(self, &fragment, 1, NULL);
+    }
+
+    begin_write(self);
+    memcpy(self->data, data, data_size);
+    end_write(self);
+
+    
+    note_written(self, data_size);
+    persist_range(self, 0, data_size);
+
+    return true;
+}
+
+void SharedMemory_write_bytes(SharedMemory* self, const unsigned char* data, size_t data_size) {
+    struct iovec fragment = { (void*)data, data_size };
+    SharedMemory_writev(self, &fragment, 1);
+}
+
+bool SharedMemory_writev(SharedMemory* self, const struct iovec* iov, size_t iovcnt) {
+    if (!self->pBuf) {
+        if (self->verbose) {
+            printf("Cannot write: shared memory not set up\n");
+        }
+        return false;
+    }
+
+    // In triple-buffer mode every write publishes a new snapshot
+    if (triple_buffer_enabled(self)) {
+        return triple_buffer_publish(self, iov, iovcnt, NULL);
+    }
+
+    if (!refresh_mapping(self)) {
+        return false;
+    }
+
+    size_t data_size = iov_total(iov, iovcnt);
+    if (!ensure_capacity(self, data_size)) {
+        if (self->verbose) {
+            printf("Data too large for shared memory: %zu > %zu\n", data_size, self->size);
+        }
+        return false;
+    }
+
+    // Fragments go straight into the mapping, back to back
+    begin_write(self);
+    iov_copy(self->data, iov, iovcnt);
+    end_write(self);
+
+    if (self->verbose) {
+        printf("Wrote %zu bytes to shared memory\n", data_size);
+    }
+
+    
+    note_written(self, data_size);
+    persist_range(self, 0, data_size);
+    return true;
+}
+
+// Updates part of the segment in place; only the touched pages are flushed
+bool SharedMemory_write_at(SharedMemory* self, size_t offset, const void* data, size_t data_size) {
+    if (!self->pBuf || !data) {
+        if (self->verbose) {
+            printf("Cannot write: shared memory not set up\n");
+        }
+        return false;
+    }
+
+    // Slots are whole snapshots; a partial update would mix two of them
+    if (triple_buffer_enabled(self)) {
+        if (self->verbose) {
+            printf("Ranged writes are not supported in triple-buffer mode\n");
+        }
+        return false;
+    }
+
+    if (!refresh_mapping(self)) {
+        return false;
+    }
+
+    if (offset > SIZE_MAX - data_size || !ensure_capacity(self, offset + data_size)) {
+        if (self->verbose) {
+            printf("Range %zu+%zu exceeds shared memory size %zu\n", offset, data_size, self->size);
+        }
+        return false;
+    }
+
+    begin_write(self);
+    memcpy(self->data + offset, data, data_size);
+    end_write(self);
+
+    note_written(self, offset + data_size);
+    persist_range(self, offset, data_size);
+    return true;
+}
+
+// Copies `length` bytes at `offset` into `out` under the sequence check
+bool SharedMemory_read_at(SharedMemory* self, size_t offset, void* out, size_t length) {
+    if (!self->pBuf || !out) {
+        if (self->verbose) {
+            printf("Cannot read: shared memory not set up\n");
+        }
+        return false;
+    }
+
+    if (triple_buffer_enabled(self)) {
+        if (self->verbose) {
+            printf("Ranged reads are not supported in triple-buffer mode\n");
+        }
+        return false;
+    }
+
+    unsigned long long start_time = ipc_now_ms();
+
+    for (;;) {
+        // Pinned per attempt, so a grow by another thread is not held up
+        // for the whole retry loop
+        if (!SharedMemory_pin(self)) {
+            return false;
+        }
+
+        if (offset > self->size || length > self->size - offset) {
+            SharedMemory_unpin(self);
+            if (self->verbose) {
+                printf("Range %zu+%zu exceeds shared memory size %zu\n", offset, length, self->size);
+            }
+            return false;
+        }
+
+        uint32_t before = ipc_atomic_load_u32(&self->header->sequence);
+        if ((before & 1) == 0) {
+            memcpy(out, self->data + offset, length);
+
+            ipc_atomic_fence();
+            if (ipc_atomic_load_u32(&self->header->sequence) == before) {
+                SharedMemory_unpin(self);
+                return true;
+            }
+        }
+        SharedMemory_unpin(self);
+
+        if (ipc_now_ms() - start_time >= READ_RETRY_TIMEOUT_MS) {
+            if (self->verbose) {
+                printf("Timed out waiting for a consistent read\n");
+            }
+            return false;
+        }
+        ipc_yield();
+    }
+}
+
+char* SharedMemory_read(SharedMemory* self) {
+    if (!self || !self->pBuf) {
+        return NULL;
+    }
+
+    if (triple_buffer_enabled(self)) {
+        size_t length;
+        return (char*)triple_buffer_read(self, &length, NULL);
+    }
+
+    if (!SharedMemory_pin(self)) {
+        return NULL;
+    }
+
+    // Only copy the string itself rather than the whole segment
+    size_t length = 0;
+    while (length < self->size && self->data[length] != '\0') {
+        length++;
+    }
+
+    char* buffer = (char*)malloc(length + 1);
+    if (!buffer) {
+        SharedMemory_unpin(self);
+        return NULL;
+    }
+
+    
+    memcpy(buffer, self->data, length);
+    buffer[length] = '\0';
+    SharedMemory_unpin(self);
+
+    return buffer;
+}
+
+unsigned char* SharedMemory_read_bytes(SharedMemory* self, size_t* out_size) {
+    if (!self->pBuf) {
+        if (self->verbose) {
+            printf("Cannot read: shared memory not set up\n");
+        }
+        *out_size = 0;
+        return NULL;
+    }
 
-    
-    FileLock_init(&shm->lock, shm->file_path, verbose);
+    if (triple_buffer_enabled(self)) {
+        return triple_buffer_read(self, out_size, NULL);
+    }
 
+    if (!SharedMemory_pin(self)) {
+        *out_size = 0;
+        return NULL;
+    }
+    uint32_t data_size = *(uint32_t*)self->data;
     
-    shm->setup = SharedMemory_setup;
-    shm->write = SharedMemory_write;
-    shm->write_bytes = SharedMemory_write_bytes;
-    shm->read = SharedMemory_read;
-    shm->read_bytes = SharedMemory_read_bytes;
-    shm->clear = SharedMemory_clear;
-    shm->close = SharedMemory_close;
-    shm->unlink = SharedMemory_unlink;
-    shm->lock_for_writing = SharedMemory_lock_for_writing;
-    shm->unlock_from_writing = SharedMemory_unlock_from_writing;
-
-    if (shm->verbose) {
-        printf("SharedMemory initialized with id '%s' and size %zu\n", id, size);
-        printf("Using file: %s\n", shm->file_path);
+    if (data_size > self->size - sizeof(uint32_t)) {
+        SharedMemory_unpin(self);
+        if (self->verbose) {
+            printf("Invalid size in shared memory: %u > %zu\n", data_size, self->size - sizeof(uint32_t));
+        }
+        *out_size = 0;
+        return NULL;
     }
-}
 
-bool SharedMemory_setup(SharedMemory* self) {
-    
-    self->hFile = CreateFileA(
-        self->file_path,           
-        GENERIC_READ | GENERIC_WRITE, 
-        FILE_SHARE_READ | FILE_SHARE_WRITE, 
-        NULL,                      
-        OPEN_ALWAYS,               
-        FILE_ATTRIBUTE_NORMAL,     // Normal file
-        NULL);                     // No template
-
-    if (self->hFile == INVALID_HANDLE_VALUE) {
-        DWORD error = GetLastError();
+    // Allocate memory for the data
+    unsigned char* data = (unsigned char*)malloc(data_size);
+    if (!data) {
+        SharedMemory_unpin(self);
         if (self->verbose) {
-            printf("CreateFile failed with error: %d\n", error);
+            printf("Failed to allocate memory for data\n");
         }
-        return false;
+        *out_size = 0;
+        return NULL;
     }
 
     
-    DWORD file_size_high;
-    DWORD file_size_low = GetFileSize(self->hFile, &file_size_high);
+    memcpy(data, self->data + sizeof(uint32_t), data_size);
+    SharedMemory_unpin(self);
+    *out_size = data_size;
 
-    if (file_size_low == 0 && file_size_high == 0) {
-        
-        DWORD high_size = 0;
-        DWORD low_size = (DWORD)self->size;
+    if (self->verbose) {
+        printf("Read %u bytes from shared memory\n", data_size);
+    }
 
-        SetFilePointer(self->hFile, low_size, &high_size, FILE_BEGIN);
-        SetEndOfFile(self->hFile);
-        SetFilePointer(self->hFile, 0, NULL, FILE_BEGIN);
+    return data;
+}
 
+bool SharedMemory_write_versioned(SharedMemory* self, const unsigned char* data, size_t data_size, uint32_t* out_sequence) {
+    if (!self->pBuf) {
         if (self->verbose) {
-            printf("Created new file with size %zu bytes\n", self->size);
+            printf("Cannot write: shared memory not set up\n");
         }
-    }
-    else if (self->verbose) {
-        printf("Opened existing file with size %lu bytes\n", file_size_low);
+        return false;
     }
 
-    
-    self->hMapFile = CreateFileMappingA(
-        self->hFile,               // File handle
-        NULL,                      
-        PAGE_READWRITE,            
-        0,                         
-        (DWORD)self->size,         
-        self->id);                 
+    if (triple_buffer_enabled(self)) {
+        struct iovec fragment = { (void*)data, data_size };
+        return triple_buffer_publish(self, &fragment, 1, out_sequence);
+    }
 
-    if (self->hMapFile == NULL) {
-        DWORD error = GetLastError();
-        if (self->verbose) {
-            printf("CreateFileMapping failed with error: %d\n", error);
-        }
-        CloseHandle(self->hFile);
-        self->hFile = INVALID_HANDLE_VALUE;
+    if (!refresh_mapping(self)) {
         return false;
     }
 
-    
-    self->pBuf = MapViewOfFile(
-        self->hMapFile,            // Handle to map object
-        FILE_MAP_ALL_ACCESS,       
-        0,                         // High-order DWORD of offset
-        0,                         
-        self->size);               // Number of bytes to map
-
-    if (self->pBuf == NULL) {
-        DWORD error = GetLastError();
+    if (!ensure_capacity(self, data_size + sizeof(uint32_t))) {
         if (self->verbose) {
-            printf("MapViewOfFile failed with error: %d\n", error);
+            printf("Data too large for shared memory: %zu > %zu\n", data_size, self->size - sizeof(uint32_t));
         }
-        CloseHandle(self->hMapFile);
-        self->hMapFile = NULL;
-        CloseHandle(self->hFile);
-        self->hFile = INVALID_HANDLE_VALUE;
         return false;
     }
 
+    // Same framing read_bytes expects: 4-byte length prefix, then the payload
+    uint32_t size32 = (uint32_t)data_size;
+    begin_write(self);
+    memcpy(self->data, &size32, sizeof(uint32_t));
+    memcpy(self->data + sizeof(uint32_t), data, data_size);
+    uint32_t sequence = end_write(self);
+
+    if (out_sequence) {
+        *out_sequence = sequence;
+    }
+
     if (self->verbose) {
-        printf("SharedMemory setup complete\n");
+        printf("Wrote %zu bytes to shared memory (sequence %u)\n", data_size, sequence);
     }
 
+    note_written(self, sizeof(uint32_t) + data_size);
+    persist_range(self, 0, sizeof(uint32_t) + data_size);
     return true;
 }
 
-bool SharedMemory_write(SharedMemory* self, const void* data, size_t data_size) {
-    if (!self || !self->hMapFile || !data) {
-        return false;
-    }
+unsigned char* SharedMemory_read_consistent(SharedMemory* self, size_t* out_size, uint32_t* out_sequence) {
+    *out_size = 0;
 
-    if (data_size > self->size) {
+    if (!self->pBuf) {
         if (self->verbose) {
-            printf("SharedMemory_write: Data size %zu exceeds shared memory size %zu\n", 
-                data_size, self->size);
+            printf("Cannot read: shared memory not set up\n");
         }
-        return false;
+        return NULL;
     }
 
-    
-    memcpy(self->pBuf, data, data_size);
+    if (triple_buffer_enabled(self)) {
+        return triple_buffer_read(self, out_size, out_sequence);
+    }
 
-    
-    FlushViewOfFile(self->pBuf, data_size);
+    unsigned char* buffer = NULL;
+    size_t buffer_size = 0;
+    unsigned long long start_time = ipc_now_ms();
 
-    return true;
+    // Copy optimistically and retry if a writer was active at any point
+    for (;;) {
+        // Growth is itself a write, so a retry after it lands here and remaps
+        if (!SharedMemory_pin(self)) {
+            free(buffer);
+            return NULL;
+        }
+        uint32_t before = ipc_atomic_load_u32(&self->header->sequence);
+
+        if ((before & 1) == 0) {
+            uint32_t data_size;
+            memcpy(&data_size, self->data, sizeof(uint32_t));
+
+            // A torn length is only an error if the sequence confirms it
+            if (data_size <= self->size - sizeof(uint32_t)) {
+                if (data_size > buffer_size || !buffer) {
+                    unsigned char* grown = (unsigned char*)realloc(buffer, data_size ? data_size : 1);
+                    if (!grown) {
+                        SharedMemory_unpin(self);
+                        if (self->verbose) {
+                            printf("Failed to allocate memory for data\n");
+                        }
+                        free(buffer);
+                        return NULL;
+                    }
+                    buffer = grown;
+                    buffer_size = data_size;
+                }
+                memcpy(buffer, self->data + sizeof(uint32_t), data_size);
+            }
+
+            ipc_atomic_fence();
+            bool settled = ipc_atomic_load_u32(&self->header->sequence) == before;
+            size_t capacity = self->size - sizeof(uint32_t);
+            SharedMemory_unpin(self);
+            if (settled) {
+                if (data_size > capacity) {
+                    if (self->verbose) {
+                        printf("Invalid size in shared memory: %u > %zu\n", data_size, capacity);
+                    }
+                    free(buffer);
+                    return NULL;
+                }
+
+                *out_size = data_size;
+                if (out_sequence) {
+                    *out_sequence = before;
+                }
+                return buffer;
+            }
+        }
+        else {
+            SharedMemory_unpin(self);
+        }
+
+        // A writer that never finishes (e.g. crashed mid-write) must not hang readers
+        if (ipc_now_ms() - start_time >= READ_RETRY_TIMEOUT_MS) {
+            if (self->verbose) {
+                printf("Timed out waiting for a consistent read\n");
+            }
+            free(buffer);
+            return NULL;
+        }
+        ipc_yield();
+    }
 }
 
-void SharedMemory_write_bytes(SharedMemory* self, const unsigned char* data, size_t data_size) {
+const unsigned char* SharedMemory_borrow(SharedMemory* self, size_t* out_size, uint32_t* out_generation) {
+    *out_size = 0;
+
     if (!self->pBuf) {
         if (self->verbose) {
-            printf("Cannot write: shared memory not set up\n");
+            printf("Cannot borrow: shared memory not set up\n");
         }
-        return;
+        return NULL;
     }
 
-    if (data_size > self->size) {
-        if (self->verbose) {
-            printf("Data too large for shared memory: %zu > %zu\n", data_size, self->size);
+    unsigned long long start_time = ipc_now_ms();
+    bool triple_buffer = triple_buffer_enabled(self);
+
+    // Only the length has to be read consistently; the payload is left in place
+    for (;;) {
+        if (!SharedMemory_pin(self)) {
+            return NULL;
         }
-        return;
+        size_t capacity = triple_buffer ? triple_buffer_slot_capacity(self) : self->size;
+        uint32_t generation = ipc_atomic_load_u32(&self->header->sequence);
+        uint32_t slot = triple_buffer ? ipc_atomic_load_u32(&self->header->published) % SHM_TRIPLE_BUFFER_SLOTS : 0;
+        volatile uint32_t* guard = triple_buffer ? &self->header->slot_sequence[slot] : &self->header->sequence;
+        uint32_t before = triple_buffer ? ipc_atomic_load_u32(guard) : generation;
+        // Slots keep their size in the header; the plain layout frames it inline
+        unsigned char* source = triple_buffer ? triple_buffer_slot(self, slot) : self->data + sizeof(uint32_t);
+        size_t limit = triple_buffer ? capacity : capacity - sizeof(uint32_t);
+
+        if ((before & 1) == 0 && capacity >= sizeof(uint32_t)) {
+            uint32_t data_size;
+            if (triple_buffer) {
+                data_size = self->header->slot_size[slot];
+            }
+            else {
+                memcpy(&data_size, self->data, sizeof(uint32_t));
+            }
+
+            ipc_atomic_fence();
+            bool settled = ipc_atomic_load_u32(guard) == before;
+            SharedMemory_unpin(self);
+            if (settled) {
+                if (data_size > limit) {
+                    if (self->verbose) {
+                        printf("Invalid size in shared memory: %u > %zu\n", data_size, limit);
+                    }
+                    return NULL;
+                }
+
+                *out_size = data_size;
+                if (out_generation) {
+                    *out_generation = generation;
+                }
+                return source;
+            }
+        }
+        else {
+            SharedMemory_unpin(self);
+        }
+
+        if (ipc_now_ms() - start_time >= READ_RETRY_TIMEOUT_MS) {
+            if (self->verbose) {
+                printf("Timed out waiting for a consistent borrow\n");
+            }
+            return NULL;
+        }
+        ipc_yield();
+    }
+}
+
+bool SharedMemory_validate_borrow(SharedMemory* self, uint32_t generation) {
+    if (!SharedMemory_pin(self)) {
+        return false;
     }
 
-    // Copy data to shared memory
-    memcpy(self->pBuf, data, data_size);
+    ipc_atomic_fence();
+    uint32_t current = ipc_atomic_load_u32(&self->header->sequence);
+    SharedMemory_unpin(self);
 
-    if (self->verbose) {
-        printf("Wrote %zu bytes to shared memory\n", data_size);
+    // A triple-buffer slot is only rewritten once two newer snapshots are out
+    if (triple_buffer_enabled(self)) {
+        return current - generation <= 2;
     }
+    return current == generation;
+}
 
-    
-    FlushViewOfFile(self->pBuf, data_size);
+uint32_t SharedMemory_get_sequence(SharedMemory* self) {
+    if (!SharedMemory_pin(self)) {
+        return 0;
+    }
+    uint32_t sequence = ipc_atomic_load_u32(&self->header->sequence);
+    SharedMemory_unpin(self);
+    return sequence;
 }
 
-char* SharedMemory_read(SharedMemory* self) {
-    if (!self || !self->hMapFile) {
-        return NULL;
+bool SharedMemory_wait_for_change(SharedMemory* self, uint32_t last_sequence, DWORD timeout_ms, uint32_t* out_sequence) {
+    if (!self->pBuf) {
+        if (self->verbose) {
+            printf("Cannot wait: shared memory not set up\n");
+        }
+        return false;
     }
 
-    
-    char* buffer = (char*)malloc(self->size);
-    if (!buffer) {
-        return NULL;
+    unsigned long long start_time = ipc_now_ms();
+    bool changed = false;
+    uint32_t current = last_sequence;
+
+    if (!SharedMemory_pin(self)) {
+        return false;
     }
+    ipc_atomic_fetch_add_u32(&self->header->change_waiters, 1);
+    ipc_atomic_fence();
 
-    
-    memcpy(buffer, self->pBuf, self->size);
+    // An odd sequence is a write in progress; keep sleeping until it completes.
+    // The pin is dropped while asleep so this handle's other threads can
+    // still grow; a remap meanwhile only cuts the sleep short.
+    for (;;) {
+        volatile uint32_t* sequence = &self->header->sequence;
+        current = ipc_atomic_load_u32(sequence);
+        if (current != last_sequence && (current & 1) == 0) {
+            changed = true;
+            break;
+        }
 
-    return buffer;
+        unsigned long long elapsed = ipc_now_ms() - start_time;
+        if (elapsed >= timeout_ms) {
+            break;
+        }
+        SharedMemory_unpin(self);
+#ifdef _WIN32
+        if (self->change_signal) {
+            WaitForSingleObject(self->change_signal, timeout_ms - (DWORD)elapsed);
+        }
+        else {
+            ipc_futex_wait(sequence, current, timeout_ms - (DWORD)elapsed);
+        }
+#else
+        ipc_futex_wait(sequence, current, timeout_ms - (DWORD)elapsed);
+#endif
+
+        // A handle left behind by growth stays counted as a waiter, which
+        // only costs writers a wake nobody needs
+        if (!SharedMemory_pin(self)) {
+            return false;
+        }
+    }
+
+    ipc_atomic_fetch_add_u32(&self->header->change_waiters, (uint32_t)-1);
+    SharedMemory_unpin(self);
+
+    if (out_sequence) {
+        *out_sequence = current;
+    }
+    return changed;
 }
 
-unsigned char* SharedMemory_read_bytes(SharedMemory* self, size_t* out_size) {
+bool SharedMemory_grow(SharedMemory* self, size_t new_size) {
     if (!self->pBuf) {
         if (self->verbose) {
-            printf("Cannot read: shared memory not set up\n");
+            printf("Cannot grow: shared memory not set up\n");
         }
-        *out_size = 0;
-        return NULL;
+        return false;
     }
 
-    
-    uint32_t data_size = *(uint32_t*)self->pBuf;
-    
-    if (data_size > self->size - sizeof(uint32_t)) {
+    if (!refresh_mapping(self)) {
+        return false;
+    }
+    if (new_size <= self->size) {
+        return true;
+    }
+
+    // Slot offsets depend on the size, so the layout cannot change under readers
+    if (triple_buffer_enabled(self)) {
         if (self->verbose) {
-            printf("Invalid size in shared memory: %u > %zu\n", data_size, self->size - sizeof(uint32_t));
+            printf("Cannot grow a triple-buffered segment\n");
         }
-        *out_size = 0;
-        return NULL;
+        return false;
     }
 
-    // Allocate memory for the data
-    unsigned char* data = (unsigned char*)malloc(data_size);
-    if (!data) {
-        if (self->verbose) {
-            printf("Failed to allocate memory for data\n");
+    // A new section is filled from this handle's view, so no writer may
+    // still be writing to the old one between the copy and the generation
+    // bump. Writers re-check the generation once they hold the lock.
+    bool locked = false;
+    if (!self->lock.writer.held) {
+        if (!self->lock.acquire_write(&self->lock, GROW_LOCK_TIMEOUT_MS)) {
+            if (self->verbose) {
+                printf("Cannot grow: the write lock is busy\n");
+            }
+            return false;
+        }
+        locked = true;
+        if (self->lock.recovered) {
+            repair_interrupted_write(self);
+        }
+
+        // Someone may have grown the segment while we waited
+        bool followed = refresh_mapping(self);
+        if (!followed || new_size <= self->size) {
+            self->lock.release_write(&self->lock);
+            return followed;
         }
-        *out_size = 0;
-        return NULL;
     }
 
-    
-    memcpy(data, (unsigned char*)self->pBuf + sizeof(uint32_t), data_size);
-    *out_size = data_size;
+    uint32_t generation = self->map_generation + 1;
+
+    begin_write(self);
+    bool grown = grow_view(self, generation, new_size);
+    end_write(self);
+
+    if (locked) {
+        self->lock.release_write(&self->lock);
+    }
 
     if (self->verbose) {
-        printf("Read %zu bytes from shared memory\n", data_size);
+        if (grown) {
+            printf("Grew shared memory to %zu bytes (generation %u)\n", new_size, generation);
+        }
+        else {
+            printf("Failed to grow shared memory to %zu bytes\n", new_size);
+        }
     }
 
-    return data;
+    persist_range(self, 0, 0);
+    return grown;
+}
+
+bool SharedMemory_refresh(SharedMemory* self) {
+    return self->pBuf != NULL && refresh_mapping(self);
+}
+
+bool SharedMemory_pin(SharedMemory* self) {
+    if (!self->pBuf) {
+        return false;
+    }
+
+    // Growth between the refresh and the shared lock sends this round again
+    for (;;) {
+        view_lock_shared(self);
+        if (ipc_atomic_load_u32(&self->header->map_generation) == self->map_generation) {
+            return true;
+        }
+        view_unlock_shared(self);
+
+        if (!refresh_mapping(self)) {
+            return false;
+        }
+    }
+}
+
+void SharedMemory_unpin(SharedMemory* self) {
+    view_unlock_shared(self);
+}
+
+// Leaves the sequence untouched on failure, so there is nothing to end
+bool SharedMemory_begin_update(SharedMemory* self) {
+    if (!self->pBuf || !refresh_mapping(self)) {
+        return false;
+    }
+    begin_write(self);
+    return true;
+}
+
+void SharedMemory_touch(SharedMemory* self, size_t offset, size_t length) {
+    note_written(self, offset + length);
+    if (self->durability != SHM_DURABILITY_NONE) {
+        mark_dirty(self, SHM_HEADER_SIZE + offset, length);
+    }
+
+    // Lock-free updates made outside begin/end_update have no end to flush at
+    if (self->durability == SHM_DURABILITY_SYNC && self->write_depth == 0) {
+        flush_dirty(self);
+    }
+}
+
+uint32_t SharedMemory_end_update(SharedMemory* self) {
+    uint32_t sequence = end_write(self);
+    if (self->write_depth == 0) {
+        persist_range(self, 0, 0);
+    }
+    return sequence;
 }
 
 void SharedMemory_clear(SharedMemory* self) {
@@ -242,27 +1964,89 @@ void SharedMemory_clear(SharedMemory* self) {
         return;
     }
 
-    // Fill with zeros
-    memset(self->pBuf, 0, self->size);
+    if (triple_buffer_enabled(self)) {
+        triple_buffer_publish(self, NULL, 0, NULL);
+        return;
+    }
+
+    if (!refresh_mapping(self)) {
+        return;
+    }
+
+    // Zero only what has been written since the last clear, leaving the header intact
+    size_t used = used_size(self);
+    if (used > self->size) {
+        used = self->size;
+    }
+
+    begin_write(self);
+    memset(self->data, 0, used);
+    self->header->used_size_low = 0;
+    self->header->used_size_high = 0;
+    end_write(self);
 
     if (self->verbose) {
-        printf("Shared memory cleared\n");
+        printf("Shared memory cleared (%zu bytes)\n", used);
     }
 
     // Flush to ensure data is written to disk
-    FlushViewOfFile(self->pBuf, self->size);
+    persist_range(self, 0, used);
 }
 
 void SharedMemory_close(SharedMemory* self) {
+    // The lock words are about to be unmapped, so let go of them first
+    while (self->lock.reads_held > 0) {
+        self->lock.release_read(&self->lock);
+    }
+    if (self->lock.writer.held) {
+        self->lock.release_write(&self->lock);
+    }
+    self->lock.state = NULL;
+    self->lock.writer.word = NULL;
+    self->lock.writer.owner = NULL;
+
+    // Anything still marked dirty goes out before the view disappears
+    stop_flusher(self);
+    if (self->pBuf) {
+        flush_dirty(self);
+    }
+    free((void*)self->dirty_pages);
+    self->dirty_pages = NULL;
+    self->dirty_page_count = 0;
+
     if (self->pBuf) {
+        // A read still pinned by another thread finishes first
+        view_lock_exclusive(self);
+#ifdef _WIN32
+        if (self->data_view) {
+            UnmapViewOfFile(self->data_view);
+            self->data_view = NULL;
+        }
         UnmapViewOfFile(self->pBuf);
+#else
+        munmap(self->pBuf, mapping_size(self));
+#endif
         self->pBuf = NULL;
+        self->header = NULL;
+        self->data = NULL;
+        view_unlock_exclusive(self);
 
         if (self->verbose) {
             printf("Unmapped view of file\n");
         }
     }
 
+#ifdef _WIN32
+    if (self->change_signal) {
+        CloseHandle(self->change_signal);
+        self->change_signal = NULL;
+    }
+
+    if (self->hDataMapFile) {
+        CloseHandle(self->hDataMapFile);
+        self->hDataMapFile = NULL;
+    }
+
     if (self->hMapFile) {
         CloseHandle(self->hMapFile);
         self->hMapFile = NULL;
@@ -280,6 +2064,16 @@ void SharedMemory_close(SharedMemory* self) {
             printf("Closed file handle\n");
         }
     }
+#else
+    if (self->fd != -1) {
+        close(self->fd);
+        self->fd = -1;
+
+        if (self->verbose) {
+            printf("Closed file descriptor\n");
+        }
+    }
+#endif
 }
 
 void SharedMemory_unlink(SharedMemory* self) {
@@ -290,7 +2084,14 @@ void SharedMemory_unlink(SharedMemory* self) {
     self->lock.close(&self->lock);
 
     
-    if (DeleteFileA(self->file_path)) {
+#ifdef _WIN32
+    if (!(self->options & SHM_OPTION_PERSISTENT)) {
+        // Pagefile-backed sections disappear with their last handle
+        if (self->verbose) {
+            printf("Released shared memory section: %s\n", self->id);
+        }
+    }
+    else if (DeleteFileA(self->file_path)) {
         if (self->verbose) {
             printf("Deleted shared memory file: %s\n", self->file_path);
         }
@@ -301,6 +2102,29 @@ void SharedMemory_unlink(SharedMemory* self) {
             printf("Failed to delete file: %d\n", error);
         }
     }
+#else
+    char object_name[MAX_PATH];
+    const char* name = object_name;
+    int result;
+
+    if (self->options & SHM_OPTION_PERSISTENT) {
+        name = self->file_path;
+        result = unlink(name);
+    }
+    else {
+        posix_object_name(self, object_name, sizeof(object_name));
+        result = shm_unlink(name);
+    }
+
+    if (result == 0) {
+        if (self->verbose) {
+            printf("Deleted shared memory object: %s\n", name);
+        }
+    }
+    else if (self->verbose) {
+        printf("Failed to delete shared memory object: %d\n", errno);
+    }
+#endif
 
     // Free the file path
     free(self->file_path);
@@ -316,12 +2140,46 @@ bool SharedMemory_lock_for_writing(SharedMemory* self, DWORD timeout_ms) {
     if (self->verbose) {
         printf("Acquiring lock for writing...\n");
     }
-    return self->lock.acquire(&self->lock, timeout_ms);
+    if (!self->lock.acquire_write(&self->lock, timeout_ms)) {
+        return false;
+    }
+
+    if (self->lock.recovered) {
+        repair_interrupted_write(self);
+    }
+
+    // A grow finished while we waited; writing to the old view would be lost
+    if (self->pBuf && !refresh_mapping(self)) {
+        self->lock.release_write(&self->lock);
+        return false;
+    }
+    return true;
 }
 
 bool SharedMemory_unlock_from_writing(SharedMemory* self) {
     if (self->verbose) {
         printf("Releasing write lock...\n");
     }
-    return self->lock.release(&self->lock);
-}
\ No newline at end of file
+    return self->lock.release_write(&self->lock);
+}
+
+bool SharedMemory_lock_for_reading(SharedMemory* self, DWORD timeout_ms) {
+    if (self->verbose) {
+        printf("Acquiring lock for reading...\n");
+    }
+    if (!self->lock.acquire_read(&self->lock, timeout_ms)) {
+        return false;
+    }
+
+    if (self->lock.recovered) {
+        repair_interrupted_write(self);
+    }
+    return true;
+}
+
+bool SharedMemory_unlock_from_reading(SharedMemory* self) {
+    if (self->verbose) {
+        printf("Releasing read lock...\n");
+    }
+    return self->lock.release_read(&self->lock);
+}
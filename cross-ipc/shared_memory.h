@@ -2,27 +2,127 @@
 #ifndef SHARED_MEMORY_H
 #define SHARED_MEMORY_H
 
-#include <windows.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "platform.h"
 #include "lock.h"
+#include "numa.h"
+
+#define SHM_HEADER_MAGIC 0x324D4853u  // "SHM2"
+#define SHM_HEADER_SIZE 256            // Data region starts at this offset in the mapping
+#define SHM_TRIPLE_BUFFER_SLOTS 3
+
+// Control block at the start of every mapping. The `size` bytes callers
+// see follow it, so offsets passed to the data methods never include it.
+typedef struct SharedMemoryHeader {
+    uint32_t magic;
+    volatile uint32_t sequence;  // Seqlock counter: odd while a write is in progress
+    volatile uint32_t write_lock;  // ShmMutex word serializing writers
+    volatile uint32_t rw_state;    // ShmRwLock reader count and writer flag
+    volatile uint32_t published;   // Triple-buffer mode: slot holding the newest snapshot
+    volatile uint32_t slot_sequence[SHM_TRIPLE_BUFFER_SLOTS];  // Per-slot seqlock counters
+    volatile uint32_t slot_size[SHM_TRIPLE_BUFFER_SLOTS];  // Bytes of payload in each slot
+    volatile uint32_t change_waiters;  // Processes blocked in wait_for_change
+    volatile uint32_t map_generation;  // Bumped by grow(); other handles remap when it moves
+    volatile uint32_t grown_size_low;  // Data size for map_generation (valid once it is non-zero)
+    volatile uint32_t grown_size_high;
+    volatile uint32_t used_size_low;   // High-water mark of data written since the last clear
+    volatile uint32_t used_size_high;
+    volatile uint32_t write_lock_owner[2];  // ShmMutex owner token and pid namespace
+} SharedMemoryHeader;
+
+// Setup options, combined as a bit mask and applied by SharedMemory_setup
+typedef enum SharedMemoryOption {
+    SHM_OPTION_NONE = 0,
+    SHM_OPTION_PERSISTENT = 1 << 0,  // Back the segment with a file in the temp directory
+    SHM_OPTION_PREFAULT = 1 << 1,    // Fault every page in during setup (MAP_POPULATE)
+    SHM_OPTION_HUGE_PAGES = 1 << 2,  // Transparent huge pages / SEC_LARGE_PAGES
+    SHM_OPTION_LOCK_PAGES = 1 << 3,  // Pin the mapping in RAM (mlock / VirtualLock)
+    SHM_OPTION_TRIPLE_BUFFER = 1 << 4,  // Keep only the latest snapshot, in rotating slots
+    SHM_OPTION_GROWABLE = 1 << 5     // Writes that do not fit grow the segment instead of failing
+} SharedMemoryOption;
+
+// When writes to a persistent segment reach the file. Ignored for segments
+// that are not file-backed.
+typedef enum SharedMemoryDurability {
+    SHM_DURABILITY_NONE = 0,      // Leave write-back to the OS
+    SHM_DURABILITY_PERIODIC = 1,  // A background thread flushes dirty pages every interval
+    SHM_DURABILITY_SYNC = 2       // Each write flushes its pages before returning (default)
+} SharedMemoryDurability;
+
+#define SHM_DEFAULT_FLUSH_INTERVAL_MS 100
 
 typedef struct SharedMemory {
     // Data members
     char* id;
     char* file_path;
     size_t size;
+#ifdef _WIN32
     HANDLE hFile;
     HANDLE hMapFile;
-    LPVOID pBuf;
+    HANDLE hDataMapFile;         // Section for a grown data region; the header stays in hMapFile
+    void* data_view;
+#else
+    int fd;
+#endif
+    void* pBuf;                  // Start of the mapping
+    SharedMemoryHeader* header;  // Same address as pBuf
+    unsigned char* data;         // pBuf + SHM_HEADER_SIZE
     bool verbose;
-    FileLock lock;  // Added lock member
+    unsigned int options;  // SharedMemoryOption flags, set before setup
+    unsigned int options_applied;  // Subset of options that took effect during setup
+    uint32_t map_generation;       // Header map_generation this handle is mapped at
+    uint32_t write_depth;          // Nesting of begin_write calls by this handle
+    volatile uint32_t* dirty_pages;  // Persistent segments: bitmap of pages not yet flushed
+    size_t dirty_page_count;
+    ShmNumaPolicy numa_policy;     // Placement requested with set_numa, applied at setup
+    int numa_node;
+    bool numa_applied;
+    SharedMemoryDurability durability;
+    DWORD flush_interval_ms;
+    bool flusher_running;
+#ifdef _WIN32
+    HANDLE flusher_thread;
+    HANDLE flusher_stop;           // Event signalled to end the flusher
+    CRITICAL_SECTION flush_lock;   // Held by the flusher while it walks the mapping
+    HANDLE change_signal;          // Named semaphore ("<id>_changed") wait_for_change blocks on
+    SRWLOCK view_lock;             // Shared while this handle's threads read the view, exclusive to remap it
+#else
+    pthread_t flusher_thread;
+    pthread_cond_t flusher_wake;
+    pthread_mutex_t flush_lock;
+    pthread_rwlock_t view_lock;    // Shared while this handle's threads read the view, exclusive to remap it
+#endif
+    ShmRwLock lock;  // Reader-writer lock, its state lives in the header
 
     // Method pointers
+    void (*set_options)(struct SharedMemory* self, unsigned int options);
+    bool (*set_durability)(struct SharedMemory* self, SharedMemoryDurability durability, DWORD interval_ms);
+    void (*set_numa)(struct SharedMemory* self, ShmNumaPolicy policy, int node);
+    void (*get_numa_stats)(struct SharedMemory* self, ShmNumaStats* out_stats);
+    unsigned int (*get_applied_options)(struct SharedMemory* self);
     bool (*setup)(struct SharedMemory* self);
     bool (*write)(struct SharedMemory* self, const void* data, size_t data_size);
     void (*write_bytes)(struct SharedMemory* self, const unsigned char* data, size_t data_size);
+    bool (*writev)(struct SharedMemory* self, const struct iovec* iov, size_t iovcnt);
+    bool (*write_at)(struct SharedMemory* self, size_t offset, const void* data, size_t data_size);
+    bool (*read_at)(struct SharedMemory* self, size_t offset, void* out, size_t length);
     char* (*read)(struct SharedMemory* self);
     unsigned char* (*read_bytes)(struct SharedMemory* self, size_t* out_size);
+    bool (*write_versioned)(struct SharedMemory* self, const unsigned char* data, size_t data_size, uint32_t* out_sequence);
+    unsigned char* (*read_consistent)(struct SharedMemory* self, size_t* out_size, uint32_t* out_sequence);
+    const unsigned char* (*borrow)(struct SharedMemory* self, size_t* out_size, uint32_t* out_generation);
+    bool (*validate_borrow)(struct SharedMemory* self, uint32_t generation);
+    uint32_t (*get_sequence)(struct SharedMemory* self);
+    bool (*wait_for_change)(struct SharedMemory* self, uint32_t last_sequence, DWORD timeout_ms, uint32_t* out_sequence);
+    bool (*grow)(struct SharedMemory* self, size_t new_size);
+    bool (*refresh)(struct SharedMemory* self);
+    bool (*pin)(struct SharedMemory* self);
+    void (*unpin)(struct SharedMemory* self);
+    bool (*begin_update)(struct SharedMemory* self);
+    void (*touch)(struct SharedMemory* self, size_t offset, size_t length);
+    uint32_t (*end_update)(struct SharedMemory* self);
     void (*clear)(struct SharedMemory* self);
     void (*close)(struct SharedMemory* self);
     void (*unlink)(struct SharedMemory* self);
@@ -30,17 +130,80 @@ typedef struct SharedMemory {
     // Lock-related methods
     bool (*lock_for_writing)(struct SharedMemory* self, DWORD timeout_ms);
     bool (*unlock_from_writing)(struct SharedMemory* self);
+    bool (*lock_for_reading)(struct SharedMemory* self, DWORD timeout_ms);
+    bool (*unlock_from_reading)(struct SharedMemory* self);
 } SharedMemory;
 
 // Constructor
 void SharedMemory_init(SharedMemory* shm, const char* id, size_t size, bool verbose);
 
 // Method implementations
+void SharedMemory_set_options(SharedMemory* self, unsigned int options);
+// May be called before or after setup. PERIODIC starts a flusher thread for
+// file-backed segments; an interval of 0 uses SHM_DEFAULT_FLUSH_INTERVAL_MS.
+bool SharedMemory_set_durability(SharedMemory* self, SharedMemoryDurability durability, DWORD interval_ms);
+// Must be called before setup. `node` is only used by SHM_NUMA_PREFERRED.
+void SharedMemory_set_numa(SharedMemory* self, ShmNumaPolicy policy, int node);
+void SharedMemory_get_numa_stats(SharedMemory* self, ShmNumaStats* out_stats);
+unsigned int SharedMemory_get_applied_options(SharedMemory* self);
 bool SharedMemory_setup(SharedMemory* self);
 bool SharedMemory_write(SharedMemory* self, const void* data, size_t data_size);
+// Copies the bytes to the start of the data region as they are, with no
+// length prefix: callers that read them back with read_bytes write the
+// prefix themselves. In triple-buffer mode each call publishes a snapshot
+// instead, and its size is kept in the slot header, so the slot holds
+// exactly these bytes too.
 void SharedMemory_write_bytes(SharedMemory* self, const unsigned char* data, size_t data_size);
+// Gathers the fragments into the mapping in one pass; same layout as write_bytes of their concatenation
+bool SharedMemory_writev(SharedMemory* self, const struct iovec* iov, size_t iovcnt);
+// Ranged access relative to the data region. Only the pages a write touches
+// are marked dirty and, for persistent segments, flushed.
+bool SharedMemory_write_at(SharedMemory* self, size_t offset, const void* data, size_t data_size);
+bool SharedMemory_read_at(SharedMemory* self, size_t offset, void* out, size_t length);
 char* SharedMemory_read(SharedMemory* self);
+// Returns the payload behind a 4-byte length prefix at the start of the data
+// region (what write_versioned or a caller-framed write_bytes leaves). In
+// triple-buffer mode it returns the newest snapshot exactly as written.
 unsigned char* SharedMemory_read_bytes(SharedMemory* self, size_t* out_size);
+bool SharedMemory_write_versioned(SharedMemory* self, const unsigned char* data, size_t data_size, uint32_t* out_sequence);
+unsigned char* SharedMemory_read_consistent(SharedMemory* self, size_t* out_size, uint32_t* out_sequence);
+
+// Zero-copy read: returns a pointer into the mapping for the payload
+// read_bytes would copy. The view stays readable until close, but its contents are only
+// guaranteed to match `generation` while validate_borrow returns true.
+const unsigned char* SharedMemory_borrow(SharedMemory* self, size_t* out_size, uint32_t* out_generation);
+bool SharedMemory_validate_borrow(SharedMemory* self, uint32_t generation);
+
+// Blocks until a completed write moves the sequence past `last_sequence`.
+// Returns false on timeout; `out_sequence` receives the new sequence.
+uint32_t SharedMemory_get_sequence(SharedMemory* self);
+bool SharedMemory_wait_for_change(SharedMemory* self, uint32_t last_sequence, DWORD timeout_ms, uint32_t* out_sequence);
+// Grows the data region to `new_size`; other handles remap lazily on their
+// next call. Growth is a write: it takes the write lock itself unless this
+// handle already holds it, and keeps it until other handles can see the
+// new generation. Writers that hold lock_for_writing therefore never write
+// to a view the grow has already copied. Views returned by borrow() do not
+// survive it.
+bool SharedMemory_grow(SharedMemory* self, size_t new_size);
+
+// In-place updates for patterns that keep their own layout in the data
+// region. The sequence stays odd from begin_update to end_update; touch
+// records each modified range for the high-water mark and persistence, and
+// outside an update flushes it straight away in SYNC mode.
+// Pointers into `data` must be re-derived after refresh or grow. Both
+// return false when the segment grew and this handle could not remap;
+// begin_update then leaves the sequence alone and must not be ended.
+bool SharedMemory_refresh(SharedMemory* self);
+// Lock-free readers pin the view for the length of one read: pin follows
+// any growth and then keeps this handle's other threads from remapping
+// until unpin, so `header` and `data` stay mapped in between. The read
+// methods above pin for themselves. A pinned thread must not refresh,
+// grow, write or take a lock that waits on a writer of this handle.
+bool SharedMemory_pin(SharedMemory* self);
+void SharedMemory_unpin(SharedMemory* self);
+bool SharedMemory_begin_update(SharedMemory* self);
+void SharedMemory_touch(SharedMemory* self, size_t offset, size_t length);
+uint32_t SharedMemory_end_update(SharedMemory* self);
 void SharedMemory_clear(SharedMemory* self);
 void SharedMemory_close(SharedMemory* self);
 void SharedMemory_unlink(SharedMemory* self);
@@ -48,5 +211,7 @@ void SharedMemory_unlink(SharedMemory* self);
 // Lock-related method implementations
 bool SharedMemory_lock_for_writing(SharedMemory* self, DWORD timeout_ms);
 bool SharedMemory_unlock_from_writing(SharedMemory* self);
+bool SharedMemory_lock_for_reading(SharedMemory* self, DWORD timeout_ms);
+bool SharedMemory_unlock_from_reading(SharedMemory* self);
 
 #endif // SHARED_MEMORY_H
\ No newline at end of file
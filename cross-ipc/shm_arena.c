@@ -0,0 +1,337 @@
+#include "shm_arena.h"
+#include <string.h>
+
+#define ARENA_ALIGN 8
+#define LARGE_MIN 32  // Header, two links and a footer
+
+static const uint32_t small_sizes[SHM_ARENA_SMALL_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 768, 1024, 1536, 2048
+};
+
+// Links kept in the payload of a free large block
+typedef struct LargeLinks {
+    uint64_t next;
+    uint64_t prev;
+} LargeLinks;
+
+static uint64_t align_up(uint64_t value) {
+    return (value + ARENA_ALIGN - 1) & ~(uint64_t)(ARENA_ALIGN - 1);
+}
+
+static ShmArenaBlock* block_at(ShmArenaView* view, uint64_t offset) {
+    return (ShmArenaBlock*)(view->base + offset);
+}
+
+static uint32_t block_size(ShmArenaBlock* block) {
+    return block->size & SHM_ARENA_SIZE_MASK;
+}
+
+static uint64_t* payload_word(ShmArenaView* view, uint64_t block) {
+    return (uint64_t*)(view->base + block + SHM_ARENA_HEADER);
+}
+
+static LargeLinks* links_at(ShmArenaView* view, uint64_t block) {
+    return (LargeLinks*)(view->base + block + SHM_ARENA_HEADER);
+}
+
+static uint64_t* footer_at(ShmArenaView* view, uint64_t block, uint32_t size) {
+    return (uint64_t*)(view->base + block + size - sizeof(uint64_t));
+}
+
+static void touch(ShmArenaView* view, uint64_t offset, size_t length) {
+    if (view->touch) {
+        view->touch(view->touch_ctx, offset, length);
+    }
+}
+
+static void touch_arena(ShmArenaView* view) {
+    touch(view, (uint64_t)((unsigned char*)view->arena - view->base), sizeof(ShmArena));
+}
+
+static int small_class(uint64_t size) {
+    for (int i = 0; i < SHM_ARENA_SMALL_CLASSES; i++) {
+        if (size <= small_sizes[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int large_bin(uint64_t size) {
+    int bin = 0;
+    while (size >= 64 && bin < SHM_ARENA_LARGE_BINS - 1) {
+        size >>= 1;
+        bin++;
+    }
+    return bin;
+}
+
+static void set_prev_free(ShmArenaView* view, uint64_t block, bool prev_free) {
+    if (block >= view->arena->top) {
+        return;
+    }
+    ShmArenaBlock* header = block_at(view, block);
+    header->size = prev_free ? (header->size | SHM_ARENA_PREV_FREE) : (header->size & ~(uint32_t)SHM_ARENA_PREV_FREE);
+    touch(view, block, sizeof(ShmArenaBlock));
+}
+
+static void large_link(ShmArenaView* view, uint64_t block, uint32_t size) {
+    ShmArena* arena = view->arena;
+    int bin = large_bin(size);
+    LargeLinks* links = links_at(view, block);
+
+    block_at(view, block)->size = size | SHM_ARENA_FREE;
+    block_at(view, block)->requested = 0;
+    *footer_at(view, block, size) = size;
+    links->prev = 0;
+    links->next = arena->large_free[bin];
+    if (links->next) {
+        links_at(view, links->next)->prev = block;
+        touch(view, links->next + SHM_ARENA_HEADER, sizeof(LargeLinks));
+    }
+    arena->large_free[bin] = block;
+    arena->large_free_bytes += size;
+
+    touch(view, block, SHM_ARENA_HEADER + sizeof(LargeLinks));
+    touch(view, block + size - sizeof(uint64_t), sizeof(uint64_t));
+}
+
+static void large_unlink(ShmArenaView* view, uint64_t block) {
+    ShmArena* arena = view->arena;
+    uint32_t size = block_size(block_at(view, block));
+    LargeLinks* links = links_at(view, block);
+
+    if (links->prev) {
+        links_at(view, links->prev)->next = links->next;
+        touch(view, links->prev + SHM_ARENA_HEADER, sizeof(LargeLinks));
+    }
+    else {
+        arena->large_free[large_bin(size)] = links->next;
+    }
+    if (links->next) {
+        links_at(view, links->next)->prev = links->prev;
+        touch(view, links->next + SHM_ARENA_HEADER, sizeof(LargeLinks));
+    }
+    arena->large_free_bytes -= size;
+}
+
+// First fit within the size's own bin, then the head of any larger bin,
+// which always fits. Splits off the remainder when it is worth keeping.
+static uint64_t large_take(ShmArenaView* view, uint32_t size) {
+    ShmArena* arena = view->arena;
+    uint64_t found = 0;
+
+    for (uint64_t block = arena->large_free[large_bin(size)]; block; block = links_at(view, block)->next) {
+        if (block_size(block_at(view, block)) >= size) {
+            found = block;
+            break;
+        }
+    }
+    for (int bin = large_bin(size) + 1; !found && bin < SHM_ARENA_LARGE_BINS; bin++) {
+        found = arena->large_free[bin];
+    }
+    if (!found) {
+        return 0;
+    }
+
+    large_unlink(view, found);
+    uint32_t found_size = block_size(block_at(view, found));
+    if (found_size - size >= LARGE_MIN) {
+        large_link(view, found + size, found_size - size);
+        found_size = size;
+    }
+    else {
+        set_prev_free(view, found + found_size, false);
+    }
+
+    // Free blocks are always coalesced, so the block below is in use
+    block_at(view, found)->size = found_size;
+    return found;
+}
+
+// Carves a block off the untouched tail
+static uint64_t tail_take(ShmArenaView* view, uint32_t size) {
+    ShmArena* arena = view->arena;
+    if (arena->top + size > arena->end) {
+        return 0;
+    }
+
+    uint64_t block = arena->top;
+    arena->top += size;
+    block_at(view, block)->size = size;
+    return block;
+}
+
+static uint64_t large_alloc(ShmArenaView* view, uint32_t size) {
+    uint64_t block = large_take(view, size);
+    return block ? block : tail_take(view, size);
+}
+
+// Takes one large block and threads all of it onto a class free list
+static bool slab_refill(ShmArenaView* view, int cls) {
+    ShmArena* arena = view->arena;
+    uint64_t slab = large_alloc(view, SHM_ARENA_SLAB_SIZE);
+    if (!slab) {
+        return false;
+    }
+
+    uint32_t size = small_sizes[cls];
+    uint64_t first = slab + SHM_ARENA_HEADER;
+    uint64_t count = (SHM_ARENA_SLAB_SIZE - SHM_ARENA_HEADER) / size;
+
+    block_at(view, slab)->requested = 0;
+    for (uint64_t i = count; i-- > 0;) {
+        uint64_t block = first + i * size;
+        block_at(view, block)->size = size | SHM_ARENA_SMALL | SHM_ARENA_FREE;
+        block_at(view, block)->requested = 0;
+        *payload_word(view, block) = arena->small_free[cls];
+        arena->small_free[cls] = block;
+    }
+
+    arena->small_free_bytes += count * size;
+    arena->slab_count++;
+    touch(view, slab, SHM_ARENA_SLAB_SIZE);
+    return true;
+}
+
+void ipc_arena_format(ShmArenaView* view, uint64_t start, uint64_t end) {
+    ShmArena* arena = view->arena;
+
+    memset(arena, 0, sizeof(*arena));
+    arena->start = align_up(start);
+    arena->top = arena->start;
+    arena->end = end & ~(uint64_t)(ARENA_ALIGN - 1);
+    arena->magic = SHM_ARENA_MAGIC;
+    touch_arena(view);
+}
+
+uint64_t ipc_arena_alloc(ShmArenaView* view, size_t size) {
+    ShmArena* arena = view->arena;
+    if (size > UINT32_MAX - SHM_ARENA_SLAB_SIZE) {
+        return 0;
+    }
+
+    uint64_t need = align_up((uint64_t)size + SHM_ARENA_HEADER);
+    uint64_t block;
+
+    int cls = need <= SHM_ARENA_SMALL_MAX ? small_class(need) : -1;
+    if (cls >= 0) {
+        if (!arena->small_free[cls] && !slab_refill(view, cls)) {
+            return 0;
+        }
+        block = arena->small_free[cls];
+        arena->small_free[cls] = *payload_word(view, block);
+        arena->small_free_bytes -= small_sizes[cls];
+        block_at(view, block)->size = small_sizes[cls] | SHM_ARENA_SMALL;
+    }
+    else {
+        block = large_alloc(view, (uint32_t)(need < LARGE_MIN ? LARGE_MIN : need));
+        if (!block) {
+            return 0;
+        }
+    }
+
+    ShmArenaBlock* header = block_at(view, block);
+    header->requested = (uint32_t)size;
+    arena->allocated_bytes += block_size(header);
+    arena->requested_bytes += size;
+    arena->allocation_count++;
+
+    touch(view, block, sizeof(ShmArenaBlock));
+    touch_arena(view);
+    return block + SHM_ARENA_HEADER;
+}
+
+void ipc_arena_free(ShmArenaView* view, uint64_t offset) {
+    ShmArena* arena = view->arena;
+    if (offset == 0) {
+        return;
+    }
+
+    uint64_t block = offset - SHM_ARENA_HEADER;
+    ShmArenaBlock* header = block_at(view, block);
+    uint32_t size = block_size(header);
+
+    arena->allocated_bytes -= size;
+    arena->requested_bytes -= header->requested;
+    arena->allocation_count--;
+
+    if (header->size & SHM_ARENA_SMALL) {
+        int cls = small_class(size);
+        header->size |= SHM_ARENA_FREE;
+        header->requested = 0;
+        *payload_word(view, block) = arena->small_free[cls];
+        arena->small_free[cls] = block;
+        arena->small_free_bytes += size;
+        touch(view, block, SHM_ARENA_HEADER + sizeof(uint64_t));
+        touch_arena(view);
+        return;
+    }
+
+    // Merge with the free neighbours on either side
+    uint64_t next = block + size;
+    if (next < arena->top && (block_at(view, next)->size & SHM_ARENA_FREE)) {
+        large_unlink(view, next);
+        size += block_size(block_at(view, next));
+    }
+    if (header->size & SHM_ARENA_PREV_FREE) {
+        uint64_t prev = block - *(uint64_t*)(view->base + block - sizeof(uint64_t));
+        large_unlink(view, prev);
+        size += (uint32_t)(block - prev);
+        block = prev;
+    }
+
+    // A free run that reaches the tail just moves the tail back
+    if (block + size == arena->top) {
+        arena->top = block;
+    }
+    else {
+        large_link(view, block, size);
+        set_prev_free(view, block + size, true);
+    }
+    touch_arena(view);
+}
+
+size_t ipc_arena_usable_size(ShmArenaView* view, uint64_t offset) {
+    return block_size(block_at(view, offset - SHM_ARENA_HEADER)) - SHM_ARENA_HEADER;
+}
+
+void ipc_arena_extend(ShmArenaView* view, uint64_t new_end) {
+    new_end &= ~(uint64_t)(ARENA_ALIGN - 1);
+    if (new_end > view->arena->end) {
+        view->arena->end = new_end;
+        touch_arena(view);
+    }
+}
+
+void ipc_arena_stats(ShmArenaView* view, ShmArenaStats* stats) {
+    ShmArena* arena = view->arena;
+    uint64_t tail = arena->end - arena->top;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->capacity = arena->end - arena->start;
+    stats->used = arena->top - arena->start;
+    stats->allocated = arena->allocated_bytes;
+    stats->requested = arena->requested_bytes;
+    stats->free = arena->small_free_bytes + arena->large_free_bytes + tail;
+    stats->allocations = arena->allocation_count;
+    stats->slabs = arena->slab_count;
+
+    // The largest extent is in the highest non-empty bin, or is the tail
+    stats->largest_free = tail;
+    for (int bin = SHM_ARENA_LARGE_BINS - 1; bin >= 0; bin--) {
+        if (!arena->large_free[bin]) {
+            continue;
+        }
+        for (uint64_t block = arena->large_free[bin]; block; block = links_at(view, block)->next) {
+            uint64_t size = block_size(block_at(view, block)) - SHM_ARENA_HEADER;
+            if (size > stats->largest_free) {
+                stats->largest_free = size;
+            }
+        }
+        break;
+    }
+
+    stats->utilization = stats->used ? (double)stats->requested / (double)stats->used : 0.0;
+    stats->fragmentation = stats->free ? 1.0 - (double)stats->largest_free / (double)stats->free : 0.0;
+}
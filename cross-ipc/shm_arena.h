@@ -0,0 +1,92 @@
+#pragma once
+#ifndef SHM_ARENA_H
+#define SHM_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A heap that lives inside a shared memory segment. Every link is an offset
+// from the region base rather than a pointer, so processes that map the
+// segment at different addresses, or remap it after growth, share it as is.
+// The arena does no locking of its own; callers serialize writers.
+//
+// Blocks of up to SHM_ARENA_SMALL_MAX bytes come from slabs, each carved
+// into blocks of one size class with a free list per class. Larger blocks
+// are carved from the untouched tail, kept on power-of-two free bins when
+// released, and coalesced with free neighbours using boundary tags.
+
+#define SHM_ARENA_MAGIC 0x4E524153u        // "SARN"
+#define SHM_ARENA_HEADER 8                 // Block header in front of each payload
+#define SHM_ARENA_SMALL_CLASSES 17
+#define SHM_ARENA_SMALL_MAX 2048           // Largest slab block, header included
+#define SHM_ARENA_SLAB_SIZE (16 * 1024)    // Bytes taken per slab
+#define SHM_ARENA_LARGE_BINS 32
+
+// Low bits of ShmArenaBlock.size; block sizes are multiples of 8
+#define SHM_ARENA_FREE 1
+#define SHM_ARENA_PREV_FREE 2   // The block just below is free; its size is in its last 8 bytes
+#define SHM_ARENA_SMALL 4       // Slab block; never coalesced
+#define SHM_ARENA_SIZE_MASK (~(uint32_t)7)
+
+typedef struct ShmArenaBlock {
+    uint32_t size;       // Whole block, header included, with the flags above
+    uint32_t requested;  // Bytes the caller asked for; 0 while free
+} ShmArenaBlock;
+
+// Lives in the segment
+typedef struct ShmArena {
+    uint32_t magic;
+    uint32_t slab_count;
+    uint64_t start;      // First block
+    uint64_t top;        // Blocks end here; nothing in [top, end) was ever handed out
+    uint64_t end;
+    uint64_t small_free[SHM_ARENA_SMALL_CLASSES];  // Singly linked through the payload
+    uint64_t large_free[SHM_ARENA_LARGE_BINS];     // Doubly linked through the payload
+    uint64_t allocated_bytes;    // Block bytes held by live allocations
+    uint64_t requested_bytes;    // Bytes callers asked for in those allocations
+    uint64_t allocation_count;
+    uint64_t small_free_bytes;
+    uint64_t large_free_bytes;
+} ShmArena;
+
+// How a process reaches an arena. `touch`, when set, is told about every
+// byte range the arena writes so persistent segments can flush them.
+typedef struct ShmArenaView {
+    unsigned char* base;  // Offsets are relative to this
+    ShmArena* arena;
+    void (*touch)(void* ctx, uint64_t offset, size_t length);
+    void* touch_ctx;
+} ShmArenaView;
+
+typedef struct ShmArenaStats {
+    uint64_t capacity;      // Bytes the arena spans
+    uint64_t used;          // Bytes ever carved out (start to top)
+    uint64_t allocated;     // Block bytes held by live allocations
+    uint64_t requested;     // Bytes callers asked for
+    uint64_t free;          // Free-list bytes plus the untouched tail
+    uint64_t largest_free;  // Largest single extent a large allocation could use
+    uint64_t allocations;
+    uint32_t slabs;
+    double utilization;     // requested / used
+    double fragmentation;   // Share of free space outside the largest extent
+} ShmArenaStats;
+
+// Lays an empty arena over [start, end), offsets relative to view->base.
+// view->arena must already point at room for the ShmArena header.
+void ipc_arena_format(ShmArenaView* view, uint64_t start, uint64_t end);
+
+// Returns the payload offset of a block of at least `size` bytes, 8-byte
+// aligned, or 0 when the arena is full.
+uint64_t ipc_arena_alloc(ShmArenaView* view, size_t size);
+void ipc_arena_free(ShmArenaView* view, uint64_t offset);
+
+// Bytes the block at `offset` can hold, which may exceed what was requested
+size_t ipc_arena_usable_size(ShmArenaView* view, uint64_t offset);
+
+// Makes [old end, new_end) available after the segment has grown
+void ipc_arena_extend(ShmArenaView* view, uint64_t new_end);
+
+void ipc_arena_stats(ShmArenaView* view, ShmArenaStats* stats);
+
+#endif // SHM_ARENA_H
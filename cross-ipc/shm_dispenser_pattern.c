@@ -50,8 +50,13 @@ void ShmDispenserPattern_init(ShmDispenserPattern* dispenser, const char* id, Sh
     dispenser->not_full_semaphore = NULL;
     dispenser->is_provider = false;
     dispenser->verbose = verbose;
+    dispenser->numa_policy = SHM_NUMA_DEFAULT;
+    dispenser->numa_node = 0;
+    dispenser->numa_applied = false;
 
     
+    dispenser->set_numa = ShmDispenserPattern_set_numa;
+    dispenser->get_numa_stats = ShmDispenserPattern_get_numa_stats;
     dispenser->setup = ShmDispenserPattern_setup;
     dispenser->add = ShmDispenserPattern_add;
     dispenser->add_front = ShmDispenserPattern_add_front;
@@ -75,6 +80,23 @@ void ShmDispenserPattern_init(ShmDispenserPattern* dispenser, const char* id, Sh
     }
 }
 
+void ShmDispenserPattern_set_numa(ShmDispenserPattern* self, ShmNumaPolicy policy, int node) {
+    if (self->shm_data) {
+        if (self->verbose) {
+            printf("NUMA placement must be set before setup\n");
+        }
+        return;
+    }
+
+    self->numa_policy = policy;
+    self->numa_node = policy == SHM_NUMA_CONSUMER ? -1 : node;
+}
+
+void ShmDispenserPattern_get_numa_stats(ShmDispenserPattern* self, ShmNumaStats* out_stats) {
+    size_t shm_size = self->shm_data ? calculate_shm_size(self->shm_data->capacity, self->shm_data->item_size) : 0;
+    ipc_numa_fill_stats(out_stats, self->shm_data, shm_size, self->numa_policy, self->numa_node, self->numa_applied);
+}
+
 // Setup method
 bool ShmDispenserPattern_setup(ShmDispenserPattern* self, size_t capacity, size_t item_size) {
     if (self->verbose) {
@@ -130,13 +152,17 @@ bool ShmDispenserPattern_setup(ShmDispenserPattern* self, size_t capacity, size_
         self->is_provider = true;
     }
 
-    // Map shared memory
-    self->shm_data = (ShmDispenserData*)MapViewOfFile(
+    // Map shared memory, on the requested NUMA node if there is one
+    if (self->numa_policy == SHM_NUMA_CONSUMER && self->numa_node < 0) {
+        self->numa_node = ipc_numa_current_node();
+    }
+    self->shm_data = (ShmDispenserData*)ipc_numa_map_view(
         self->shm_handle,
         FILE_MAP_ALL_ACCESS,
-        0,
-        0,
-        shm_size
+        shm_size,
+        self->numa_policy,
+        self->numa_node,
+        &self->numa_applied
     );
 
     if (self->shm_data == NULL) {
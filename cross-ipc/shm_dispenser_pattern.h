@@ -10,6 +10,7 @@ typedef struct ShmDispenserPattern ShmDispenserPattern;
 
 // Instead, include cross_ipc.h to get the enum definition
 #include "cross_ipc.h"
+#include "numa.h"
 
 // Shared memory structure
 #pragma pack(push, 1)
@@ -36,8 +37,13 @@ typedef struct ShmDispenserPattern {
     HANDLE not_full_semaphore;  // Semaphore to signal when dispenser is not full
     bool is_provider;          // Whether this instance created the shared memory
     bool verbose;              // Whether to print verbose output
+    ShmNumaPolicy numa_policy; // Placement for the mapping, set before setup
+    int numa_node;
+    bool numa_applied;
 
     // Method pointers
+    void (*set_numa)(struct ShmDispenserPattern* self, ShmNumaPolicy policy, int node);
+    void (*get_numa_stats)(struct ShmDispenserPattern* self, ShmNumaStats* out_stats);
     bool (*setup)(struct ShmDispenserPattern* self, size_t capacity, size_t item_size);
     bool (*add)(struct ShmDispenserPattern* self, const void* item, size_t item_size);
     bool (*add_front)(struct ShmDispenserPattern* self, const void* item, size_t item_size);
@@ -61,6 +67,8 @@ typedef struct ShmDispenserPattern {
 void ShmDispenserPattern_init(ShmDispenserPattern* dispenser, const char* id, ShmDispenserMode mode, bool verbose);
 
 // Method implementations
+void ShmDispenserPattern_set_numa(ShmDispenserPattern* self, ShmNumaPolicy policy, int node);
+void ShmDispenserPattern_get_numa_stats(ShmDispenserPattern* self, ShmNumaStats* out_stats);
 bool ShmDispenserPattern_setup(ShmDispenserPattern* self, size_t capacity, size_t item_size);
 bool ShmDispenserPattern_add(ShmDispenserPattern* self, const void* item, size_t item_size);
 bool ShmDispenserPattern_add_front(ShmDispenserPattern* self, const void* item, size_t item_size);
@@ -4,559 +4,3088 @@
 #include <string.h>
 #include <stdint.h>
 #include <windows.h>
+#include <process.h>
 
-#define INITIAL_CAPACITY 16
+#define RECORD_ALIGN 8
+#define MAX_LOAD_PERCENT 70  // Live entries plus tombstones, as a share of the buckets
 
 
-static int find_entry_index(StoreDictPattern* dict, const char* key) {
-    for (size_t i = 0; i < dict->entry_count; i++) {
-        if (strcmp(dict->entries[i].key, key) == 0) {
-            return (int)i;
+static size_t align_up(size_t value) {
+    return (value + RECORD_ALIGN - 1) & ~(size_t)(RECORD_ALIGN - 1);
+}
+
+// Writer side of the seqlocks readers validate against
+static void seq_begin(volatile uint32_t* seq) {
+    ipc_atomic_store_u32(seq, *seq + 1);
+    ipc_atomic_fence();
+}
+
+static void seq_end(volatile uint32_t* seq) {
+    ipc_atomic_fence();
+    ipc_atomic_store_u32(seq, *seq + 1);
+}
+
+// Bytes a record needs; the arena rounds the block up to its size class
+static size_t record_size(uint32_t key_len, size_t value_size) {
+    return align_up(sizeof(StoreDictRecord) + key_len) + value_size;
+}
+
+// Layout accessors. These derive from shm.data every time, because any
+// grow or rebuild may move the mapping.
+static StoreDictHeader* dict_header(StoreDictPattern* dict) {
+    return (StoreDictHeader*)dict->shm.data;
+}
+
+static StoreDictBucket* dict_buckets(StoreDictPattern* dict) {
+    return (StoreDictBucket*)(dict->shm.data + dict_header(dict)->buckets);
+}
+
+static void arena_touch(void* ctx, uint64_t offset, size_t length) {
+    StoreDictPattern* dict = (StoreDictPattern*)ctx;
+    dict->shm.touch(&dict->shm, (size_t)offset, length);
+}
+
+static ShmArenaView dict_arena(StoreDictPattern* dict) {
+    ShmArenaView view = { dict->shm.data, &dict_header(dict)->arena, arena_touch, dict };
+    return view;
+}
+
+static StoreDictRecord* dict_record(StoreDictPattern* dict, uint64_t offset) {
+    return (StoreDictRecord*)(dict->shm.data + offset);
+}
+
+static char* record_key(StoreDictRecord* record) {
+    return (char*)(record + 1);
+}
+
+static unsigned char* record_value(StoreDictRecord* record) {
+    return (unsigned char*)record + align_up(sizeof(StoreDictRecord) + record->key_len);
+}
+
+static bool table_ready(StoreDictPattern* dict) {
+    return dict->shm.data && dict->shm.size >= sizeof(StoreDictHeader) &&
+        dict_header(dict)->magic == STORE_DICT_MAGIC;
+}
+
+// Linear probing. Returns true with the bucket holding `key`, or false with
+// the bucket an insert should take (the first tombstone on the chain if any).
+static bool find_bucket(StoreDictPattern* dict, const IpcName* key, uint32_t* out_index) {
+    StoreDictHeader* header = dict_header(dict);
+    StoreDictBucket* buckets = dict_buckets(dict);
+    uint32_t mask = header->bucket_count - 1;
+    uint32_t insert_at = UINT32_MAX;
+
+    for (uint32_t probe = 0; probe < header->bucket_count; probe++) {
+        uint32_t index = (uint32_t)(key->hash + probe) & mask;
+        StoreDictBucket* bucket = &buckets[index];
+
+        if (bucket->record == STORE_DICT_EMPTY) {
+            *out_index = insert_at != UINT32_MAX ? insert_at : index;
+            return false;
+        }
+        if (bucket->record == STORE_DICT_TOMBSTONE) {
+            if (insert_at == UINT32_MAX) {
+                insert_at = index;
+            }
+            continue;
+        }
+        if (bucket->hash == key->hash) {
+            StoreDictRecord* record = dict_record(dict, bucket->record);
+            if (record->key_len == key->len && ipc_name_equal(record_key(record), key->text, key->len)) {
+                *out_index = index;
+                return true;
+            }
+        }
+    }
+
+    *out_index = insert_at;
+    return false;
+}
+
+// Frees the slot of a process that died with counter ops counted in it, so
+// drains stop waiting on it. The pid goes to RESETTING first, so nobody
+// else can claim or reset the slot meanwhile; the caller then stores the
+// slot's new owner, or 0.
+static bool gate_slot_take_if_dead(StoreDictGateSlot* slot, uint32_t owner) {
+    if (owner == 0 || owner == STORE_DICT_COUNTER_SLOT_RESETTING ||
+        ipc_process_alive(owner, ipc_atomic_load_u32(&slot->token), ipc_atomic_load_u32(&slot->ns))) {
+        return false;
+    }
+    if (!ipc_atomic_cas_u32(&slot->pid, owner, STORE_DICT_COUNTER_SLOT_RESETTING)) {
+        return false;
+    }
+    ipc_atomic_store_u32(&slot->token, 0);
+    ipc_atomic_store_u32(&slot->inside, 0);
+    return true;
+}
+
+// Closes the counter gate and waits for lock-free counter updates already
+// inside to leave. Nothing enters a closed gate, so once drained it can be
+// copied or zeroed with the segment and reopened with a plain store. An
+// update takes well under a microsecond, so a count that outlasts a few
+// yields is checked against its process, and discarded if that process
+// has died. A live handle that stalls inside for the whole wait is given
+// up on, and false returned.
+static bool counters_drain(StoreDictPattern* dict) {
+    StoreDictHeader* header = dict_header(dict);
+    ipc_atomic_fetch_or_u32(&header->counter_gate, STORE_DICT_COUNTER_GATE_CLOSED);
+    ipc_atomic_fence();
+
+    unsigned long long deadline = ipc_now_ms() + STORE_DICT_COUNTER_DRAIN_MS;
+    for (uint32_t pass = 1;; pass++) {
+        bool drained = true;
+        for (uint32_t i = 0; i < STORE_DICT_COUNTER_GATE_SLOTS; i++) {
+            StoreDictGateSlot* slot = &header->counter_slots[i];
+            if (ipc_atomic_load_u32(&slot->inside) == 0) {
+                continue;
+            }
+            if (pass % 16 == 0 && gate_slot_take_if_dead(slot, ipc_atomic_load_u32(&slot->pid))) {
+                ipc_atomic_store_u32(&slot->pid, 0);
+                if (dict->verbose) {
+                    printf("StoreDictPattern: Discarded counter updates of a process that died inside them\n");
+                }
+                continue;
+            }
+            drained = false;
+        }
+        if (drained) {
+            return true;
+        }
+        if (ipc_now_ms() > deadline) {
+            if (dict->verbose) {
+                printf("StoreDictPattern: Gave up waiting for counter updates in flight\n");
+            }
+            return false;
         }
+        ipc_yield();
     }
-    return -1;
 }
 
+static void counters_reopen(StoreDictPattern* dict) {
+    ipc_atomic_store_u32(&dict_header(dict)->counter_gate, 0);
+}
 
-static bool resize_entries(StoreDictPattern* dict, size_t new_capacity) {
-    if (dict->verbose) {
-        printf("resize_entries: Resizing from %zu to %zu\n", dict->entry_capacity, new_capacity);
+static void dict_free(StoreDictPattern* dict, uint64_t offset) {
+    ShmArenaView arena = dict_arena(dict);
+    ipc_arena_free(&arena, offset);
+}
+
+// Frees every retired counter block if the gate drains. An update in flight
+// entered before its block was retired, and one entering later can no longer
+// reach it, so an empty closed gate leaves nobody holding one. Returns
+// whether anything was freed. Called with the mutex and begin_update held.
+static bool counters_collect(StoreDictPattern* dict) {
+    StoreDictHeader* header = dict_header(dict);
+    if (!header->counter_retired) {
+        return false;
+    }
+
+    bool drained = counters_drain(dict);
+    if (drained) {
+        uint64_t offset = header->counter_retired;
+        while (offset) {
+            uint64_t next = dict_record(dict, offset)->expires_at;
+            dict_free(dict, offset);
+            offset = next;
+        }
+        header->counter_retired = 0;
+        header->counter_retired_count = 0;
+        dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+    }
+    counters_reopen(dict);
+    return drained;
+}
+
+// Puts a counter block that is no longer in any bucket on the retired list,
+// linked through `expires_at`, which counter updates never look at
+static void counters_retire(StoreDictPattern* dict, uint64_t offset) {
+    StoreDictHeader* header = dict_header(dict);
+    StoreDictRecord* record = dict_record(dict, offset);
+    record->expires_at = header->counter_retired;
+    dict->shm.touch(&dict->shm, (size_t)offset, sizeof(StoreDictRecord));
+    header->counter_retired = offset;
+    header->counter_retired_count++;
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+
+    if (header->counter_retired_count >= STORE_DICT_COUNTER_RETIRE_BATCH) {
+        counters_collect(dict);
     }
+}
 
-    if (new_capacity == 0) {
-        
-        free(dict->entries);
-        dict->entries = NULL;
-        dict->entry_capacity = 0;
+static bool ensure_segment_size(StoreDictPattern* dict, size_t needed) {
+    if (needed <= dict->shm.size) {
         return true;
     }
 
-    DictEntry* new_entries = NULL;
+    // Growing may copy the segment into a new section, and an update landing
+    // in the old one would be lost. Log headers have no gate.
+    bool gated = dict->mode == STORE_DICT_MODE_TABLE && dict_header(dict)->magic != STORE_DICT_LOG_MAGIC;
+    if (gated && !counters_drain(dict)) {
+        counters_reopen(dict);
+        if (dict->verbose) {
+            printf("StoreDictPattern: Not growing while counter updates are still in flight\n");
+        }
+        return false;
+    }
 
-    if (dict->entries == NULL) {
-        
-        new_entries = (DictEntry*)malloc(new_capacity * sizeof(DictEntry));
+    size_t new_size = dict->shm.size * 2 > needed ? dict->shm.size * 2 : needed;
+    bool grown = dict->shm.grow(&dict->shm, new_size);
+    if (gated) {
+        counters_reopen(dict);
     }
-    else {
-        // Reallocation
-        new_entries = (DictEntry*)realloc(dict->entries, new_capacity * sizeof(DictEntry));
+    if (!grown) {
+        if (dict->verbose) {
+            printf("StoreDictPattern: Failed to grow segment to %zu bytes\n", new_size);
+        }
+        return false;
+    }
+    return true;
+}
+
+// Allocates from the segment's arena, growing the segment once when the
+// arena is full. Returns 0 on failure. Any pointer into the segment is
+// stale afterwards.
+static uint64_t dict_alloc(StoreDictPattern* dict, size_t size) {
+    ShmArenaView arena = dict_arena(dict);
+    uint64_t offset = ipc_arena_alloc(&arena, size);
+    if (offset != 0) {
+        return offset;
+    }
+
+    // Retired counter blocks may make room without growing
+    if (counters_collect(dict)) {
+        arena = dict_arena(dict);
+        offset = ipc_arena_alloc(&arena, size);
+        if (offset != 0) {
+            return offset;
+        }
+    }
+
+    // Room for the block itself or for a fresh slab to carve it from
+    if (!ensure_segment_size(dict, dict->shm.size + size + SHM_ARENA_SLAB_SIZE)) {
+        return 0;
+    }
+    arena = dict_arena(dict);
+    ipc_arena_extend(&arena, dict->shm.size);
+    return ipc_arena_alloc(&arena, size);
+}
+
+// ---- Ordered index ----
+
+static StoreDictIndexNode* index_node(StoreDictPattern* dict, uint64_t offset) {
+    return (StoreDictIndexNode*)(dict->shm.data + offset);
+}
+
+static uint64_t* node_next(StoreDictIndexNode* node) {
+    return (uint64_t*)(node + 1);
+}
+
+static const char* node_key(StoreDictIndexNode* node) {
+    return (const char*)(node_next(node) + node->height);
+}
+
+// Bytewise, with a proper prefix sorting first. Lengths exclude the terminator.
+static int index_compare(const char* a, size_t a_len, const char* b, size_t b_len) {
+    int order = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (order != 0) {
+        return order;
+    }
+    return a_len < b_len ? -1 : a_len > b_len;
+}
+
+// Each extra level is kept with probability 1/4. The generator state lives
+// in the header so every writer draws from the same stream.
+static uint32_t index_random_height(StoreDictHeader* header) {
+    uint32_t x = header->index_seed ? header->index_seed : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    header->index_seed = x;
+
+    uint32_t height = 1;
+    while (height < STORE_DICT_INDEX_MAX_HEIGHT && (x & 3) == 0) {
+        height++;
+        x >>= 2;
+    }
+    return height;
+}
+
+// `key` must not point into the segment, since allocating may move it.
+// Returns 0 when the arena is full.
+static uint64_t index_alloc_node(StoreDictPattern* dict, const char* key, uint32_t key_len, uint32_t height) {
+    size_t size = sizeof(StoreDictIndexNode) + (size_t)height * sizeof(uint64_t) + key_len;
+    uint64_t offset = dict_alloc(dict, size);
+    if (!offset) {
+        return 0;
+    }
+
+    StoreDictIndexNode* node = index_node(dict, offset);
+    node->record = 0;
+    node->key_len = key_len;
+    node->height = height;
+    memset(node_next(node), 0, (size_t)height * sizeof(uint64_t));
+    memcpy((char*)node_key(node), key, key_len);
+    dict->shm.touch(&dict->shm, (size_t)offset, size);
+    return offset;
+}
+
+// Fills `preds`, when given, with the last node on each level whose key
+// sorts before `key`, and returns the first node at or after it (0 at the end)
+static uint64_t index_seek(StoreDictPattern* dict, const char* key, size_t key_len, uint64_t* preds) {
+    uint64_t current = dict_header(dict)->index;
+
+    for (int level = STORE_DICT_INDEX_MAX_HEIGHT - 1; level >= 0; level--) {
+        for (;;) {
+            uint64_t next = node_next(index_node(dict, current))[level];
+            if (!next) {
+                break;
+            }
+            StoreDictIndexNode* node = index_node(dict, next);
+            if (index_compare(node_key(node), node->key_len - 1, key, key_len) >= 0) {
+                break;
+            }
+            current = next;
+        }
+        if (preds) {
+            preds[level] = current;
+        }
+    }
+    return node_next(index_node(dict, current))[0];
+}
+
+// Returns the node holding `key`, 0 if there is none
+static uint64_t index_find(StoreDictPattern* dict, const IpcName* key, uint64_t* preds) {
+    uint64_t found = index_seek(dict, key->text, key->len - 1, preds);
+    if (found) {
+        StoreDictIndexNode* node = index_node(dict, found);
+        if (node->key_len != key->len || memcmp(node_key(node), key->text, key->len) != 0) {
+            found = 0;
+        }
+    }
+    return found;
+}
+
+static void index_touch_node(StoreDictPattern* dict, uint64_t offset) {
+    StoreDictIndexNode* node = index_node(dict, offset);
+    dict->shm.touch(&dict->shm, (size_t)offset, sizeof(StoreDictIndexNode) + (size_t)node->height * sizeof(uint64_t));
+}
+
+// Splices a node from index_alloc_node in front of its successor. No
+// allocation, so it cannot fail once the node exists.
+static void index_link(StoreDictPattern* dict, uint64_t offset, uint64_t record) {
+    StoreDictIndexNode* node = index_node(dict, offset);
+    uint64_t preds[STORE_DICT_INDEX_MAX_HEIGHT];
+    index_seek(dict, node_key(node), node->key_len - 1, preds);
+
+    node->record = record;
+    for (uint32_t level = 0; level < node->height; level++) {
+        uint64_t* pred_next = node_next(index_node(dict, preds[level]));
+        node_next(node)[level] = pred_next[level];
+        pred_next[level] = offset;
+        index_touch_node(dict, preds[level]);
+    }
+    index_touch_node(dict, offset);
+}
+
+// Unlinks the node for `key` and returns it for the caller to free, 0 if absent
+static uint64_t index_unlink(StoreDictPattern* dict, const IpcName* key) {
+    uint64_t preds[STORE_DICT_INDEX_MAX_HEIGHT];
+    uint64_t found = index_find(dict, key, preds);
+    if (!found) {
+        return 0;
+    }
+
+    StoreDictIndexNode* node = index_node(dict, found);
+    for (uint32_t level = 0; level < node->height; level++) {
+        uint64_t* pred_next = node_next(index_node(dict, preds[level]));
+        if (pred_next[level] == found) {
+            pred_next[level] = node_next(node)[level];
+            index_touch_node(dict, preds[level]);
+        }
+    }
+    return found;
+}
+
+static void index_set_record(StoreDictPattern* dict, const IpcName* key, uint64_t record) {
+    uint64_t found = index_find(dict, key, NULL);
+    if (found) {
+        index_node(dict, found)->record = record;
+        dict->shm.touch(&dict->shm, (size_t)found, sizeof(StoreDictIndexNode));
+    }
+}
+
+static uint64_t index_alloc_head(StoreDictPattern* dict) {
+    return index_alloc_node(dict, "", 1, STORE_DICT_INDEX_MAX_HEIGHT);
+}
+
+// Frees every node, head included
+static void index_drop(StoreDictPattern* dict) {
+    uint64_t current = dict_header(dict)->index;
+    dict_header(dict)->index = 0;
+    while (current) {
+        uint64_t next = node_next(index_node(dict, current))[0];
+        dict_free(dict, current);
+        current = next;
+    }
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+}
+
+// Indexes every entry of a table that was formatted without an index.
+// Called with the mutex and begin_update held.
+static bool index_build(StoreDictPattern* dict) {
+    uint64_t head = index_alloc_head(dict);
+    if (!head) {
+        return false;
+    }
+    dict_header(dict)->index = head;
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+
+    for (uint32_t i = 0; i < dict_header(dict)->bucket_count; i++) {
+        uint64_t record = dict_buckets(dict)[i].record;
+        if (record <= STORE_DICT_TOMBSTONE) {
+            continue;
+        }
+
+        // The key is copied out first; allocating may remap the segment
+        StoreDictRecord* entry = dict_record(dict, record);
+        char* key = _strdup(record_key(entry));
+        uint32_t key_len = entry->key_len;
+        uint64_t node = key ? index_alloc_node(dict, key, key_len, index_random_height(dict_header(dict))) : 0;
+        free(key);
+
+        if (!node) {
+            index_drop(dict);
+            return false;
+        }
+        index_link(dict, node, record);
+    }
+
+    if (dict->verbose) {
+        printf("StoreDictPattern: Built ordered index over %u entries\n", dict_header(dict)->entry_count);
+    }
+    return true;
+}
+
+// Lays an arena and an empty table with `bucket_count` buckets over a
+// zero-filled segment. The caller holds begin_update.
+static bool format_table(StoreDictPattern* dict, uint32_t bucket_count) {
+    size_t buckets_size = (size_t)bucket_count * sizeof(StoreDictBucket);
+    if (!ensure_segment_size(dict, sizeof(StoreDictHeader) + buckets_size + SHM_ARENA_SLAB_SIZE)) {
+        return false;
+    }
+
+    ShmArenaView arena = dict_arena(dict);
+    ipc_arena_format(&arena, sizeof(StoreDictHeader), dict->shm.size);
+    uint64_t buckets = dict_alloc(dict, buckets_size);
+    if (!buckets) {
+        return false;
+    }
+    memset(dict->shm.data + buckets, 0, buckets_size);
+    dict->shm.touch(&dict->shm, (size_t)buckets, buckets_size);
+
+    uint64_t index = 0;
+    if (dict->ordered && !(index = index_alloc_head(dict))) {
+        return false;
     }
 
-    if (!new_entries) {
+    StoreDictHeader* header = dict_header(dict);
+    header->index = index;
+    header->capacity = dict->capacity;
+    header->buckets = buckets;
+    header->bucket_count = bucket_count;
+    header->entry_count = 0;
+    header->tombstone_count = 0;
+    ipc_atomic_fence();
+    header->magic = STORE_DICT_MAGIC;
+
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+    return true;
+}
+
+// Rehashes into a fresh bucket array of `bucket_count`, dropping
+// tombstones. Records stay where they are; only the old array is freed.
+// O(buckets), but only reached when the table fills up, so inserts stay
+// O(1) amortized.
+static bool rebuild_table(StoreDictPattern* dict, uint32_t bucket_count) {
+    size_t buckets_size = (size_t)bucket_count * sizeof(StoreDictBucket);
+    uint64_t fresh = dict_alloc(dict, buckets_size);
+    if (!fresh) {
         if (dict->verbose) {
-            printf("resize_entries: Failed to allocate memory for entries\n");
+            printf("StoreDictPattern: Failed to allocate %u buckets\n", bucket_count);
         }
         return false;
     }
 
-    dict->entries = new_entries;
-    dict->entry_capacity = new_capacity;
+    StoreDictHeader* header = dict_header(dict);
+    StoreDictBucket* old_buckets = dict_buckets(dict);
+    StoreDictBucket* buckets = (StoreDictBucket*)(dict->shm.data + fresh);
+    memset(buckets, 0, buckets_size);
+
+    for (uint32_t i = 0; i < header->bucket_count; i++) {
+        if (old_buckets[i].record > STORE_DICT_TOMBSTONE) {
+            uint32_t index = (uint32_t)old_buckets[i].hash & (bucket_count - 1);
+            while (buckets[index].record != STORE_DICT_EMPTY) {
+                index = (index + 1) & (bucket_count - 1);
+            }
+            buckets[index].hash = old_buckets[i].hash;
+            buckets[index].record = old_buckets[i].record;
+        }
+    }
+    dict->shm.touch(&dict->shm, (size_t)fresh, buckets_size);
+
+    // Readers still probing the old array see `layout` move and retry, so
+    // it can be freed straight away
+    uint64_t old = header->buckets;
+    seq_begin(&header->layout);
+    header->buckets = fresh;
+    header->bucket_count = bucket_count;
+    header->tombstone_count = 0;
+    seq_end(&header->layout);
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+    dict_free(dict, old);
 
     if (dict->verbose) {
-        printf("resize_entries: Resize successful\n");
+        printf("StoreDictPattern: Rebuilt table with %u buckets, %u entries\n",
+            bucket_count, header->entry_count);
     }
     return true;
 }
 
-// Constructor implementation
-void StoreDictPattern_init(StoreDictPattern* store, const char* id, size_t size, bool verbose) {
-    if (verbose) {
-        printf("StoreDictPattern_init: Initializing with id '%s' and size %zu\n", id, size);
+// Formats a zero-filled segment. Called with the mutex held.
+static bool ensure_table(StoreDictPattern* dict) {
+    if (table_ready(dict)) {
+        return true;
+    }
+    // Never format over a log another handle laid down
+    if (!dict->shm.data || dict_header(dict)->magic == STORE_DICT_LOG_MAGIC ||
+        !format_table(dict, STORE_DICT_INITIAL_BUCKETS)) {
+        return false;
     }
 
-    
-    SharedMemory_init(&store->shm, id, size, verbose);
+    if (dict->verbose) {
+        printf("StoreDictPattern: Formatted table with %d buckets\n", STORE_DICT_INITIAL_BUCKETS);
+    }
+    return true;
+}
 
-    
-    store->entries = NULL;
-    store->entry_count = 0;
-    store->entry_capacity = 0;
-    store->verbose = verbose;
-    store->version = 0;  // Initialize version to 0
+// Also follows any growth, so a handle that cannot remap fails here; once
+// it holds the mutex nobody else can grow the segment, and the
+// begin_update calls made under it always open.
+static bool lock_dict(StoreDictPattern* dict) {
+    DWORD wait_result = WaitForSingleObject(dict->mutex, 5000);
+    if (wait_result != WAIT_OBJECT_0 && wait_result != WAIT_ABANDONED) {
+        if (dict->verbose) {
+            printf("Failed to acquire mutex: %lu\n", GetLastError());
+        }
+        return false;
+    }
+    if (!dict->shm.refresh(&dict->shm)) {
+        ReleaseMutex(dict->mutex);
+        return false;
+    }
+    return true;
+}
 
-    // Create named mutex for synchronization
-    char mutex_name[256];
-    sprintf_s(mutex_name, sizeof(mutex_name), "StoreDictPattern_Mutex_%s", id);
-    store->mutex = CreateMutexA(NULL, FALSE, mutex_name);
-    
-    if (store->mutex == NULL && verbose) {
-        printf("Failed to create mutex: %lu\n", GetLastError());
+// Tells refresh_if_changed in other handles that something moved. Both
+// layouts keep the version in the same place.
+static void publish_version(StoreDictPattern* dict) {
+    StoreDictHeader* header = dict_header(dict);
+    header->version++;
+    dict->version = header->version;
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+}
+
+// ---- Expiry and eviction ----
+
+static bool record_expired(StoreDictRecord* record, unsigned long long now) {
+    return record->expires_at != 0 && record->expires_at <= now;
+}
+
+static void record_touch(StoreDictPattern* dict, StoreDictRecord* record) {
+    dict->shm.touch(&dict->shm, (size_t)((unsigned char*)record - dict->shm.data), sizeof(StoreDictRecord));
+}
+
+// Tombstones bucket `index` and frees its record and index node; a counter
+// block is retired instead, for updates that found it before the tombstone.
+// The caller holds the mutex and begin_update, and publishes the version.
+static void table_drop_entry(StoreDictPattern* dict, uint32_t index) {
+    StoreDictHeader* header = dict_header(dict);
+    StoreDictBucket* bucket = &dict_buckets(dict)[index];
+    uint64_t offset = bucket->record;
+    StoreDictRecord* record = dict_record(dict, offset);
+
+    bucket->record = STORE_DICT_TOMBSTONE;
+    header->entry_count--;
+    header->tombstone_count++;
+    if (record->expires_at) {
+        header->ttl_count--;
+    }
+    dict->shm.touch(&dict->shm, (size_t)((unsigned char*)bucket - dict->shm.data), sizeof(StoreDictBucket));
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+
+    // The node is found by the record's own key, so it goes first
+    if (header->index) {
+        IpcName name;
+        ipc_name_make(&name, record_key(record));
+        uint64_t node = index_unlink(dict, &name);
+        if (node) {
+            dict_free(dict, node);
+        }
+    }
+    if (record->flags & STORE_DICT_RECORD_COUNTER) {
+        counters_retire(dict, offset);
+    }
+    else {
+        dict_free(dict, offset);
     }
+}
 
-    
-    store->setup = StoreDictPattern_setup;
-    store->store = StoreDictPattern_store;
-    store->store_string = StoreDictPattern_store_string;
-    store->store_bytes = StoreDictPattern_store_bytes;
-    store->retrieve = StoreDictPattern_retrieve;
-    store->retrieve_bytes = StoreDictPattern_retrieve_bytes;
-    store->retrieve_string = StoreDictPattern_retrieve_string;
-    store->load = StoreDictPattern_load;
-    store->sync = StoreDictPattern_sync;
-    store->list_keys = StoreDictPattern_list_keys;
-    store->close = StoreDictPattern_close;
+// Removes expired entries from the next `budget` buckets. Called with the
+// mutex and begin_update held; publishes the version if anything went.
+static size_t table_sweep(StoreDictPattern* dict, uint32_t budget) {
+    StoreDictHeader* header = dict_header(dict);
+    if (header->ttl_count == 0) {
+        return 0;
+    }
+
+    unsigned long long now = ipc_wall_ms();
+    uint32_t mask = header->bucket_count - 1;
+    size_t expired = 0;
+    for (uint32_t n = 0; n < budget && n < header->bucket_count; n++) {
+        uint32_t index = header->sweep_cursor++ & mask;
+        uint64_t offset = dict_buckets(dict)[index].record;
+        if (offset > STORE_DICT_TOMBSTONE && record_expired(dict_record(dict, offset), now)) {
+            table_drop_entry(dict, index);
+            expired++;
+        }
+    }
+
+    header->expirations += expired;
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+    if (expired > 0) {
+        publish_version(dict);
+    }
+    return expired;
+}
+
+// One CLOCK step: clears referenced bits under the hand until it reaches
+// an entry without one and evicts it. Expired entries go first whatever
+// their bit. Returns false when nothing is left to evict.
+static bool table_evict_one(StoreDictPattern* dict) {
+    StoreDictHeader* header = dict_header(dict);
+    unsigned long long now = ipc_wall_ms();
+    uint32_t mask = header->bucket_count - 1;
+
+    // Two turns: the first may only clear bits
+    for (uint64_t n = 0; n < (uint64_t)header->bucket_count * 2; n++) {
+        uint32_t index = header->clock_hand++ & mask;
+        uint64_t offset = dict_buckets(dict)[index].record;
+        if (offset <= STORE_DICT_TOMBSTONE) {
+            continue;
+        }
+
+        StoreDictRecord* record = dict_record(dict, offset);
+        bool expired = record_expired(record, now);
+        if (record->referenced && !expired) {
+            record->referenced = 0;
+            record_touch(dict, record);
+            continue;
+        }
+
+        table_drop_entry(dict, index);
+        if (expired) {
+            header->expirations++;
+        }
+        else {
+            header->evictions++;
+        }
+        dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+        return true;
+    }
+    return false;
+}
+
+// Evicts until `needed` more bytes fit under the table's capacity. Called
+// with the mutex and begin_update held; moves buckets, so lookups made
+// before it are stale.
+static bool table_make_room(StoreDictPattern* dict, size_t needed) {
+    bool evicted = false;
+    bool fits = true;
+    bool collected = false;
+    while (dict_header(dict)->capacity &&
+        dict_header(dict)->arena.allocated_bytes + needed > dict_header(dict)->capacity) {
+        // Retired counter blocks go before any live entry
+        if (!collected) {
+            collected = true;
+            if (counters_collect(dict)) {
+                continue;
+            }
+        }
+        if (!table_evict_one(dict)) {
+            fits = false;
+            break;
+        }
+        evicted = true;
+    }
+
+    if (evicted) {
+        publish_version(dict);
+    }
+    return fits;
+}
+
+// Called with the mutex held after a read found `key` expired, or found it
+// unreferenced in a bounded table: removes it or sets its bit
+static void table_access(StoreDictPattern* dict, const IpcName* key) {
+    uint32_t index;
+    if (!table_ready(dict) || !find_bucket(dict, key, &index)) {
+        return;
+    }
+
+    StoreDictRecord* record = dict_record(dict, dict_buckets(dict)[index].record);
+    bool expired = record_expired(record, ipc_wall_ms());
+    if (!expired && (record->referenced || !dict_header(dict)->capacity)) {
+        return;
+    }
+
+    dict->shm.begin_update(&dict->shm);
+    if (expired) {
+        table_drop_entry(dict, index);
+        dict_header(dict)->expirations++;
+        publish_version(dict);
+    }
+    else {
+        record->referenced = 1;
+        record_touch(dict, record);
+    }
+    dict->shm.end_update(&dict->shm);
+}
+
+// ---- Log mode ----
+
+static StoreDictLogHeader* log_header(StoreDictPattern* dict) {
+    return (StoreDictLogHeader*)dict->shm.data;
+}
+
+static StoreDictLogRecord* log_record(StoreDictPattern* dict, uint64_t offset) {
+    return (StoreDictLogRecord*)(dict->shm.data + offset);
+}
+
+static size_t log_record_size(uint32_t key_len, size_t value_size) {
+    return align_up(sizeof(StoreDictLogRecord) + key_len) + align_up(value_size);
+}
+
+static unsigned char* log_record_value(StoreDictLogRecord* record) {
+    return (unsigned char*)record + align_up(sizeof(StoreDictLogRecord) + record->key_len);
+}
+
+static bool log_ready(StoreDictPattern* dict) {
+    return dict->shm.data && dict->shm.size >= sizeof(StoreDictLogHeader) &&
+        log_header(dict)->magic == STORE_DICT_LOG_MAGIC;
+}
+
+static bool layout_ready(StoreDictPattern* dict) {
+    return dict->mode == STORE_DICT_MODE_LOG ? log_ready(dict) : table_ready(dict);
+}
+
+// A handle attaching to an existing segment follows its layout, whatever
+// mode it was asked for
+static void adopt_layout(StoreDictPattern* dict) {
+    if (!dict->shm.data || dict->shm.size < sizeof(StoreDictLogHeader)) {
+        return;
+    }
+    uint32_t magic = dict_header(dict)->magic;
+    StoreDictMode mode = dict->mode;
+    if (magic == STORE_DICT_MAGIC) {
+        mode = STORE_DICT_MODE_TABLE;
+    }
+    else if (magic == STORE_DICT_LOG_MAGIC) {
+        mode = STORE_DICT_MODE_LOG;
+    }
+
+    if (mode != dict->mode && dict->verbose) {
+        printf("StoreDictPattern: Segment is already in %s mode\n", mode == STORE_DICT_MODE_LOG ? "log" : "table");
+    }
+    dict->mode = mode;
+}
+
+static void log_index_reset(StoreDictLogIndex* index) {
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        free(index->slots[i].key);
+    }
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+// Linear probing over the private index; same contract as find_bucket
+static StoreDictLogSlot* log_index_find(StoreDictLogIndex* index, const IpcName* key, bool* out_found) {
+    uint32_t mask = index->capacity - 1;
+    *out_found = false;
+
+    for (uint32_t i = (uint32_t)key->hash & mask;; i = (i + 1) & mask) {
+        StoreDictLogSlot* slot = &index->slots[i];
+        if (!slot->key) {
+            return slot;
+        }
+        if (slot->hash == key->hash && slot->key_len == key->len && ipc_name_equal(slot->key, key->text, key->len)) {
+            *out_found = true;
+            return slot;
+        }
+    }
+}
+
+static bool log_index_reserve(StoreDictLogIndex* index, uint32_t needed) {
+    if ((uint64_t)needed * 2 <= index->capacity) {
+        return true;
+    }
+
+    uint32_t capacity = index->capacity ? index->capacity * 2 : STORE_DICT_INITIAL_BUCKETS;
+    while ((uint64_t)needed * 2 > capacity) {
+        capacity *= 2;
+    }
+    StoreDictLogSlot* slots = (StoreDictLogSlot*)calloc(capacity, sizeof(StoreDictLogSlot));
+    if (!slots) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        StoreDictLogSlot* slot = &index->slots[i];
+        if (slot->key) {
+            uint32_t j = (uint32_t)slot->hash & (capacity - 1);
+            while (slots[j].key) {
+                j = (j + 1) & (capacity - 1);
+            }
+            slots[j] = *slot;
+        }
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    return true;
+}
+
+// Points `key` at `record` (0 to mark it removed) and returns the offset
+// the key held before, 0 if it had none. Returns UINT64_MAX when out of memory.
+static uint64_t log_index_put(StoreDictLogIndex* index, const IpcName* key, uint64_t record) {
+    if (!log_index_reserve(index, index->used + 1)) {
+        return UINT64_MAX;
+    }
+
+    bool found;
+    StoreDictLogSlot* slot = log_index_find(index, key, &found);
+    if (found) {
+        uint64_t previous = slot->record;
+        slot->record = record;
+        return previous;
+    }
+    if (record == 0) {
+        return 0;
+    }
+
+    slot->key = (char*)malloc(key->len);
+    if (!slot->key) {
+        return UINT64_MAX;
+    }
+    memcpy(slot->key, key->text, key->len);
+    slot->key_len = key->len;
+    slot->hash = key->hash;
+    slot->record = record;
+    index->used++;
+    return 0;
+}
+
+// Applies the records appended since this handle last looked. After a
+// compaction every offset has moved, so the index starts over. Called with
+// the mutex held.
+static bool log_replay(StoreDictPattern* dict) {
+    StoreDictLogIndex* index = &dict->log_index;
+    StoreDictLogHeader* header = log_header(dict);
+
+    if (index->epoch != header->epoch) {
+        log_index_reset(index);
+        index->epoch = header->epoch;
+        index->replayed = header->log_start;
+    }
+
+    uint64_t applied = 0;
+    while (index->replayed < header->log_end) {
+        StoreDictLogRecord* record = log_record(dict, index->replayed);
+        IpcName key;
+        ipc_name_make(&key, (const char*)(record + 1));
+
+        uint64_t target = (record->flags & STORE_DICT_LOG_TOMBSTONE) ? 0 : index->replayed;
+        if (log_index_put(index, &key, target) == UINT64_MAX) {
+            return false;
+        }
+        index->replayed += log_record_size(record->key_len, record->value_size);
+        applied++;
+    }
+
+    if (applied > 0 && dict->verbose) {
+        printf("StoreDictPattern: Replayed %llu log records up to offset %llu\n",
+            (unsigned long long)applied, (unsigned long long)index->replayed);
+    }
+    return true;
+}
+
+static bool ensure_log(StoreDictPattern* dict) {
+    if (log_ready(dict)) {
+        return true;
+    }
+    if (!dict->shm.data || dict_header(dict)->magic == STORE_DICT_MAGIC ||
+        !ensure_segment_size(dict, sizeof(StoreDictLogHeader))) {
+        return false;
+    }
+
+    StoreDictLogHeader* header = log_header(dict);
+    size_t log_start = align_up(sizeof(StoreDictLogHeader));
+    header->epoch++;  // Zero on a fresh segment; clear keeps the old value
+    header->live_count = 0;
+    header->log_start = log_start;
+    header->log_end = log_start;
+    header->dead_bytes = 0;
+    header->magic = STORE_DICT_LOG_MAGIC;
+    dict->shm.touch(&dict->shm, 0, log_start);
+
+    if (dict->verbose) {
+        printf("StoreDictPattern: Formatted empty log\n");
+    }
+    return true;
+}
+
+static bool ensure_layout(StoreDictPattern* dict) {
+    return dict->mode == STORE_DICT_MODE_LOG ? ensure_log(dict) : ensure_table(dict);
+}
+
+static bool log_wants_compaction(StoreDictLogHeader* header) {
+    uint64_t log_bytes = header->log_end - header->log_start;
+    return log_bytes >= STORE_DICT_LOG_COMPACT_MIN && header->dead_bytes * 2 >= log_bytes;
+}
+
+// Rewrites the live records to the front of the log and moves the epoch,
+// so every reader rebuilds its index on its next replay. Called with the
+// mutex and begin_update held, after log_replay.
+static bool log_compact(StoreDictPattern* dict) {
+    StoreDictLogIndex* index = &dict->log_index;
+    StoreDictLogHeader* header = log_header(dict);
+
+    size_t live_bytes = 0;
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        if (index->slots[i].record) {
+            StoreDictLogRecord* record = log_record(dict, index->slots[i].record);
+            live_bytes += log_record_size(record->key_len, record->value_size);
+        }
+    }
+
+    unsigned char* scratch = (unsigned char*)malloc(live_bytes + 1);
+    if (!scratch) {
+        if (dict->verbose) {
+            printf("StoreDictPattern: Failed to allocate %zu bytes for compaction\n", live_bytes);
+        }
+        return false;
+    }
+
+    // Removed keys are dropped from the index on the way
+    size_t pos = 0;
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        StoreDictLogSlot* slot = &index->slots[i];
+        if (slot->record) {
+            StoreDictLogRecord* record = log_record(dict, slot->record);
+            size_t size = log_record_size(record->key_len, record->value_size);
+            memcpy(scratch + pos, record, size);
+            pos += size;
+        }
+    }
+
+    uint64_t reclaimed = header->log_end - header->log_start - live_bytes;
+    memcpy(dict->shm.data + header->log_start, scratch, live_bytes);
+    free(scratch);
+
+    header->log_end = header->log_start + live_bytes;
+    header->dead_bytes = 0;
+    header->epoch++;
+    dict->shm.touch(&dict->shm, 0, (size_t)header->log_end);
+
+    // This handle's index is rebuilt from the compacted log right away
+    index->epoch = 0;
+    bool ok = log_replay(dict);
+
+    if (dict->verbose) {
+        printf("StoreDictPattern: Compacted log to %zu bytes, reclaimed %llu\n",
+            live_bytes, (unsigned long long)reclaimed);
+    }
+    return ok;
+}
+
+// Appends one record, compacting when the log is mostly dead and growing
+// the segment otherwise. Called with the mutex and begin_update held.
+static bool log_append(StoreDictPattern* dict, const IpcName* key,
+    const unsigned char* value, size_t value_size, uint32_t flags) {
+    if (!ensure_log(dict) || !log_replay(dict)) {
+        return false;
+    }
+
+    size_t size = log_record_size(key->len, value_size);
+    StoreDictLogHeader* header = log_header(dict);
+    if (header->log_end + size > dict->shm.size) {
+        if (header->dead_bytes * 2 >= header->log_end - header->log_start && !log_compact(dict)) {
+            return false;
+        }
+        header = log_header(dict);
+        if (!ensure_segment_size(dict, (size_t)header->log_end + size)) {
+            return false;
+        }
+        header = log_header(dict);
+    }
+
+    uint64_t offset = header->log_end;
+    StoreDictLogRecord* record = log_record(dict, offset);
+    record->key_len = key->len;
+    record->value_size = (uint32_t)value_size;
+    record->flags = flags;
+    record->reserved = 0;
+    record->version = (flags & STORE_DICT_LOG_TOMBSTONE) ? 0 : ++header->entry_stamp;
+    memcpy(record + 1, key->text, key->len);
+    if (value_size > 0) {
+        memcpy(log_record_value(record), value, value_size);
+    }
+    dict->shm.touch(&dict->shm, (size_t)offset, size);
+
+    uint64_t previous = log_index_put(&dict->log_index, key,
+        (flags & STORE_DICT_LOG_TOMBSTONE) ? 0 : offset);
+    if (previous == UINT64_MAX) {
+        return false;
+    }
+
+    // The record is only visible once log_end moves past it
+    if (previous) {
+        StoreDictLogRecord* old = log_record(dict, previous);
+        header->dead_bytes += log_record_size(old->key_len, old->value_size);
+    }
+    if (flags & STORE_DICT_LOG_TOMBSTONE) {
+        header->dead_bytes += size;
+        header->live_count--;
+    }
+    else if (!previous) {
+        header->live_count++;
+    }
+    ipc_atomic_fence();
+    header->log_end = offset + size;
+    dict->log_index.replayed = header->log_end;
+    dict->shm.touch(&dict->shm, 0, sizeof(StoreDictLogHeader));
+    return true;
+}
+
+// Looks `key` up in this handle's index. The caller holds the mutex and
+// has replayed the log.
+static unsigned char* log_get(StoreDictPattern* dict, const IpcName* key, size_t* out_size, uint64_t* out_version) {
+    bool found = false;
+    StoreDictLogSlot* slot = NULL;
+
+    if (dict->log_index.capacity > 0) {
+        slot = log_index_find(&dict->log_index, key, &found);
+    }
+    if (!found || !slot->record) {
+        return NULL;
+    }
+
+    StoreDictLogRecord* record = log_record(dict, slot->record);
+    unsigned char* result = (unsigned char*)malloc(record->value_size ? record->value_size : 1);
+    if (result) {
+        memcpy(result, log_record_value(record), record->value_size);
+        if (out_size) {
+            *out_size = record->value_size;
+        }
+        if (out_version) {
+            *out_version = record->version;
+        }
+    }
+    return result;
+}
+
+// Appends a tombstone, but only for keys that are currently present
+static bool log_remove(StoreDictPattern* dict, const IpcName* key) {
+    if (!lock_dict(dict)) {
+        return false;
+    }
+
+    bool found = false;
+
+    dict->shm.begin_update(&dict->shm);
+    if (log_ready(dict) && log_replay(dict) && dict->log_index.capacity > 0) {
+        StoreDictLogSlot* slot = log_index_find(&dict->log_index, key, &found);
+        found = found && slot->record != 0;
+    }
+    if (found) {
+        found = log_append(dict, key, NULL, 0, STORE_DICT_LOG_TOMBSTONE);
+    }
+    if (found) {
+        publish_version(dict);
+    }
+    dict->shm.end_update(&dict->shm);
+    ReleaseMutex(dict->mutex);
+    return found;
+}
+
+// Frees a partly filled key list; list_keys returns NULL rather than a
+// list with holes when a copy fails
+static char** free_key_list(char** keys, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    return NULL;
+}
+
+static char** log_list_keys(StoreDictPattern* dict, size_t* out_count) {
+    if (!lock_dict(dict)) {
+        return NULL;
+    }
+
+    dict->shm.refresh(&dict->shm);
+
+    char** keys = NULL;
+    size_t count = 0;
+    StoreDictLogIndex* index = &dict->log_index;
+
+    if (log_ready(dict) && log_replay(dict) && log_header(dict)->live_count > 0) {
+        // live_count is the shared tally; the private index is what gets
+        // walked, so the array bounds the walk rather than trusting the two
+        // to agree
+        size_t allocated = log_header(dict)->live_count;
+        keys = (char**)malloc(allocated * sizeof(char*));
+        for (uint32_t i = 0; keys && i < index->capacity && count < allocated; i++) {
+            if (index->slots[i].record) {
+                char* key = _strdup(index->slots[i].key);
+                if (!key) {
+                    keys = free_key_list(keys, count);
+                    count = 0;
+                    break;
+                }
+                keys[count++] = key;
+            }
+        }
+    }
+
+    ReleaseMutex(dict->mutex);
+
+    *out_count = count;
+    return keys;
+}
+
+// Compacts on behalf of every handle once most of the log is dead. The
+// mapping may move under other threads of this process, so even the check
+// runs under the mutex.
+static unsigned __stdcall compactor_thread_func(void* arg) {
+    StoreDictPattern* self = (StoreDictPattern*)arg;
+
+    while (self->compactor_running) {
+        Sleep(STORE_DICT_LOG_COMPACT_POLL_MS);
+
+        if (!self->compactor_running || !lock_dict(self)) {
+            continue;
+        }
+        self->shm.refresh(&self->shm);
+        if (log_ready(self) && log_wants_compaction(log_header(self))) {
+            self->shm.begin_update(&self->shm);
+            if (log_replay(self)) {
+                log_compact(self);
+            }
+            self->shm.end_update(&self->shm);
+        }
+        ReleaseMutex(self->mutex);
+    }
+
+    return 0;
+}
+
+// Constructor implementation
+void StoreDictPattern_init(StoreDictPattern* store, const char* id, size_t size, bool verbose) {
+    if (verbose) {
+        printf("StoreDictPattern_init: Initializing with id '%s' and size %zu\n", id, size);
+    }
+
+
+    SharedMemory_init(&store->shm, id, size, verbose);
+
+
+    store->verbose = verbose;
+    store->version = 0;  // Initialize version to 0
+    store->mode = STORE_DICT_MODE_TABLE;
+    memset(&store->log_index, 0, sizeof(store->log_index));
+    ipc_names_init(&store->names);
+    store->ordered = false;
+    store->capacity = 0;
+    store->gate_slot = UINT32_MAX;
+    store->compactor_running = false;
+    store->compactor_thread = NULL;
+
+    // Create named mutex for synchronization
+    char mutex_name[256];
+    sprintf_s(mutex_name, sizeof(mutex_name), "StoreDictPattern_Mutex_%s", id);
+    store->mutex = CreateMutexA(NULL, FALSE, mutex_name);
+
+    if (store->mutex == NULL && verbose) {
+        printf("Failed to create mutex: %lu\n", GetLastError());
+    }
+
+
+    store->set_mode = StoreDictPattern_set_mode;
+    store->set_ordered = StoreDictPattern_set_ordered;
+    store->set_capacity = StoreDictPattern_set_capacity;
+    store->setup = StoreDictPattern_setup;
+    store->store = StoreDictPattern_store;
+    store->store_string = StoreDictPattern_store_string;
+    store->store_bytes = StoreDictPattern_store_bytes;
+    store->store_many = StoreDictPattern_store_many;
+    store->store_with_ttl = StoreDictPattern_store_with_ttl;
+    store->store_resolved = StoreDictPattern_store_resolved;
+    store->retrieve = StoreDictPattern_retrieve;
+    store->retrieve_bytes = StoreDictPattern_retrieve_bytes;
+    store->retrieve_string = StoreDictPattern_retrieve_string;
+    store->retrieve_many = StoreDictPattern_retrieve_many;
+    store->retrieve_resolved = StoreDictPattern_retrieve_resolved;
+    store->resolve = StoreDictPattern_resolve;
+    store->retrieve_with_version = StoreDictPattern_retrieve_with_version;
+    store->store_if_version = StoreDictPattern_store_if_version;
+    store->create_counter = StoreDictPattern_create_counter;
+    store->atomic_add = StoreDictPattern_atomic_add;
+    store->atomic_get = StoreDictPattern_atomic_get;
+    store->compare_exchange = StoreDictPattern_compare_exchange;
+    store->remove = StoreDictPattern_remove;
+    store->scan_prefix = StoreDictPattern_scan_prefix;
+    store->scan_range = StoreDictPattern_scan_range;
+    store->snapshot = StoreDictPattern_snapshot;
+    store->restore = StoreDictPattern_restore;
+    store->count = StoreDictPattern_count;
+    store->load = StoreDictPattern_load;
+    store->refresh_if_changed = StoreDictPattern_refresh_if_changed;
+    store->sync = StoreDictPattern_sync;
+    store->list_keys = StoreDictPattern_list_keys;
+    store->clear = StoreDictPattern_clear;
+    store->sweep = StoreDictPattern_sweep;
+    store->cache_stats = StoreDictPattern_cache_stats;
+    store->arena_stats = StoreDictPattern_arena_stats;
+    store->compact = StoreDictPattern_compact;
+    store->close = StoreDictPattern_close;
+
+    if (verbose) {
+        printf("StoreDictPattern_init: Initialization completed\n");
+    }
+}
+
+bool StoreDictPattern_set_mode(StoreDictPattern* self, StoreDictMode mode) {
+    if (self->shm.data) {
+        if (self->verbose) {
+            printf("StoreDictPattern_set_mode: Mode must be chosen before setup\n");
+        }
+        return false;
+    }
+    if (mode != STORE_DICT_MODE_TABLE && mode != STORE_DICT_MODE_LOG) {
+        return false;
+    }
+
+    self->mode = mode;
+    return true;
+}
+
+bool StoreDictPattern_set_ordered(StoreDictPattern* self, bool ordered) {
+    if (self->shm.data) {
+        if (self->verbose) {
+            printf("StoreDictPattern_set_ordered: The index must be chosen before setup\n");
+        }
+        return false;
+    }
+
+    self->ordered = ordered;
+    return true;
+}
+
+bool StoreDictPattern_set_capacity(StoreDictPattern* self, uint64_t capacity) {
+    if (self->shm.data || self->mode != STORE_DICT_MODE_TABLE) {
+        if (self->verbose) {
+            printf("StoreDictPattern_set_capacity: A capacity needs table mode and must be set before setup\n");
+        }
+        return false;
+    }
+
+    self->capacity = capacity;
+    return true;
+}
+
+// Follows the index the table already keeps, or builds one over it when
+// this handle asked for it and the table was formatted without. A capacity
+// this handle asked for replaces the table's; otherwise it adopts it.
+static void adopt_table_options(StoreDictPattern* dict) {
+    if (!lock_dict(dict)) {
+        return;
+    }
+
+    dict->shm.refresh(&dict->shm);
+    if (table_ready(dict) && dict_header(dict)->index) {
+        dict->ordered = true;
+    }
+    else if (table_ready(dict) && dict->ordered) {
+        dict->shm.begin_update(&dict->shm);
+        if (index_build(dict)) {
+            publish_version(dict);
+        }
+        else if (dict->verbose) {
+            printf("StoreDictPattern: Failed to build the ordered index\n");
+        }
+        dict->shm.end_update(&dict->shm);
+    }
+
+    if (table_ready(dict) && dict->capacity && dict_header(dict)->capacity != dict->capacity) {
+        dict->shm.begin_update(&dict->shm);
+        dict_header(dict)->capacity = dict->capacity;
+        dict->shm.touch(&dict->shm, 0, sizeof(StoreDictHeader));
+        table_make_room(dict, 0);
+        dict->shm.end_update(&dict->shm);
+    }
+    else if (table_ready(dict)) {
+        dict->capacity = dict_header(dict)->capacity;
+    }
+
+    ReleaseMutex(dict->mutex);
+}
+
+bool StoreDictPattern_setup(StoreDictPattern* self) {
+    if (self->verbose) {
+        printf("StoreDictPattern_setup: Starting setup\n");
+    }
+
+
+    bool result = self->shm.setup(&self->shm);
+    if (!result) {
+        if (self->verbose) {
+            printf("StoreDictPattern_setup: Failed to set up shared memory\n");
+        }
+        return false;
+    }
+
+    if (self->verbose) {
+        printf("StoreDictPattern_setup: Shared memory set up successfully\n");
+        printf("StoreDictPattern_setup: Loading existing data\n");
+    }
+
+    // Attach to the table, formatting it if this is a new segment
+    self->load(self);
+    if (self->mode == STORE_DICT_MODE_TABLE) {
+        adopt_table_options(self);
+    }
+
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        self->compactor_running = true;
+        self->compactor_thread = (HANDLE)_beginthreadex(NULL, 0, compactor_thread_func, self, 0, NULL);
+        if (!self->compactor_thread) {
+            // Compaction still happens inline whenever the segment fills up
+            self->compactor_running = false;
+            if (self->verbose) {
+                printf("StoreDictPattern_setup: Failed to start the log compactor\n");
+            }
+        }
+    }
+
+    if (self->verbose) {
+        printf("StoreDictPattern_setup: Setup completed successfully\n");
+    }
+    return true;
+}
+
+// One atomic load of the table version; no mutex. Returns true, and moves
+// this handle's cached version forward, when another handle has changed
+// the dictionary since this one last looked.
+bool StoreDictPattern_refresh_if_changed(StoreDictPattern* self) {
+    if (!self->shm.pin(&self->shm)) {
+        return false;
+    }
+    bool ready = layout_ready(self);
+    uint32_t version = ready ? ipc_atomic_load_u32(&dict_header(self)->version) : 0;
+    self->shm.unpin(&self->shm);
+
+    if (!ready || version == self->version) {
+        return false;
+    }
+
+    self->version = version;
+    return true;
+}
+
+// The table is read in place, so loading only maps in any growth and
+// formats a fresh segment; nothing is copied into process memory. When the
+// version has not moved there is nothing to do at all.
+void StoreDictPattern_load(StoreDictPattern* self) {
+    bool current = false;
+    if (self->shm.pin(&self->shm)) {
+        current = layout_ready(self) && ipc_atomic_load_u32(&dict_header(self)->version) == self->version;
+        self->shm.unpin(&self->shm);
+    }
+    if (current) {
+        return;
+    }
+
+    if (!lock_dict(self)) {
+        return;
+    }
+
+    self->shm.refresh(&self->shm);
+    if (!layout_ready(self)) {
+        adopt_layout(self);
+    }
+    if (!layout_ready(self)) {
+        self->shm.begin_update(&self->shm);
+        ensure_layout(self);
+        self->shm.end_update(&self->shm);
+    }
+
+    if (layout_ready(self)) {
+        self->version = dict_header(self)->version;
+        if (self->verbose && self->mode == STORE_DICT_MODE_LOG) {
+            printf("StoreDictPattern_load: Log has %u entries in %llu bytes (version %u)\n",
+                log_header(self)->live_count,
+                (unsigned long long)(log_header(self)->log_end - log_header(self)->log_start), self->version);
+        }
+        else if (self->verbose) {
+            printf("StoreDictPattern_load: Table has %u entries in %u buckets (version %u)\n",
+                dict_header(self)->entry_count, dict_header(self)->bucket_count, self->version);
+        }
+    }
+
+    ReleaseMutex(self->mutex);
+}
+
+void StoreDictPattern_store_bytes(StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size) {
+
+    StoreDictPattern_store(self, key, value, value_size);
+}
+
+void StoreDictPattern_store_string(StoreDictPattern* self, const char* key, const char* value) {
+    if (self->verbose) {
+        printf("StoreDictPattern_store_string: Storing key '%s'\n", key);
+    }
+
+    // Calculate the value size (including null terminator)
+    size_t value_size = strlen(value) + 1;
+
+    // Store the key-value pair, terminator included
+    self->store(self, key, (const unsigned char*)value, value_size);
+
+    if (self->verbose) {
+        printf("Stored key '%s' with %zu bytes\n", key, value_size - 1); // -1 for null terminator
+    }
+}
+
+// Whether `key` exists and a write of `value_size` bytes would reuse its
+// block. Counters always get a fresh record, since lock-free updates rely
+// on their shape never changing.
+static bool table_fits_in_place(StoreDictPattern* dict, const IpcName* key, size_t value_size, uint32_t flags) {
+    uint32_t index;
+    if (flags != 0 || !find_bucket(dict, key, &index)) {
+        return false;
+    }
+    StoreDictRecord* record = dict_record(dict, dict_buckets(dict)[index].record);
+    return record->flags == 0 && value_size <= record->value_capacity;
+}
+
+// Inserts or replaces `key` in the table without publishing a version.
+// `expires_at` is an ipc_wall_ms deadline, 0 for none. The caller holds the
+// mutex and begin_update.
+static bool table_put(StoreDictPattern* dict, const IpcName* key, const unsigned char* value, size_t value_size,
+    uint32_t flags, uint64_t expires_at) {
+    if (!ensure_table(dict)) {
+        return false;
+    }
+
+    table_sweep(dict, STORE_DICT_SWEEP_STEP);
+
+    // Eviction moves buckets, so a bounded table makes room before the
+    // lookup below. Updates that keep their block need none.
+    if (dict_header(dict)->capacity && !table_fits_in_place(dict, key, value_size, flags)) {
+        size_t needed = record_size(key->len, value_size);
+        if (dict_header(dict)->index) {
+            needed += sizeof(StoreDictIndexNode) + STORE_DICT_INDEX_MAX_HEIGHT * sizeof(uint64_t) + key->len;
+        }
+        if (!table_make_room(dict, needed)) {
+            if (dict->verbose) {
+                printf("StoreDictPattern: %zu bytes do not fit in the table's capacity\n", needed);
+            }
+            return false;
+        }
+    }
+
+    uint32_t index;
+    bool found = find_bucket(dict, key, &index);
+
+    if (found) {
+        StoreDictRecord* record = dict_record(dict, dict_buckets(dict)[index].record);
+
+        // Fits the block it already has: overwrite the value where it is
+        if (flags == 0 && record->flags == 0 && value_size <= record->value_capacity) {
+            StoreDictHeader* header = dict_header(dict);
+            header->ttl_count += (expires_at != 0) - (record->expires_at != 0);
+            seq_begin(&record->seq);
+            memcpy(record_value(record), value, value_size);
+            record->value_size = (uint32_t)value_size;
+            record->version = ++header->entry_stamp;
+            record->expires_at = expires_at;
+            record->referenced = 1;
+            seq_end(&record->seq);
+            dict->shm.touch(&dict->shm, (size_t)((unsigned char*)record - dict->shm.data),
+                (size_t)(record_value(record) - (unsigned char*)record) + value_size);
+            return true;
+        }
+    }
+    else {
+        // Keep probe chains short; tombstones count because they lengthen chains too
+        StoreDictHeader* header = dict_header(dict);
+        if ((uint64_t)(header->entry_count + header->tombstone_count + 1) * 100 >
+            (uint64_t)header->bucket_count * MAX_LOAD_PERCENT) {
+            uint32_t bucket_count = header->bucket_count;
+            if ((uint64_t)(header->entry_count + 1) * 100 * 2 > (uint64_t)bucket_count * MAX_LOAD_PERCENT) {
+                bucket_count *= 2;
+            }
+            if (!rebuild_table(dict, bucket_count)) {
+                return false;
+            }
+            find_bucket(dict, key, &index);
+        }
+    }
+
+    // A new key needs its index node before anything is published
+    bool indexed = dict_header(dict)->index != 0;
+    uint64_t node = 0;
+    if (indexed && !found) {
+        node = index_alloc_node(dict, key->text, key->len, index_random_height(dict_header(dict)));
+        if (!node) {
+            return false;
+        }
+    }
+
+    size_t size = record_size(key->len, value_size);
+    uint64_t offset = dict_alloc(dict, size);
+    if (!offset) {
+        if (node) {
+            dict_free(dict, node);
+        }
+        return false;
+    }
+
+    StoreDictHeader* header = dict_header(dict);
+    ShmArenaView arena = dict_arena(dict);
+    size_t capacity = ipc_arena_usable_size(&arena, offset) - (size - value_size);
+
+    // A fresh seq per record, so a reader can never mistake a reused block
+    // for the one it started copying
+    StoreDictRecord* record = dict_record(dict, offset);
+    header->record_seq += 2;
+    record->key_len = key->len;
+    record->value_size = (uint32_t)value_size;
+    record->value_capacity = (uint32_t)(capacity < UINT32_MAX ? capacity : UINT32_MAX);
+    record->seq = header->record_seq;
+    record->flags = flags;
+    record->referenced = 1;
+    record->version = ++header->entry_stamp;
+    record->expires_at = expires_at;
+    memcpy(record_key(record), key->text, key->len);
+    memcpy(record_value(record), value, value_size);
+    dict->shm.touch(&dict->shm, (size_t)offset, size);
+
+    // The record is complete before the bucket points at it
+    StoreDictBucket* bucket = &dict_buckets(dict)[index];
+    uint64_t replaced = found ? bucket->record : 0;
+    if (expires_at) {
+        header->ttl_count++;
+    }
+    if (replaced && dict_record(dict, replaced)->expires_at) {
+        header->ttl_count--;
+    }
+    if (!found) {
+        if (bucket->record == STORE_DICT_TOMBSTONE) {
+            header->tombstone_count--;
+        }
+        header->entry_count++;
+        bucket->hash = key->hash;
+    }
+    ipc_atomic_fence();
+    bucket->record = offset;
+    dict->shm.touch(&dict->shm, (size_t)((unsigned char*)bucket - dict->shm.data), sizeof(StoreDictBucket));
+
+    if (node) {
+        index_link(dict, node, offset);
+    }
+    else if (indexed) {
+        index_set_record(dict, key, offset);
+    }
+
+    // Readers still copying the old record notice the bucket has moved on.
+    // Counter blocks are retired for updates that found them before the swap.
+    if (replaced && (dict_record(dict, replaced)->flags & STORE_DICT_RECORD_COUNTER)) {
+        counters_retire(dict, replaced);
+    }
+    else if (replaced) {
+        dict_free(dict, replaced);
+    }
+    return true;
+}
+
+// Copies the value of `key` out of the table. The caller holds the mutex.
+static unsigned char* table_get(StoreDictPattern* dict, const IpcName* key, size_t* out_size, uint64_t* out_version) {
+    uint32_t index;
+
+    if (!table_ready(dict) || !find_bucket(dict, key, &index)) {
+        return NULL;
+    }
+
+    StoreDictRecord* record = dict_record(dict, dict_buckets(dict)[index].record);
+    if (record_expired(record, ipc_wall_ms())) {
+        return NULL;
+    }
+    unsigned char* result = (unsigned char*)malloc(record->value_size ? record->value_size : 1);
+    if (result) {
+        memcpy(result, record_value(record), record->value_size);
+        if (out_size) {
+            *out_size = record->value_size;
+        }
+        if (out_version) {
+            *out_version = record->version;
+        }
+    }
+    return result;
+}
+
+typedef enum TableRead {
+    TABLE_READ_MISSING,
+    TABLE_READ_FOUND,
+    TABLE_READ_RETRY,
+    TABLE_READ_EXPIRED  // Found past its deadline; the locked path removes it
+} TableRead;
+
+// One lookup without the mutex. A concurrent writer can leave any field
+// half-updated, so every offset and length is bounds-checked before use and
+// anything inconsistent asks for a retry rather than a guess.
+// `out_referenced` receives the entry's CLOCK bit.
+static TableRead table_read(StoreDictPattern* dict, const IpcName* key, unsigned long long now,
+    unsigned char** out_value, size_t* out_size, uint64_t* out_version, bool* out_referenced) {
+    StoreDictHeader* header = dict_header(dict);
+    uint32_t layout = ipc_atomic_load_u32(&header->layout);
+    if (layout & 1) {
+        return TABLE_READ_RETRY;
+    }
+
+    uint32_t bucket_count = header->bucket_count;
+    uint64_t buckets_offset = header->buckets;
+    if (bucket_count == 0 || (bucket_count & (bucket_count - 1)) != 0 ||
+        buckets_offset + (uint64_t)bucket_count * sizeof(StoreDictBucket) > dict->shm.size) {
+        return TABLE_READ_RETRY;
+    }
+
+    StoreDictBucket* buckets = (StoreDictBucket*)(dict->shm.data + buckets_offset);
+    size_t value_offset = align_up(sizeof(StoreDictRecord) + key->len);
+    TableRead result = TABLE_READ_MISSING;
+    unsigned char* value = NULL;
+    size_t value_size = 0;
+    uint64_t version = 0;
+    uint64_t expires_at = 0;
+    bool referenced = false;
+
+    for (uint32_t probe = 0; probe < bucket_count; probe++) {
+        StoreDictBucket* bucket = &buckets[(uint32_t)(key->hash + probe) & (bucket_count - 1)];
+        uint64_t offset = bucket->record;
+        if (offset == STORE_DICT_EMPTY) {
+            break;
+        }
+        if (offset == STORE_DICT_TOMBSTONE || bucket->hash != key->hash) {
+            continue;
+        }
+
+        // Anything past the end was written after this handle last remapped
+        ipc_atomic_fence();
+        if (offset + value_offset > dict->shm.size) {
+            result = TABLE_READ_RETRY;
+            break;
+        }
+
+        StoreDictRecord* record = dict_record(dict, offset);
+        uint32_t seq = ipc_atomic_load_u32(&record->seq);
+        if (seq & 1) {
+            result = TABLE_READ_RETRY;
+            break;
+        }
+        if (record->key_len != key->len || !ipc_name_equal(record_key(record), key->text, key->len)) {
+            continue;
+        }
+
+        value_size = record->value_size;
+        if (value_size > record->value_capacity || offset + value_offset + value_size > dict->shm.size) {
+            result = TABLE_READ_RETRY;
+            break;
+        }
+        value = (unsigned char*)malloc(value_size ? value_size : 1);
+        if (!value) {
+            break;
+        }
+        memcpy(value, (unsigned char*)record + value_offset, value_size);
+        version = record->version;
+        expires_at = record->expires_at;
+        referenced = record->referenced != 0;
+
+        // The bucket still points here and nobody rewrote the value meanwhile
+        ipc_atomic_fence();
+        result = ipc_atomic_load_u32(&record->seq) == seq && bucket->record == offset
+            ? TABLE_READ_FOUND : TABLE_READ_RETRY;
+        break;
+    }
+
+    // Nothing may have been moved underneath the probe either
+    ipc_atomic_fence();
+    if (result != TABLE_READ_RETRY && ipc_atomic_load_u32(&header->layout) != layout) {
+        result = TABLE_READ_RETRY;
+    }
+    if (result == TABLE_READ_FOUND && expires_at != 0 && expires_at <= now) {
+        result = TABLE_READ_EXPIRED;
+    }
+
+    if (result == TABLE_READ_FOUND) {
+        *out_value = value;
+        *out_size = value_size;
+        *out_version = version;
+        *out_referenced = referenced;
+    }
+    else {
+        free(value);
+    }
+    return result;
+}
+
+// Readers never take the mutex unless writers keep invalidating their
+// copies, in which case they queue behind them once instead of spinning.
+// Each attempt pins the view, since the handle may be shared with threads
+// that grow it; the pin is dropped before the mutex is taken.
+static unsigned char* table_get_optimistic(StoreDictPattern* dict, const IpcName* key, size_t* out_size,
+    uint64_t* out_version) {
+    for (int attempt = 0; attempt < STORE_DICT_READ_RETRIES; attempt++) {
+        if (!dict->shm.pin(&dict->shm)) {
+            return NULL;
+        }
+        if (!table_ready(dict)) {
+            dict->shm.unpin(&dict->shm);
+            return NULL;
+        }
+
+        unsigned char* value = NULL;
+        size_t value_size = 0;
+        uint64_t version = 0;
+        bool referenced = false;
+        TableRead result = table_read(dict, key, ipc_wall_ms(), &value, &value_size, &version, &referenced);
+        bool bounded = dict_header(dict)->capacity != 0;
+        dict->shm.unpin(&dict->shm);
+        if (result == TABLE_READ_FOUND) {
+            // A bounded table's hand needs to see the read; only the first
+            // one since it last passed pays for the mutex
+            if (!referenced && bounded && lock_dict(dict)) {
+                dict->shm.refresh(&dict->shm);
+                table_access(dict, key);
+                ReleaseMutex(dict->mutex);
+            }
+            if (out_size) {
+                *out_size = value_size;
+            }
+            if (out_version) {
+                *out_version = version;
+            }
+            return value;
+        }
+        if (result == TABLE_READ_MISSING) {
+            return NULL;
+        }
+        if (result == TABLE_READ_EXPIRED) {
+            if (lock_dict(dict)) {
+                dict->shm.refresh(&dict->shm);
+                table_access(dict, key);
+                ReleaseMutex(dict->mutex);
+            }
+            return NULL;
+        }
+
+        if (attempt < 8) {
+            ipc_cpu_relax();
+        }
+        else {
+            ipc_yield();
+        }
+    }
+
+    if (!lock_dict(dict)) {
+        return NULL;
+    }
+    dict->shm.refresh(&dict->shm);
+    table_access(dict, key);
+    unsigned char* result = table_get(dict, key, out_size, out_version);
+    ReleaseMutex(dict->mutex);
+    return result;
+}
+
+static bool put_locked(StoreDictPattern* dict, const IpcName* key, const unsigned char* value, size_t value_size,
+    uint64_t expires_at) {
+    if (value_size > UINT32_MAX) {
+        return false;
+    }
+    if (dict->mode == STORE_DICT_MODE_LOG) {
+        // Log handles index privately, so there is no shared entry to expire
+        if (expires_at) {
+            if (dict->verbose) {
+                printf("StoreDictPattern: TTLs need table mode\n");
+            }
+            return false;
+        }
+        return log_append(dict, key, value, value_size, 0);
+    }
+    return table_put(dict, key, value, value_size, 0, expires_at);
+}
+
+// Brings this handle up to date before a run of gets. Called with the mutex held.
+static bool prepare_read(StoreDictPattern* dict) {
+    dict->shm.refresh(&dict->shm);
+    if (dict->mode == STORE_DICT_MODE_LOG) {
+        return log_ready(dict) && log_replay(dict);
+    }
+    return table_ready(dict);
+}
+
+static unsigned char* get_locked(StoreDictPattern* dict, const IpcName* key, size_t* out_size, uint64_t* out_version) {
+    return dict->mode == STORE_DICT_MODE_LOG
+        ? log_get(dict, key, out_size, out_version) : table_get(dict, key, out_size, out_version);
+}
+
+bool StoreDictPattern_store(StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size) {
+    IpcName name;
+    ipc_name_make(&name, key);
+    return StoreDictPattern_store_resolved(self, &name, value, value_size);
+}
+
+// Interns `key` in this handle so later calls can skip hashing it. The
+// result stays valid until close. Not safe to call while other threads use
+// the same handle, so resolve keys up front.
+const IpcName* StoreDictPattern_resolve(StoreDictPattern* self, const char* key) {
+    const IpcName* name = ipc_names_intern(&self->names, key);
+    if (!name && self->verbose) {
+        printf("StoreDictPattern_resolve: Failed to intern key '%s'\n", key);
+    }
+    return name;
+}
+
+bool StoreDictPattern_store_resolved(StoreDictPattern* self, const IpcName* key, const unsigned char* value, size_t value_size) {
+    if (!lock_dict(self)) {
+        return false;
+    }
+
+    self->shm.begin_update(&self->shm);
+    bool success = put_locked(self, key, value, value_size, 0);
+    if (success) {
+        publish_version(self);
+    }
+    else if (self->verbose) {
+        printf("StoreDictPattern_store: Failed to store key '%s' (%zu bytes)\n", key->text, value_size);
+    }
+
+    self->shm.end_update(&self->shm);
+    ReleaseMutex(self->mutex);
+    return success;
+}
+
+// One mutex round trip and one version bump for the whole batch. Stops at
+// the first key that cannot be stored and returns how many were.
+size_t StoreDictPattern_store_many(StoreDictPattern* self, const char* const* keys,
+    const unsigned char* const* values, const size_t* sizes, size_t count) {
+    if (count == 0 || !lock_dict(self)) {
+        return 0;
+    }
+
+    self->shm.begin_update(&self->shm);
+    size_t stored = 0;
+    while (stored < count) {
+        IpcName name;
+        ipc_name_make(&name, keys[stored]);
+        if (!put_locked(self, &name, values[stored], sizes[stored], 0)) {
+            break;
+        }
+        stored++;
+    }
+    if (stored > 0) {
+        publish_version(self);
+    }
+    self->shm.end_update(&self->shm);
+
+    ReleaseMutex(self->mutex);
+
+    if (self->verbose) {
+        printf("StoreDictPattern_store_many: Stored %zu of %zu keys\n", stored, count);
+    }
+    return stored;
+}
+
+bool StoreDictPattern_store_with_ttl(StoreDictPattern* self, const char* key, const unsigned char* value,
+    size_t value_size, uint64_t ttl_ms) {
+    if (!lock_dict(self)) {
+        return false;
+    }
+
+    IpcName name;
+    ipc_name_make(&name, key);
+    uint64_t expires_at = ttl_ms ? ipc_wall_ms() + ttl_ms : 0;
+
+    self->shm.refresh(&self->shm);
+    self->shm.begin_update(&self->shm);
+    bool success = put_locked(self, &name, value, value_size, expires_at);
+    if (success) {
+        publish_version(self);
+    }
+    else if (self->verbose) {
+        printf("StoreDictPattern_store_with_ttl: Failed to store key '%s' (%zu bytes)\n", key, value_size);
+    }
+
+    self->shm.end_update(&self->shm);
+    ReleaseMutex(self->mutex);
+    return success;
+}
+
+unsigned char* StoreDictPattern_retrieve(StoreDictPattern* self, const char* key, size_t* out_size) {
+    IpcName name;
+    ipc_name_make(&name, key);
+    return StoreDictPattern_retrieve_resolved(self, &name, out_size);
+}
+
+unsigned char* StoreDictPattern_retrieve_resolved(StoreDictPattern* self, const IpcName* key, size_t* out_size) {
+    if (self->mode == STORE_DICT_MODE_TABLE) {
+        return table_get_optimistic(self, key, out_size, NULL);
+    }
+
+    // The log index is private to this handle and replay mutates it
+    if (!lock_dict(self)) {
+        return NULL;
+    }
+
+    unsigned char* result = prepare_read(self) ? get_locked(self, key, out_size, NULL) : NULL;
+
+    // Release mutex
+    ReleaseMutex(self->mutex);
+    return result;
+}
+
+// Fills out_values[i] with a malloc'd copy of each value, or NULL for
+// missing keys. Tables are read without the mutex; logs replay once under
+// a single acquisition. Returns how many were found.
+size_t StoreDictPattern_retrieve_many(StoreDictPattern* self, const char* const* keys, size_t count,
+    unsigned char** out_values, size_t* out_sizes) {
+    for (size_t i = 0; i < count; i++) {
+        out_values[i] = NULL;
+        out_sizes[i] = 0;
+    }
+
+    size_t found = 0;
+    if (self->mode == STORE_DICT_MODE_TABLE) {
+        for (size_t i = 0; i < count; i++) {
+            IpcName name;
+            ipc_name_make(&name, keys[i]);
+            out_values[i] = table_get_optimistic(self, &name, &out_sizes[i], NULL);
+            found += out_values[i] != NULL;
+        }
+        return found;
+    }
+
+    if (count == 0 || !lock_dict(self)) {
+        return 0;
+    }
+
+    if (prepare_read(self)) {
+        for (size_t i = 0; i < count; i++) {
+            IpcName name;
+            ipc_name_make(&name, keys[i]);
+            out_values[i] = get_locked(self, &name, &out_sizes[i], NULL);
+            found += out_values[i] != NULL;
+        }
+    }
+
+    ReleaseMutex(self->mutex);
+    return found;
+}
+
+// Version of `key` as the mutex holder sees it, 0 when it is absent
+static uint64_t entry_version_locked(StoreDictPattern* dict, const IpcName* key) {
+    if (dict->mode == STORE_DICT_MODE_LOG) {
+        bool found = false;
+        StoreDictLogSlot* slot = NULL;
+        if (log_ready(dict) && log_replay(dict) && dict->log_index.capacity > 0) {
+            slot = log_index_find(&dict->log_index, key, &found);
+        }
+        return found && slot->record ? log_record(dict, slot->record)->version : 0;
+    }
+
+    uint32_t index;
+    if (!table_ready(dict) || !find_bucket(dict, key, &index)) {
+        return 0;
+    }
+    StoreDictRecord* record = dict_record(dict, dict_buckets(dict)[index].record);
+    return record_expired(record, ipc_wall_ms()) ? 0 : record->version;
+}
+
+unsigned char* StoreDictPattern_retrieve_with_version(StoreDictPattern* self, const char* key, size_t* out_size,
+    uint64_t* out_version) {
+    IpcName name;
+    ipc_name_make(&name, key);
+    if (out_version) {
+        *out_version = 0;
+    }
+
+    if (self->mode == STORE_DICT_MODE_TABLE) {
+        return table_get_optimistic(self, &name, out_size, out_version);
+    }
+    if (!lock_dict(self)) {
+        return NULL;
+    }
+
+    unsigned char* result = prepare_read(self) ? get_locked(self, &name, out_size, out_version) : NULL;
+
+    ReleaseMutex(self->mutex);
+    return result;
+}
+
+// The mutex is only held for the compare and the write, never across the
+// caller's computation of `value`
+bool StoreDictPattern_store_if_version(StoreDictPattern* self, const char* key, const unsigned char* value,
+    size_t value_size, uint64_t expected_version, uint64_t* out_version) {
+    if (!lock_dict(self)) {
+        return false;
+    }
+
+    IpcName name;
+    ipc_name_make(&name, key);
+
+    self->shm.refresh(&self->shm);
+    self->shm.begin_update(&self->shm);
+
+    uint64_t current = entry_version_locked(self, &name);
+    bool matched = current == expected_version;
+    bool success = matched && put_locked(self, &name, value, value_size, 0);
+    if (success) {
+        publish_version(self);
+        current = entry_version_locked(self, &name);
+    }
+
+    self->shm.end_update(&self->shm);
+    ReleaseMutex(self->mutex);
+
+    if (out_version) {
+        *out_version = current;
+    }
+    if (!matched && self->verbose) {
+        printf("StoreDictPattern_store_if_version: Key '%s' is at version %llu, not %llu\n",
+            key, (unsigned long long)current, (unsigned long long)expected_version);
+    }
+    else if (!success && self->verbose) {
+        printf("StoreDictPattern_store_if_version: Failed to store key '%s' (%zu bytes)\n", key, value_size);
+    }
+    return success;
+}
+
+unsigned char* StoreDictPattern_retrieve_bytes(StoreDictPattern* self, const char* key, size_t* out_size) {
+
+    return StoreDictPattern_retrieve(self, key, out_size);
+}
+
+char* StoreDictPattern_retrieve_string(StoreDictPattern* self, const char* key) {
+    if (self->verbose) {
+        printf("StoreDictPattern_retrieve_string: Retrieving value for key '%s'\n", key);
+    }
+
+    size_t size = 0;
+    unsigned char* value = StoreDictPattern_retrieve(self, key, &size);
+    if (!value) {
+        if (self->verbose) {
+            printf("StoreDictPattern_retrieve_string: Key '%s' not found\n", key);
+        }
+        return NULL;
+    }
+
+    // Values stored as strings carry their terminator; bytes may not
+    char* result = (char*)realloc(value, size + 1);
+    if (!result) {
+        free(value);
+        return NULL;
+    }
+    result[size] = '\0';
+
+    if (self->verbose) {
+        printf("StoreDictPattern_retrieve_string: Retrieved value '%s' for key '%s'\n",
+               result, key);
+    }
+
+    return result;
+}
+
+// ---- Counters ----
+
+typedef enum CounterOp {
+    COUNTER_OP_ADD,
+    COUNTER_OP_GET,
+    COUNTER_OP_CMPXCHG
+} CounterOp;
+
+// Shards sit on their own cache lines from the first STRIDE boundary in the
+// value, which is why a sharded value carries one stride of slack
+static size_t counter_value_size(uint32_t shards) {
+    return shards > 1 ? (size_t)(shards + 1) * STORE_DICT_COUNTER_STRIDE : sizeof(int64_t);
+}
+
+static uint32_t counter_shards(StoreDictRecord* record) {
+    if (!(record->flags & STORE_DICT_RECORD_SHARDED)) {
+        return 1;
+    }
+    return record->value_size / STORE_DICT_COUNTER_STRIDE - 1;
+}
+
+static volatile int64_t* counter_slot(StoreDictRecord* record, uint32_t shard) {
+    if (!(record->flags & STORE_DICT_RECORD_SHARDED)) {
+        return (volatile int64_t*)record_value(record);
+    }
+    uintptr_t base = ((uintptr_t)record_value(record) + STORE_DICT_COUNTER_STRIDE - 1) &
+        ~(uintptr_t)(STORE_DICT_COUNTER_STRIDE - 1);
+    return (volatile int64_t*)(base + (size_t)shard * STORE_DICT_COUNTER_STRIDE);
+}
+
+// Applies `op` to a counter record with CPU atomics. Sharded counters add
+// to the slot of the current processor and report a snapshot of the total.
+static bool counter_apply(StoreDictRecord* record, CounterOp op, int64_t a, int64_t b, int64_t* out_value) {
+    uint32_t shards = counter_shards(record);
+    int64_t value;
+
+    if (op == COUNTER_OP_CMPXCHG) {
+        if (shards > 1) {
+            return false;
+        }
+        value = ipc_atomic_cmpxchg_i64(counter_slot(record, 0), a, b);
+    }
+    else if (shards == 1) {
+        value = op == COUNTER_OP_ADD
+            ? ipc_atomic_fetch_add_i64(counter_slot(record, 0), a) + a
+            : ipc_atomic_load_i64(counter_slot(record, 0));
+    }
+    else {
+        if (op == COUNTER_OP_ADD) {
+            ipc_atomic_fetch_add_i64(counter_slot(record, (uint32_t)ipc_numa_current_cpu() % shards), a);
+        }
+        value = 0;
+        for (uint32_t i = 0; i < shards; i++) {
+            value += ipc_atomic_load_i64(counter_slot(record, i));
+        }
+    }
+
+    if (out_value) {
+        *out_value = value;
+    }
+    return true;
+}
+
+// The gate slot this process counts its updates in, claiming a free one or
+// one whose process has died if need be. NULL when every slot belongs to a
+// live process; the caller then takes the locked path.
+static StoreDictGateSlot* gate_slot(StoreDictPattern* dict, uint32_t pid) {
+    StoreDictGateSlot* slots = dict_header(dict)->counter_slots;
+    if (dict->gate_slot < STORE_DICT_COUNTER_GATE_SLOTS &&
+        ipc_atomic_load_u32(&slots[dict->gate_slot].pid) == pid) {
+        return &slots[dict->gate_slot];
+    }
+
+    // Another handle in this process may hold one already
+    for (uint32_t i = 0; i < STORE_DICT_COUNTER_GATE_SLOTS; i++) {
+        if (ipc_atomic_load_u32(&slots[i].pid) == pid) {
+            dict->gate_slot = i;
+            return &slots[i];
+        }
+    }
+
+    for (uint32_t i = 0; i < STORE_DICT_COUNTER_GATE_SLOTS; i++) {
+        uint32_t owner = ipc_atomic_load_u32(&slots[i].pid);
+        if ((owner == 0 && ipc_atomic_cas_u32(&slots[i].pid, 0, STORE_DICT_COUNTER_SLOT_RESETTING)) ||
+            gate_slot_take_if_dead(&slots[i], owner)) {
+            ipc_atomic_store_u32(&slots[i].ns, ipc_pid_namespace());
+            ipc_atomic_store_u32(&slots[i].token, ipc_process_token(pid));
+            ipc_atomic_store_u32(&slots[i].pid, pid);
+            dict->gate_slot = i;
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+// Counts this process into the gate unless a grow or clear has closed it.
+// Counting in and then checking the gate pairs with the drain closing the
+// gate and then reading the counts: one of the two sees the other.
+static StoreDictGateSlot* counters_enter(StoreDictPattern* dict) {
+    uint32_t pid = (uint32_t)GetCurrentProcessId();
+    StoreDictGateSlot* slot = gate_slot(dict, pid);
+    if (!slot) {
+        return NULL;
+    }
+
+    ipc_atomic_fetch_add_u32(&slot->inside, 1);
+    ipc_atomic_fence();
+    // A clear or restore may have handed the slot back in the meantime
+    if ((ipc_atomic_load_u32(&dict_header(dict)->counter_gate) & STORE_DICT_COUNTER_GATE_CLOSED) ||
+        ipc_atomic_load_u32(&slot->pid) != pid) {
+        ipc_atomic_fetch_add_u32(&slot->inside, (uint32_t)-1);
+        return NULL;
+    }
+    return slot;
+}
+
+static void counters_leave(StoreDictGateSlot* slot) {
+    ipc_atomic_fetch_add_u32(&slot->inside, (uint32_t)-1);
+}
+
+// One lock-free attempt, made from inside the gate. The bucket must still
+// point at the record after its fields are checked: only then is the record
+// known to be complete, and a counter block replaced after that is only
+// retired, not freed, until this update has left the gate.
+static TableRead counter_try(StoreDictPattern* dict, const IpcName* key, CounterOp op,
+    int64_t a, int64_t b, int64_t* out_value, bool* out_applied) {
+    StoreDictHeader* header = dict_header(dict);
+    uint32_t layout = ipc_atomic_load_u32(&header->layout);
+    if (layout & 1) {
+        return TABLE_READ_RETRY;
+    }
+
+    uint32_t bucket_count = header->bucket_count;
+    uint64_t buckets_offset = header->buckets;
+    if (bucket_count == 0 || (bucket_count & (bucket_count - 1)) != 0 ||
+        buckets_offset + (uint64_t)bucket_count * sizeof(StoreDictBucket) > dict->shm.size) {
+        return TABLE_READ_RETRY;
+    }
+
+    StoreDictBucket* buckets = (StoreDictBucket*)(dict->shm.data + buckets_offset);
+    size_t value_offset = align_up(sizeof(StoreDictRecord) + key->len);
+
+    for (uint32_t probe = 0; probe < bucket_count; probe++) {
+        StoreDictBucket* bucket = &buckets[(uint32_t)(key->hash + probe) & (bucket_count - 1)];
+        uint64_t offset = bucket->record;
+        if (offset == STORE_DICT_EMPTY) {
+            break;
+        }
+        if (offset == STORE_DICT_TOMBSTONE || bucket->hash != key->hash) {
+            continue;
+        }
+
+        ipc_atomic_fence();
+        if (offset + value_offset > dict->shm.size) {
+            return TABLE_READ_RETRY;
+        }
+        StoreDictRecord* record = dict_record(dict, offset);
+        if (record->key_len != key->len || !ipc_name_equal(record_key(record), key->text, key->len)) {
+            continue;
+        }
+
+        uint32_t flags = record->flags;
+        uint32_t value_size = record->value_size;
+        if (offset + value_offset + value_size > dict->shm.size) {
+            return TABLE_READ_RETRY;
+        }
+        ipc_atomic_fence();
+        if (bucket->record != offset || ipc_atomic_load_u32(&header->layout) != layout) {
+            return TABLE_READ_RETRY;
+        }
 
-    
-    if (!resize_entries(store, 10)) {
-        if (verbose) {
-            printf("StoreDictPattern_init: Failed to allocate initial entries\n");
+        // Ordinary values are left to the locked path to report
+        if (!(flags & STORE_DICT_RECORD_COUNTER)) {
+            return TABLE_READ_RETRY;
         }
-    }
-    else if (verbose) {
-        printf("StoreDictPattern_init: Allocated initial entries\n");
+        *out_applied = counter_apply(record, op, a, b, out_value);
+        if (*out_applied && op != COUNTER_OP_GET) {
+            // Persistent segments flush the slot like any other write
+            dict->shm.touch(&dict->shm, (size_t)(offset + value_offset), value_size);
+        }
+        return TABLE_READ_FOUND;
     }
 
-    if (verbose) {
-        printf("StoreDictPattern_init: Initialization completed\n");
+    ipc_atomic_fence();
+    return ipc_atomic_load_u32(&header->layout) == layout ? TABLE_READ_MISSING : TABLE_READ_RETRY;
+}
+
+// Runs `op` without the mutex. Returns TABLE_READ_RETRY when the caller
+// should take the locked path instead: the key is missing, holds an
+// ordinary value, or writers kept getting in the way.
+static TableRead counter_optimistic(StoreDictPattern* dict, const IpcName* key, CounterOp op,
+    int64_t a, int64_t b, int64_t* out_value, bool* out_applied) {
+    for (int attempt = 0; attempt < STORE_DICT_READ_RETRIES; attempt++) {
+        // The locked path reports a mapping this handle cannot follow
+        if (!dict->shm.pin(&dict->shm)) {
+            return TABLE_READ_RETRY;
+        }
+        if (!table_ready(dict)) {
+            dict->shm.unpin(&dict->shm);
+            return TABLE_READ_RETRY;
+        }
+
+        // The pin keeps the gate's mapping in place until it is left
+        TableRead result = TABLE_READ_RETRY;
+        StoreDictGateSlot* slot = counters_enter(dict);
+        if (slot) {
+            result = counter_try(dict, key, op, a, b, out_value, out_applied);
+            counters_leave(slot);
+        }
+        dict->shm.unpin(&dict->shm);
+        if (result == TABLE_READ_FOUND) {
+            return result;
+        }
+        if (result == TABLE_READ_MISSING) {
+            return TABLE_READ_RETRY;
+        }
+
+        if (attempt < 8) {
+            ipc_cpu_relax();
+        }
+        else {
+            ipc_yield();
+        }
     }
+    return TABLE_READ_RETRY;
 }
 
-bool StoreDictPattern_setup(StoreDictPattern* self) {
-    if (self->verbose) {
-        printf("StoreDictPattern_setup: Starting setup\n");
+// Writes a zeroed counter record for `key`, then adds `initial` to its
+// first slot, so updates that find it in between are not lost. The caller
+// holds the mutex and begin_update.
+static StoreDictRecord* table_put_counter(StoreDictPattern* dict, const IpcName* key, int64_t initial, uint32_t shards) {
+    size_t value_size = counter_value_size(shards);
+    unsigned char* zeros = (unsigned char*)calloc(1, value_size);
+    if (!zeros) {
+        return NULL;
     }
 
-    
-    bool result = self->shm.setup(&self->shm);
-    if (!result) {
-        if (self->verbose) {
-            printf("StoreDictPattern_setup: Failed to set up shared memory\n");
+    uint32_t flags = STORE_DICT_RECORD_COUNTER | (shards > 1 ? STORE_DICT_RECORD_SHARDED : 0);
+    bool stored = table_put(dict, key, zeros, value_size, flags, 0);
+    free(zeros);
+
+    uint32_t index;
+    if (!stored || !find_bucket(dict, key, &index)) {
+        return NULL;
+    }
+
+    StoreDictRecord* record = dict_record(dict, dict_buckets(dict)[index].record);
+    ipc_atomic_fetch_add_i64(counter_slot(record, 0), initial);
+    return record;
+}
+
+// Log records are immutable, so a counter is an 8-byte value rewritten by
+// appending. Called with the mutex and begin_update held, after replay.
+static bool log_counter(StoreDictPattern* dict, const IpcName* key, CounterOp op,
+    int64_t a, int64_t b, int64_t* out_value, bool* out_applied) {
+    int64_t current = 0;
+    size_t size = 0;
+    unsigned char* value = log_get(dict, key, &size, NULL);
+    if (value) {
+        if (size != sizeof(int64_t)) {
+            free(value);
+            return false;
         }
+        memcpy(&current, value, sizeof(int64_t));
+        free(value);
+    }
+    else if (op != COUNTER_OP_ADD) {
         return false;
     }
 
-    if (self->verbose) {
-        printf("StoreDictPattern_setup: Shared memory set up successfully\n");
-        printf("StoreDictPattern_setup: Loading existing data\n");
+    int64_t next = current;
+    if (op == COUNTER_OP_ADD) {
+        next = current + a;
+    }
+    else if (op == COUNTER_OP_CMPXCHG && current == a) {
+        next = b;
     }
 
-    // Load existing data if any
-    self->load(self);
+    if (next != current || !value) {
+        if (!log_append(dict, key, (const unsigned char*)&next, sizeof(next), 0)) {
+            return false;
+        }
+        publish_version(dict);
+    }
 
-    if (self->verbose) {
-        printf("StoreDictPattern_setup: Setup completed successfully\n");
+    *out_applied = true;
+    if (out_value) {
+        *out_value = op == COUNTER_OP_ADD ? next : current;
     }
     return true;
 }
 
-void StoreDictPattern_load(StoreDictPattern* self) {
-    if (self->verbose) {
-        printf("StoreDictPattern_load: Loading entries from shared memory\n");
+// Slow path, under the mutex. Concurrent lock-free updates still run, so
+// the record is only ever touched with atomics here too.
+static bool counter_locked(StoreDictPattern* dict, const IpcName* key, CounterOp op,
+    int64_t a, int64_t b, int64_t* out_value, bool* out_applied) {
+    if (!lock_dict(dict)) {
+        return false;
     }
 
-    
-    size_t data_size;
-    unsigned char* data = self->shm.read_bytes(&self->shm, &data_size);
+    dict->shm.refresh(&dict->shm);
+    dict->shm.begin_update(&dict->shm);
 
-    if (!data || data_size == 0) {
-        if (self->verbose) {
-            printf("StoreDictPattern_load: No data in shared memory\n");
+    bool found = false;
+    if (dict->mode == STORE_DICT_MODE_LOG) {
+        found = (ensure_log(dict) && log_replay(dict)) &&
+            log_counter(dict, key, op, a, b, out_value, out_applied);
+    }
+    else {
+        uint32_t index;
+        StoreDictRecord* record = NULL;
+        if (table_ready(dict) && find_bucket(dict, key, &index)) {
+            record = dict_record(dict, dict_buckets(dict)[index].record);
+            if (!(record->flags & STORE_DICT_RECORD_COUNTER)) {
+                record = NULL;
+            }
+        }
+        else if (op == COUNTER_OP_ADD) {
+            record = table_put_counter(dict, key, 0, 1);
+            if (record) {
+                publish_version(dict);
+            }
+        }
+
+        found = record != NULL;
+        if (found) {
+            *out_applied = counter_apply(record, op, a, b, out_value);
+            dict->shm.touch(&dict->shm, (size_t)((unsigned char*)record - dict->shm.data),
+                (size_t)(record_value(record) - (unsigned char*)record) + record->value_size);
         }
-        return;
     }
 
-    // Parse data
-    size_t pos = 0;
+    dict->shm.end_update(&dict->shm);
+    ReleaseMutex(dict->mutex);
+    return found;
+}
 
-    
-    uint32_t entry_count = *(uint32_t*)(data + pos);
-    pos += sizeof(uint32_t);
+static bool counter_run(StoreDictPattern* dict, const char* key, CounterOp op,
+    int64_t a, int64_t b, int64_t* out_value) {
+    IpcName name;
+    ipc_name_make(&name, key);
+    bool applied = false;
 
-    if (self->verbose) {
-        printf("StoreDictPattern_load: Found %u entries\n", entry_count);
+    if (dict->mode == STORE_DICT_MODE_TABLE &&
+        counter_optimistic(dict, &name, op, a, b, out_value, &applied) == TABLE_READ_FOUND) {
+        return applied;
+    }
+    if (counter_locked(dict, &name, op, a, b, out_value, &applied)) {
+        return applied;
     }
 
-    
-    for (size_t i = 0; i < self->entry_count; i++) {
-        free(self->entries[i].key);
-        free(self->entries[i].value);
+    if (dict->verbose) {
+        printf("StoreDictPattern: Key '%s' is not a counter\n", key);
     }
-    self->entry_count = 0;
+    return false;
+}
 
-    
-    if (entry_count > self->entry_capacity) {
-        if (!resize_entries(self, entry_count)) {
-            printf("StoreDictPattern_load: Failed to resize entries array\n");
-            free(data);
-            return;
+bool StoreDictPattern_create_counter(StoreDictPattern* self, const char* key, int64_t initial, uint32_t shards) {
+    if (shards == 0) {
+        shards = 1;
+    }
+    if (shards > STORE_DICT_COUNTER_MAX_SHARDS || (shards > 1 && self->mode == STORE_DICT_MODE_LOG)) {
+        if (self->verbose) {
+            printf("StoreDictPattern_create_counter: %u shards are not supported here\n", shards);
         }
+        return false;
+    }
+    if (!lock_dict(self)) {
+        return false;
     }
 
-    // Read entries
-    for (size_t i = 0; i < entry_count; i++) {
-        
-        uint32_t key_len = *(uint32_t*)(data + pos);
-        pos += sizeof(uint32_t);
-
-        
-        char* key = _strdup((char*)(data + pos));
-        pos += key_len;
-
-        
-        uint32_t value_size = *(uint32_t*)(data + pos);
-        pos += sizeof(uint32_t);
-
-        // Read value
-        unsigned char* value = (unsigned char*)malloc(value_size);
-        memcpy(value, data + pos, value_size);
-        pos += value_size;
+    IpcName name;
+    ipc_name_make(&name, key);
 
-        // Add entry
-        self->entries[self->entry_count].key = key;
-        self->entries[self->entry_count].value = value;
-        self->entries[self->entry_count].value_size = value_size;
-        self->entry_count++;
+    self->shm.refresh(&self->shm);
+    self->shm.begin_update(&self->shm);
 
-        if (self->verbose) {
-            printf("StoreDictPattern_load: Loaded entry %zu: key='%s', value_size=%u\n",
-                i, key, value_size);
+    bool success;
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        success = put_locked(self, &name, (const unsigned char*)&initial, sizeof(initial), 0);
+        if (success) {
+            publish_version(self);
+        }
+    }
+    else {
+        // A counter of the same shape keeps its value
+        uint32_t index;
+        uint32_t flags = STORE_DICT_RECORD_COUNTER | (shards > 1 ? STORE_DICT_RECORD_SHARDED : 0);
+        success = false;
+        if (table_ready(self) && find_bucket(self, &name, &index)) {
+            StoreDictRecord* record = dict_record(self, dict_buckets(self)[index].record);
+            success = record->flags == flags && record->value_size == counter_value_size(shards);
+        }
+        if (!success) {
+            success = table_put_counter(self, &name, initial, shards) != NULL;
+            if (success) {
+                publish_version(self);
+            }
         }
     }
 
-    
-    free(data);
+    self->shm.end_update(&self->shm);
+    ReleaseMutex(self->mutex);
 
-    if (self->verbose) {
-        printf("StoreDictPattern_load: Loaded %zu entries from shared memory\n", self->entry_count);
+    if (!success && self->verbose) {
+        printf("StoreDictPattern_create_counter: Failed to create counter '%s'\n", key);
     }
+    return success;
 }
 
-void StoreDictPattern_store_bytes(StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size) {
-    
-    StoreDictPattern_store(self, key, value, value_size);
+bool StoreDictPattern_atomic_add(StoreDictPattern* self, const char* key, int64_t delta, int64_t* out_value) {
+    return counter_run(self, key, COUNTER_OP_ADD, delta, 0, out_value);
 }
 
-void StoreDictPattern_store_string(StoreDictPattern* self, const char* key, const char* value) {
-    if (self->verbose) {
-        printf("StoreDictPattern_store_string: Storing key '%s'\n", key);
-    }
+bool StoreDictPattern_atomic_get(StoreDictPattern* self, const char* key, int64_t* out_value) {
+    return counter_run(self, key, COUNTER_OP_GET, 0, 0, out_value);
+}
 
-    // Calculate the value size (including null terminator)
-    size_t value_size = strlen(value) + 1;
+// Stores `desired` if the counter holds `expected`. Returns false only when
+// the key is not a plain counter; whether the exchange happened is told by
+// `out_actual` (the value found) matching `expected`.
+bool StoreDictPattern_compare_exchange(StoreDictPattern* self, const char* key, int64_t expected, int64_t desired,
+    int64_t* out_actual) {
+    return counter_run(self, key, COUNTER_OP_CMPXCHG, expected, desired, out_actual);
+}
+
+bool StoreDictPattern_remove(StoreDictPattern* self, const char* key) {
+    IpcName name;
+    ipc_name_make(&name, key);
 
-    
-    unsigned char* value_copy = (unsigned char*)malloc(value_size);
-    if (!value_copy) {
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        bool removed = log_remove(self, &name);
         if (self->verbose) {
-            printf("StoreDictPattern_store_string: Failed to allocate memory for value\n");
+            printf(removed ? "Deleted key '%s'\n" : "Key '%s' not found\n", key);
         }
-        return;
+        return removed;
+    }
+    if (!lock_dict(self)) {
+        return false;
     }
 
-    // Copy the value (including null terminator)
-    memcpy(value_copy, value, value_size);
+    self->shm.begin_update(&self->shm);
+
+    uint32_t index;
+    bool found = table_ready(self) && find_bucket(self, &name, &index);
 
-    // Store the key-value pair
-    self->store(self, key, value_copy, value_size);
+    if (found) {
+        table_drop_entry(self, index);
+        publish_version(self);
+    }
 
-    // Free the value copy (store makes its own copy)
-    free(value_copy);
+    self->shm.end_update(&self->shm);
+    ReleaseMutex(self->mutex);
 
     if (self->verbose) {
-        printf("Stored key '%s' with %zu bytes\n", key, value_size - 1); // -1 for null terminator
+        printf(found ? "Deleted key '%s'\n" : "Key '%s' not found\n", key);
     }
+    return found;
 }
 
-unsigned char* StoreDictPattern_retrieve(StoreDictPattern* self, const char* key, size_t* out_size) {
-    // Wait for mutex
-    DWORD wait_result = WaitForSingleObject(self->mutex, 5000);
-    if (wait_result != WAIT_OBJECT_0) {
-        if (self->verbose) printf("Failed to acquire mutex: %lu\n", GetLastError());
+size_t StoreDictPattern_count(StoreDictPattern* self) {
+    if (!self->shm.pin(&self->shm)) {
+        return 0;
+    }
+    size_t count = 0;
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        count = log_ready(self) ? log_header(self)->live_count : 0;
+    }
+    else {
+        count = table_ready(self) ? dict_header(self)->entry_count : 0;
+    }
+    self->shm.unpin(&self->shm);
+    return count;
+}
+
+char** StoreDictPattern_list_keys(StoreDictPattern* self, size_t* out_count) {
+    size_t count = 0;
+    if (out_count) {
+        *out_count = 0;
+    }
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        char** keys = log_list_keys(self, &count);
+        if (out_count) {
+            *out_count = count;
+        }
+        return keys;
+    }
+    if (!lock_dict(self)) {
         return NULL;
     }
-    
-    
-    self->load(self);
-    
-    // Find the entry
-    unsigned char* result = NULL;
-    for (size_t i = 0; i < self->entry_count; i++) {
-        if (strcmp(self->entries[i].key, key) == 0) {
-            
-            result = malloc(self->entries[i].value_size);
-            memcpy(result, self->entries[i].value, self->entries[i].value_size);
-            
-            if (out_size) {
-                *out_size = self->entries[i].value_size;
+
+    self->shm.refresh(&self->shm);
+
+    char** keys = NULL;
+
+    if (table_ready(self) && dict_header(self)->entry_count > 0) {
+        StoreDictHeader* header = dict_header(self);
+        StoreDictBucket* buckets = dict_buckets(self);
+
+        unsigned long long now = ipc_wall_ms();
+        keys = (char**)malloc(header->entry_count * sizeof(char*));
+        for (uint32_t i = 0; keys && i < header->bucket_count; i++) {
+            if (buckets[i].record > STORE_DICT_TOMBSTONE &&
+                !record_expired(dict_record(self, buckets[i].record), now)) {
+                char* key = _strdup(record_key(dict_record(self, buckets[i].record)));
+                if (!key) {
+                    keys = free_key_list(keys, count);
+                    count = 0;
+                    break;
+                }
+                keys[count++] = key;
             }
-            break;
         }
     }
-    
-    // Release mutex
+
     ReleaseMutex(self->mutex);
-    return result;
-}
 
-unsigned char* StoreDictPattern_retrieve_bytes(StoreDictPattern* self, const char* key, size_t* out_size) {
-    
-    return StoreDictPattern_retrieve(self, key, out_size);
+    if (out_count) {
+        *out_count = count;
+    }
+    return keys;
 }
 
-char* StoreDictPattern_retrieve_string(StoreDictPattern* self, const char* key) {
-    if (self->verbose) {
-        printf("StoreDictPattern_retrieve_string: Retrieving value for key '%s'\n", key);
+// Walks the index from the first key at or after `from` (the start when
+// NULL), stopping at the first key outside `prefix` or at or after `end`
+static size_t index_scan(StoreDictPattern* dict, const char* from, const char* prefix, const char* end,
+    StoreDictScanFn fn, void* user_data) {
+    if (dict->mode != STORE_DICT_MODE_TABLE || !lock_dict(dict)) {
+        return 0;
     }
 
-    // Wait for mutex
-    DWORD wait_result = WaitForSingleObject(self->mutex, 5000);
-    if (wait_result != WAIT_OBJECT_0) {
-        if (self->verbose) {
-            printf("StoreDictPattern_retrieve_string: Failed to acquire mutex\n");
+    dict->shm.refresh(&dict->shm);
+    if (!table_ready(dict) || !dict_header(dict)->index) {
+        ReleaseMutex(dict->mutex);
+        if (dict->verbose) {
+            printf("StoreDictPattern: Segment keeps no ordered index\n");
         }
-        return NULL;
+        return 0;
     }
 
-    // Load latest data from shared memory
-    self->load(self);
+    size_t prefix_len = prefix ? strlen(prefix) : 0;
+    size_t end_len = end ? strlen(end) : 0;
+    uint64_t current = from
+        ? index_seek(dict, from, strlen(from), NULL)
+        : node_next(index_node(dict, dict_header(dict)->index))[0];
+    size_t visited = 0;
+    unsigned long long now = ipc_wall_ms();
+
+    while (current) {
+        StoreDictIndexNode* node = index_node(dict, current);
+        size_t key_len = node->key_len - 1;
+        if (prefix && (key_len < prefix_len || memcmp(node_key(node), prefix, prefix_len) != 0)) {
+            break;
+        }
+        if (end && index_compare(node_key(node), key_len, end, end_len) >= 0) {
+            break;
+        }
 
-    
-    int index = find_entry_index(self, key);
-    if (index < 0) {
-        if (self->verbose) {
-            printf("StoreDictPattern_retrieve_string: Key '%s' not found\n", key);
+        StoreDictRecord* record = dict_record(dict, node->record);
+        if (record_expired(record, now)) {
+            current = node_next(node)[0];
+            continue;
         }
-        ReleaseMutex(self->mutex);
-        return NULL;
+        visited++;
+        if (!fn(node_key(node), record_value(record), record->value_size, user_data)) {
+            break;
+        }
+        current = node_next(node)[0];
+    }
+
+    ReleaseMutex(dict->mutex);
+    return visited;
+}
+
+size_t StoreDictPattern_scan_prefix(StoreDictPattern* self, const char* prefix, StoreDictScanFn fn, void* user_data) {
+    return index_scan(self, prefix, prefix, NULL, fn, user_data);
+}
+
+size_t StoreDictPattern_scan_range(StoreDictPattern* self, const char* start, const char* end,
+    StoreDictScanFn fn, void* user_data) {
+    return index_scan(self, start, NULL, end, fn, user_data);
+}
+
+void StoreDictPattern_clear(StoreDictPattern* self) {
+    if (!lock_dict(self)) {
+        return;
     }
 
-    
-    char* result = _strdup((char*)self->entries[index].value);
+    // Zero what was used, then lay down an empty table
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        // The epoch carries over so other handles drop their indexes, and the
+        // stamp so versions read before the clear never match again
+        self->shm.refresh(&self->shm);
+        uint32_t epoch = log_ready(self) ? log_header(self)->epoch : 0;
+        uint64_t stamp = log_ready(self) ? log_header(self)->entry_stamp : 0;
+        self->shm.clear(&self->shm);
+        self->shm.begin_update(&self->shm);
+        log_header(self)->epoch = epoch;
+        log_header(self)->entry_stamp = stamp;
+        ensure_log(self);
+    }
+    else {
+        // Lock-free readers that overlap the clear see `layout` move and retry;
+        // ones that start while the header is zeroed find no table
+        self->shm.refresh(&self->shm);
+        uint32_t layout = table_ready(self) ? dict_header(self)->layout : 0;
+        uint64_t stamp = table_ready(self) ? dict_header(self)->entry_stamp : 0;
+        if (table_ready(self)) {
+            // Whoever clears keeps the index and capacity the table had
+            self->ordered = self->ordered || dict_header(self)->index != 0;
+            self->capacity = dict_header(self)->capacity;
+            if (!counters_drain(self)) {
+                counters_reopen(self);
+                ReleaseMutex(self->mutex);
+                if (self->verbose) {
+                    printf("Dictionary not cleared: counter updates are still in flight\n");
+                }
+                return;
+            }
+            seq_begin(&dict_header(self)->layout);
+        }
+        self->shm.clear(&self->shm);
+        self->shm.begin_update(&self->shm);
+        format_table(self, STORE_DICT_INITIAL_BUCKETS);
+        dict_header(self)->entry_stamp = stamp;
+        ipc_atomic_store_u32(&dict_header(self)->layout, layout + 2);
+    }
+    dict_header(self)->version = ++self->version;
+    self->shm.end_update(&self->shm);
 
-    
     ReleaseMutex(self->mutex);
 
     if (self->verbose) {
-        printf("StoreDictPattern_retrieve_string: Retrieved value '%s' for key '%s'\n", 
-               result, key);
+        printf("Dictionary cleared\n");
     }
+}
 
-    return result;
+// ---- Snapshots ----
+
+static bool snapshot_file_size(FILE* file, uint64_t* out_size) {
+#ifdef _WIN32
+    bool ok = _fseeki64(file, 0, SEEK_END) == 0;
+    long long size = ok ? _ftelli64(file) : -1;
+    ok = _fseeki64(file, 0, SEEK_SET) == 0 && ok && size >= 0;
+#else
+    bool ok = fseeko(file, 0, SEEK_END) == 0;
+    long long size = ok ? (long long)ftello(file) : -1;
+    ok = fseeko(file, 0, SEEK_SET) == 0 && ok && size >= 0;
+#endif
+    *out_size = (uint64_t)size;
+    return ok;
 }
 
-void StoreDictPattern_delete(StoreDictPattern* self, const char* key) {
-    int index = find_entry_index(self, key);
-    if (index < 0) {
+// Writes straight from the mapping under the mutex, so the image is one
+// consistent state. Lock-free counter updates may still land while it is
+// written; each slot is copied whole, not torn.
+bool StoreDictPattern_snapshot(StoreDictPattern* self, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
         if (self->verbose) {
-            printf("Key '%s' not found\n", key);
+            printf("StoreDictPattern_snapshot: Failed to open '%s'\n", path);
         }
-        return;
+        return false;
+    }
+    if (!lock_dict(self)) {
+        fclose(file);
+        return false;
     }
 
-    // Free memory
-    free(self->entries[index].key);
-    free(self->entries[index].value);
+    self->shm.refresh(&self->shm);
 
-    
-    if (index < self->entry_count - 1) {
-        self->entries[index] = self->entries[self->entry_count - 1];
+    StoreDictSnapshotHeader header = { 0 };
+    header.magic = STORE_DICT_SNAPSHOT_MAGIC;
+    if (self->mode == STORE_DICT_MODE_LOG && log_ready(self)) {
+        header.layout_magic = STORE_DICT_LOG_MAGIC;
+        header.image_size = log_header(self)->log_end;
+        header.segment_size = header.image_size;
     }
+    else if (self->mode == STORE_DICT_MODE_TABLE && table_ready(self)) {
+        header.layout_magic = STORE_DICT_MAGIC;
+        header.image_size = dict_header(self)->arena.top;
+        header.segment_size = dict_header(self)->arena.end;
+    }
+
+    bool success = header.layout_magic != 0 &&
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(self->shm.data, 1, (size_t)header.image_size, file) == header.image_size;
 
-    self->entry_count--;
-    self->sync(self);
+    ReleaseMutex(self->mutex);
+    success = fclose(file) == 0 && success;
 
     if (self->verbose) {
-        printf("Deleted key '%s'\n", key);
+        printf(success ? "StoreDictPattern_snapshot: Wrote %llu bytes to '%s'\n"
+            : "StoreDictPattern_snapshot: Failed after %llu bytes to '%s'\n",
+            (unsigned long long)header.image_size, path);
     }
+    return success;
 }
 
-char** StoreDictPattern_list_keys(StoreDictPattern* self, size_t* out_count) {
-    
-    
+static bool restore_header_valid(StoreDictPattern* dict, const StoreDictSnapshotHeader* header, uint64_t file_size) {
+    uint32_t layout_magic = dict->mode == STORE_DICT_MODE_LOG ? STORE_DICT_LOG_MAGIC : STORE_DICT_MAGIC;
+    size_t min_image = dict->mode == STORE_DICT_MODE_LOG ? sizeof(StoreDictLogHeader) : sizeof(StoreDictHeader);
 
-    if (self->entry_count == 0) {
-        if (out_count) {
-            *out_count = 0;
-        }
-        return NULL;
-    }
+    return header->magic == STORE_DICT_SNAPSHOT_MAGIC &&
+        header->layout_magic == layout_magic &&
+        header->image_size >= min_image &&
+        header->image_size <= header->segment_size &&
+        header->segment_size <= SIZE_MAX &&
+        file_size == sizeof(*header) + header->image_size;
+}
 
-    char** keys = (char**)malloc(self->entry_count * sizeof(char*));
-    for (size_t i = 0; i < self->entry_count; i++) {
-        keys[i] = _strdup(self->entries[i].key);
+// The segment header is read into process memory and published last, so
+// lock-free readers see no table until the image behind it is complete.
+// Everything else is read straight into the mapping in one pass.
+static bool restore_image(StoreDictPattern* dict, FILE* file, const StoreDictSnapshotHeader* snapshot) {
+    if (!ensure_segment_size(dict, (size_t)snapshot->segment_size)) {
+        return false;
     }
 
-    if (out_count) {
-        *out_count = self->entry_count;
+    size_t header_size = dict->mode == STORE_DICT_MODE_LOG ? sizeof(StoreDictLogHeader) : sizeof(StoreDictHeader);
+    size_t body_size = (size_t)snapshot->image_size - header_size;
+    union {
+        StoreDictHeader table;
+        StoreDictLogHeader log;
+    } image;
+
+    if (fread(&image, header_size, 1, file) != 1 ||
+        fread(dict->shm.data + header_size, 1, body_size, file) != body_size ||
+        image.table.magic != snapshot->layout_magic) {
+        return false;
     }
 
-    return keys;
+    // Counter updates in flight at snapshot time never leave this gate, and
+    // the processes its slots name belong to the segment the image came from
+    if (dict->mode == STORE_DICT_MODE_TABLE) {
+        image.table.counter_gate = 0;
+        memset(image.table.counter_slots, 0, sizeof(image.table.counter_slots));
+    }
+    ipc_atomic_fence();
+    memcpy(dict->shm.data, &image, header_size);
+    dict->shm.touch(&dict->shm, 0, (size_t)snapshot->image_size);
+    return true;
 }
 
-void StoreDictPattern_clear(StoreDictPattern* self) {
-    
-    for (size_t i = 0; i < self->entry_count; i++) {
-        free(self->entries[i].key);
-        free(self->entries[i].value);
+// Other handles notice through the moved version (and, for logs, the moved
+// epoch); readers that overlap the restore retry on `layout` or find no
+// table while the header is down.
+bool StoreDictPattern_restore(StoreDictPattern* self, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        if (self->verbose) {
+            printf("StoreDictPattern_restore: Failed to open '%s'\n", path);
+        }
+        return false;
     }
 
-    self->entry_count = 0;
-
-    // Clear shared memory
-    self->shm.clear(&self->shm);
+    StoreDictSnapshotHeader snapshot;
+    uint64_t file_size = 0;
+    if (!snapshot_file_size(file, &file_size) ||
+        fread(&snapshot, sizeof(snapshot), 1, file) != 1 ||
+        !restore_header_valid(self, &snapshot, file_size)) {
+        fclose(file);
+        if (self->verbose) {
+            printf("StoreDictPattern_restore: '%s' is not a %s snapshot\n",
+                path, self->mode == STORE_DICT_MODE_LOG ? "log" : "table");
+        }
+        return false;
+    }
+    if (!lock_dict(self)) {
+        fclose(file);
+        return false;
+    }
 
-    if (self->verbose) {
-        printf("Dictionary cleared\n");
+    self->shm.refresh(&self->shm);
+    uint32_t version = layout_ready(self) ? dict_header(self)->version : self->version;
+    bool success;
+
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        uint32_t epoch = log_ready(self) ? log_header(self)->epoch : 0;
+        self->shm.clear(&self->shm);
+        self->shm.begin_update(&self->shm);
+        success = restore_image(self, file, &snapshot);
+        if (success) {
+            // Every index, this handle's included, is rebuilt from the image
+            StoreDictLogHeader* header = log_header(self);
+            header->epoch = (header->epoch > epoch ? header->epoch : epoch) + 1;
+        }
+        else {
+            log_header(self)->magic = 0;
+            log_header(self)->epoch = epoch + 1;
+            ensure_log(self);
+        }
+    }
+    else {
+        uint32_t layout = table_ready(self) ? dict_header(self)->layout : 0;
+        if (table_ready(self)) {
+            if (!counters_drain(self)) {
+                counters_reopen(self);
+                ReleaseMutex(self->mutex);
+                fclose(file);
+                if (self->verbose) {
+                    printf("StoreDictPattern_restore: Counter updates are still in flight\n");
+                }
+                return false;
+            }
+            seq_begin(&dict_header(self)->layout);
+        }
+        self->shm.clear(&self->shm);
+        self->shm.begin_update(&self->shm);
+        success = restore_image(self, file, &snapshot);
+        if (success) {
+            ShmArenaView arena = dict_arena(self);
+            ipc_arena_extend(&arena, self->shm.size);
+            // An image taken without an index gets one if this handle wants it
+            if (self->ordered && !dict_header(self)->index && !index_build(self) && self->verbose) {
+                printf("StoreDictPattern_restore: Failed to build the ordered index\n");
+            }
+        }
+        else {
+            dict_header(self)->magic = 0;
+            format_table(self, STORE_DICT_INITIAL_BUCKETS);
+        }
+        ipc_atomic_store_u32(&dict_header(self)->layout, layout + 2);
     }
-}
 
-void StoreDictPattern_close(StoreDictPattern* self) {
-    self->shm.close(&self->shm);
+    dict_header(self)->version = version;
+    publish_version(self);
+    self->shm.end_update(&self->shm);
+
+    ReleaseMutex(self->mutex);
+    fclose(file);
 
     if (self->verbose) {
-        printf("Dictionary closed\n");
+        printf(success ? "StoreDictPattern_restore: Loaded %llu bytes from '%s'\n"
+            : "StoreDictPattern_restore: Failed to load %llu bytes from '%s'; the dictionary is empty\n",
+            (unsigned long long)snapshot.image_size, path);
     }
+    return success;
 }
 
-bool StoreDictPattern_sync(StoreDictPattern* self) {
-    if (self->verbose) {
-        printf("StoreDictPattern_sync: Syncing %zu entries to shared memory\n", self->entry_count);
-    }
-
-    
-    DWORD wait_result = WaitForSingleObject(self->mutex, 5000);
-    if (wait_result != WAIT_OBJECT_0) return false;
-    
-    // Increment version number
-    self->version++;
-    
-    // Calculate buffer size needed
-    size_t buffer_size = sizeof(uint32_t);  // For version
-    buffer_size += sizeof(uint32_t);        
-    for (size_t i = 0; i < self->entry_count; i++) {
-        buffer_size += sizeof(uint32_t); 
-        buffer_size += strlen(self->entries[i].key) + 1; 
-        buffer_size += sizeof(uint32_t); 
-        buffer_size += self->entries[i].value_size; 
-    }
-
-    if (buffer_size > self->shm.size) {
-        printf("StoreDictPattern_sync: Buffer size %zu exceeds shared memory size %zu\n",
-            buffer_size, self->shm.size);
-        ReleaseMutex(self->mutex);
-        return false;
+size_t StoreDictPattern_sweep(StoreDictPattern* self, uint32_t max_buckets) {
+    if (self->mode != STORE_DICT_MODE_TABLE || !lock_dict(self)) {
+        return 0;
     }
 
-    
-    unsigned char* buffer = (unsigned char*)malloc(buffer_size);
-    if (!buffer) {
-        printf("StoreDictPattern_sync: Failed to allocate buffer\n");
-        ReleaseMutex(self->mutex);
-        return false;
+    size_t expired = 0;
+    self->shm.refresh(&self->shm);
+    if (table_ready(self)) {
+        uint32_t bucket_count = dict_header(self)->bucket_count;
+        self->shm.begin_update(&self->shm);
+        expired = table_sweep(self, max_buckets && max_buckets < bucket_count ? max_buckets : bucket_count);
+        self->shm.end_update(&self->shm);
     }
 
-    // Fill buffer
-    size_t pos = 0;
-
-    // Write version number first
-    *(uint32_t*)(buffer + pos) = self->version;
-    pos += sizeof(uint32_t);
+    ReleaseMutex(self->mutex);
 
-    
-    *(uint32_t*)(buffer + pos) = (uint32_t)self->entry_count;
-    pos += sizeof(uint32_t);
+    if (self->verbose && expired > 0) {
+        printf("StoreDictPattern_sweep: Removed %zu expired entries\n", expired);
+    }
+    return expired;
+}
 
-    
-    for (size_t i = 0; i < self->entry_count; i++) {
-        // Write key length
-        uint32_t key_len = (uint32_t)strlen(self->entries[i].key) + 1; // Include null terminator
-        *(uint32_t*)(buffer + pos) = key_len;
-        pos += sizeof(uint32_t);
+// Expiry and eviction counters. Log mode keeps neither.
+bool StoreDictPattern_cache_stats(StoreDictPattern* self, StoreDictCacheStats* out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (self->mode != STORE_DICT_MODE_TABLE || !lock_dict(self)) {
+        return false;
+    }
 
-        
-        memcpy(buffer + pos, self->entries[i].key, key_len);
-        pos += key_len;
+    self->shm.refresh(&self->shm);
+    bool ready = table_ready(self);
+    if (ready) {
+        StoreDictHeader* header = dict_header(self);
+        out_stats->capacity = header->capacity;
+        out_stats->used = header->arena.allocated_bytes;
+        out_stats->entries = header->entry_count;
+        out_stats->expiring = header->ttl_count;
+        out_stats->expirations = header->expirations;
+        out_stats->evictions = header->evictions;
+    }
 
-        
-        *(uint32_t*)(buffer + pos) = (uint32_t)self->entries[i].value_size;
-        pos += sizeof(uint32_t);
+    ReleaseMutex(self->mutex);
+    return ready;
+}
 
-        
-        memcpy(buffer + pos, self->entries[i].value, self->entries[i].value_size);
-        pos += self->entries[i].value_size;
+// Space accounting for the table's arena. Log mode has no arena.
+bool StoreDictPattern_arena_stats(StoreDictPattern* self, ShmArenaStats* out_stats) {
+    memset(out_stats, 0, sizeof(*out_stats));
+    if (self->mode != STORE_DICT_MODE_TABLE || !lock_dict(self)) {
+        return false;
     }
 
-    if (self->verbose) {
-        printf("Buffer dump (first 100 bytes or less):\n");
-        for (size_t i = 0; i < pos && i < 100; i++) {
-            printf("%02X ", buffer[i]);
-            if ((i + 1) % 16 == 0) printf("\n");
-        }
-        printf("\n");
+    self->shm.refresh(&self->shm);
+    bool ready = table_ready(self);
+    if (ready) {
+        ShmArenaView arena = dict_arena(self);
+        ipc_arena_stats(&arena, out_stats);
     }
 
-    
-    bool success = self->shm.write_bytes(&self->shm, buffer, pos);
-
-    // Free buffer
-    free(buffer);
+    ReleaseMutex(self->mutex);
+    return ready;
+}
 
-    if (!success && self->verbose) {
-        printf("StoreDictPattern_sync: Failed to write to shared memory\n");
+// Drops garbage right away instead of waiting for the store that would
+// otherwise trigger it: superseded log records in log mode, tombstones in
+// table mode. Table records never move, so there is nothing else to do.
+bool StoreDictPattern_compact(StoreDictPattern* self) {
+    if (!lock_dict(self)) {
+        return false;
     }
 
-    if (self->verbose) {
-        printf("StoreDictPattern_sync: Synced %zu entries to shared memory (total %zu bytes)\n",
-            self->entry_count, pos);
+    self->shm.begin_update(&self->shm);
+    bool success;
+    if (self->mode == STORE_DICT_MODE_LOG) {
+        success = log_ready(self) && log_replay(self) && log_compact(self);
+    }
+    else {
+        success = table_ready(self) && rebuild_table(self, dict_header(self)->bucket_count);
     }
+    self->shm.end_update(&self->shm);
 
-    // Release mutex
     ReleaseMutex(self->mutex);
     return success;
 }
 
-void StoreDictPattern_store(StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size) {
-    // Check if the key already exists
-    int index = find_entry_index(self, key);
-
-    if (index >= 0) {
-        
-        free(self->entries[index].value);
+void StoreDictPattern_close(StoreDictPattern* self) {
+    self->compactor_running = false;
+    if (self->compactor_thread) {
+        WaitForSingleObject(self->compactor_thread, 1000);
+        CloseHandle(self->compactor_thread);
+        self->compactor_thread = NULL;
+    }
 
-        
-        unsigned char* value_copy = (unsigned char*)malloc(value_size);
-        if (!value_copy) {
-            printf("Failed to allocate memory for value\n");
-            return;
-        }
+    log_index_reset(&self->log_index);
+    ipc_names_free(&self->names);
+    self->shm.close(&self->shm);
 
-        memcpy(value_copy, value, value_size);
-        self->entries[index].value = value_copy;
-        self->entries[index].value_size = value_size;
+    if (self->verbose) {
+        printf("Dictionary closed\n");
     }
-    else {
-        
-        if (self->entry_count >= self->entry_capacity) {
-            if (!resize_entries(self, self->entry_capacity * 2)) {
-                printf("Failed to resize entries array\n");
-                return;
-            }
-        }
+}
 
-        // Make a copy of the key
-        char* key_copy = _strdup(key);
-        if (!key_copy) {
-            printf("Failed to allocate memory for key\n");
-            return;
-        }
+// Every store already lands in the segment, so there is nothing left to
+// serialize. sync only publishes a version bump, for callers that want
+// readers to re-check after a batch of out-of-band changes.
+bool StoreDictPattern_sync(StoreDictPattern* self) {
+    if (!lock_dict(self)) {
+        return false;
+    }
 
-        // Make a copy of the value
-        unsigned char* value_copy = (unsigned char*)malloc(value_size);
-        if (!value_copy) {
-            printf("Failed to allocate memory for value\n");
-            free(key_copy);
-            return;
-        }
+    self->shm.begin_update(&self->shm);
+    bool ready = ensure_layout(self);
+    if (ready) {
+        self->version = ++dict_header(self)->version;
+        self->shm.touch(&self->shm, 0, sizeof(StoreDictHeader));
+    }
+    self->shm.end_update(&self->shm);
 
-        memcpy(value_copy, value, value_size);
+    ReleaseMutex(self->mutex);
 
-        
-        self->entries[self->entry_count].key = key_copy;
-        self->entries[self->entry_count].value = value_copy;
-        self->entries[self->entry_count].value_size = value_size;
-        self->entry_count++;
+    if (self->verbose) {
+        printf("StoreDictPattern_sync: Table at version %u\n", self->version);
     }
-
-    
-    self->sync(self);
-}
\ No newline at end of file
+    return ready;
+}
@@ -4,43 +4,269 @@
 
 #include <stdbool.h>
 #include "shared_memory.h"
+#include "shm_arena.h"
+#include "name_table.h"
 #include <windows.h>
 #include <stdint.h>  // Add this for uint32_t
 
+#define STORE_DICT_MAGIC 0x38445353u      // "SSD8"
+#define STORE_DICT_INITIAL_BUCKETS 64     // Power of two
+#define STORE_DICT_EMPTY 0                // Bucket `record` values that are not offsets
+#define STORE_DICT_TOMBSTONE 1
+#define STORE_DICT_READ_RETRIES 64        // Optimistic read attempts before a reader takes the mutex
+#define STORE_DICT_INDEX_MAX_HEIGHT 16    // Skip list levels; each is kept with probability 1/4
+#define STORE_DICT_SWEEP_STEP 16          // Buckets the expiry sweeper looks at per write
+
+// StoreDictRecord flags
+#define STORE_DICT_RECORD_COUNTER 1       // Value is int64 updated with CPU atomics; the block is retired, not freed
+#define STORE_DICT_RECORD_SHARDED 2       // Counter split into per-core shards, one per STORE_DICT_COUNTER_STRIDE bytes
+
+#define STORE_DICT_COUNTER_STRIDE 64      // Bytes between shards, so no two share a cache line
+#define STORE_DICT_COUNTER_MAX_SHARDS 64
+#define STORE_DICT_COUNTER_GATE_CLOSED 0x80000000u
+#define STORE_DICT_COUNTER_DRAIN_MS 1000  // How long grow and clear wait for counter ops in flight
+#define STORE_DICT_COUNTER_GATE_SLOTS 32  // Processes that can update counters lock-free at once
+#define STORE_DICT_COUNTER_SLOT_RESETTING 0xFFFFFFFFu  // Gate slot pid while a dead owner's slot is reset
+#define STORE_DICT_COUNTER_RETIRE_BATCH 64  // Retired counter blocks kept before the gate is drained to free them
+
+// One process's share of the counter gate
+typedef struct StoreDictGateSlot {
+    volatile uint32_t pid;     // Owning process, 0 when free
+    volatile uint32_t token;   // ipc_process_token of `pid`, 0 until it is known
+    volatile uint32_t ns;      // ipc_pid_namespace of `pid`
+    volatile uint32_t inside;  // Lock-free counter ops the process has in flight
+} StoreDictGateSlot;
+
+// The dictionary lives entirely in the segment's data region as an
+// open-addressing hash table. This header embeds an arena that the bucket
+// array and every record are allocated from; replaced and removed records
+// go straight back to it. Offsets are relative to the data region so they
+// survive growth.
+//
+// Only writers take the mutex. Readers copy optimistically and validate two
+// seqlock counters afterwards: the record's own `seq`, which covers in-place
+// value updates, and the header's `layout`, which covers rebuilds that swap
+// the bucket array. Inserts, replacements and removes swap a single bucket
+// word, and a replaced record is only freed after that swap. Each attempt
+// pins the handle's view, so threads may share a handle: one that grows the
+// segment waits for the others' reads in flight before it remaps.
+//
+// Counters are records whose value is updated in place with CPU atomics and
+// no lock at all. `counter_gate` keeps updates out while a grow or clear may
+// copy or zero the segment. Updates in flight are counted per process in
+// `counter_slots`, so a process that dies inside an update leaves a count
+// the drain can recognise as dead and discard. A removed or replaced counter block is not freed
+// straight away, since an update that found it first may still land in it:
+// it is retired onto `counter_retired` and freed once the gate has been
+// closed and drained, when no update can still hold it.
+//
+// Every write stamps its entry with the next `entry_stamp`, so an entry's
+// version never repeats, even across a remove and re-insert. Version 0
+// means the key is absent. Lock-free counter updates leave it alone.
+//
+// A table may also keep an ordered index: a skip list of StoreDictIndexNode
+// in the same arena, one node per key, pointing at the key's current
+// record. Writers keep it in step under the mutex; scans walk it under the
+// mutex too.
+//
+// Entries may carry a deadline after which they read as absent. Deadlines
+// are wall-clock times, so they hold across processes, reboots of a
+// persistent segment and snapshot restores. The first access that finds
+// one expired removes it, and every write advances a sweeper over a few
+// buckets so entries nobody reads still go. A table with
+// a `capacity` evicts rather than failing writes: a CLOCK hand walks the
+// buckets, clearing each entry's `referenced` bit and evicting the first
+// entry found without one. Reads set the bit, taking the mutex only when it
+// was clear, so hot entries stay lock-free between passes of the hand.
+typedef struct StoreDictHeader {
+    uint32_t magic;
+    volatile uint32_t version;   // Bumped by every mutation
+    uint32_t bucket_count;
+    uint32_t entry_count;
+    uint32_t tombstone_count;    // Deleted buckets that still extend probe chains
+    volatile uint32_t layout;    // Odd while the bucket array is being swapped
+    volatile uint64_t buckets;   // Arena offset of the bucket array
+    uint32_t record_seq;         // Last seq handed to a new record
+    volatile uint32_t counter_gate;  // GATE_CLOSED while counter ops in flight drain
+    uint64_t entry_stamp;        // Last version handed to an entry
+    uint64_t index;              // Arena offset of the ordered index's head node, 0 when none is kept
+    uint32_t index_seed;         // Generator state for node heights
+    uint32_t ttl_count;          // Live entries with a deadline
+    uint64_t capacity;           // Arena bytes before writes evict, 0 for no bound
+    uint32_t clock_hand;         // Next bucket the eviction hand looks at
+    uint32_t sweep_cursor;       // Next bucket the expiry sweeper looks at
+    uint64_t evictions;          // Entries evicted to make room
+    uint64_t expirations;        // Expired entries removed, by access, sweep or the hand
+    uint64_t counter_retired;    // Arena offset of the newest retired counter block, 0 when none
+    uint32_t counter_retired_count;
+    StoreDictGateSlot counter_slots[STORE_DICT_COUNTER_GATE_SLOTS];
+    ShmArena arena;
+} StoreDictHeader;
+
+typedef struct StoreDictBucket {
+    uint64_t hash;
+    volatile uint64_t record;  // Offset of the StoreDictRecord, or EMPTY / TOMBSTONE; written last
+} StoreDictBucket;
+
+// Followed by the key (NUL included), then the value at an 8-byte boundary
+typedef struct StoreDictRecord {
+    uint32_t key_len;
+    uint32_t value_size;
+    uint32_t value_capacity;  // Room in the arena block; updates that fit stay in place
+    volatile uint32_t seq;    // Odd while the value is rewritten in place
+    uint32_t flags;           // STORE_DICT_RECORD_*; fixed when the record is written
+    volatile uint32_t referenced;  // CLOCK bit: read or written since the hand last passed
+    uint64_t version;         // Entry version; rewritten with the value, under `seq`
+    uint64_t expires_at;      // ipc_wall_ms deadline, 0 for none; rewritten with the value
+} StoreDictRecord;
+
+#define STORE_DICT_LOG_MAGIC 0x324C5353u  // "SSL2"
+#define STORE_DICT_LOG_TOMBSTONE 1         // StoreDictLogRecord flag: the key was removed
+#define STORE_DICT_LOG_COMPACT_MIN (64 * 1024)  // Log bytes before compaction is considered
+#define STORE_DICT_LOG_COMPACT_POLL_MS 100      // How often the compactor looks at the log
+
+// Followed by `height` next offsets, then the key (NUL included)
+typedef struct StoreDictIndexNode {
+    uint64_t record;   // Offset of the key's current StoreDictRecord
+    uint32_t key_len;
+    uint32_t height;
+} StoreDictIndexNode;
+
+// Receives each entry of a scan in key order. The views point into the
+// segment and are only valid during the call, which must not modify the
+// dictionary. Return false to stop the scan.
+typedef bool (*StoreDictScanFn)(const char* key, const unsigned char* value, size_t value_size, void* user_data);
+
+typedef struct StoreDictCacheStats {
+    uint64_t capacity;     // Eviction bound in arena bytes, 0 for none
+    uint64_t used;         // Arena bytes held by the table, entries and buckets alike
+    uint64_t entries;      // Includes expired entries not yet removed
+    uint64_t expiring;     // Entries with a deadline
+    uint64_t expirations;
+    uint64_t evictions;
+} StoreDictCacheStats;
+
+#define STORE_DICT_SNAPSHOT_MAGIC 0x53445353u  // "SSDS"
+
+// Leads a snapshot file. The segment image follows byte for byte: the
+// table from its header up to the arena's top, or the log up to log_end.
+typedef struct StoreDictSnapshotHeader {
+    uint32_t magic;
+    uint32_t layout_magic;   // STORE_DICT_MAGIC or STORE_DICT_LOG_MAGIC
+    uint64_t image_size;     // Bytes of segment image after this header
+    uint64_t segment_size;   // Data region the image needs; the arena's end for tables
+} StoreDictSnapshotHeader;
+
+typedef enum StoreDictMode {
+    STORE_DICT_MODE_TABLE = 0,  // Records updated in place in a shared hash table (default)
+    STORE_DICT_MODE_LOG = 1     // Records appended to a log; each handle indexes it privately
+} StoreDictMode;
+
+// Log mode keeps this header, then records appended back to back. A write
+// costs one record no matter how large the dictionary is; readers replay
+// what was appended since they last looked.
+typedef struct StoreDictLogHeader {
+    uint32_t magic;
+    volatile uint32_t version;   // Same place as in StoreDictHeader
+    volatile uint32_t epoch;     // Bumped by compaction, which moves every record
+    uint32_t live_count;
+    uint64_t log_start;
+    volatile uint64_t log_end;   // Records below this offset are complete
+    uint64_t dead_bytes;         // Superseded records and tombstones, reclaimed by compaction
+    uint64_t entry_stamp;        // Last version handed to a record
+} StoreDictLogHeader;
+
+// Followed by the key (NUL included), then the value at an 8-byte boundary
+typedef struct StoreDictLogRecord {
+    uint32_t key_len;
+    uint32_t value_size;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t version;  // Entry version; kept by compaction, 0 for tombstones
+} StoreDictLogRecord;
+
+// Process-local index of the log, rebuilt whenever the epoch moves
+typedef struct StoreDictLogSlot {
+    uint64_t hash;
+    char* key;        // NULL for an unused slot
+    uint32_t key_len; // Including the terminator
+    uint64_t record;  // Offset of the latest record for the key, 0 once removed
+} StoreDictLogSlot;
+
+typedef struct StoreDictLogIndex {
+    StoreDictLogSlot* slots;
+    uint32_t capacity;  // Power of two
+    uint32_t used;
+    uint32_t epoch;     // Epoch the record offsets belong to; 0 before the first replay
+    uint64_t replayed;  // Log offset applied up to
+} StoreDictLogIndex;
+
 // Forward declaration
 typedef struct StoreDictPattern StoreDictPattern;
 
-// Entry structure
-typedef struct {
-    char* key;
-    unsigned char* value;
-    size_t value_size;
-} DictEntry;
-
 // StoreDictPattern structure
 typedef struct StoreDictPattern {
     // Data members
     char* id;
     size_t size;
     SharedMemory shm;
-    DictEntry* entries;
-    size_t entry_count;
-    size_t entry_capacity;
     bool verbose;
     HANDLE mutex;  // Named mutex for cross-process synchronization
-    uint32_t version;  // Version number for change tracking
+    uint32_t version;  // Table version this handle last saw
+    StoreDictMode mode;
+    StoreDictLogIndex log_index;
+    volatile bool compactor_running;
+    HANDLE compactor_thread;
+    IpcNameTable names;  // Keys resolved through this handle
+    bool ordered;        // Keep an ordered index; follows the segment once attached
+    uint64_t capacity;   // Eviction bound to apply; follows the segment once attached
+    uint32_t gate_slot;  // This process's counter gate slot, UINT32_MAX until claimed
 
     // Method pointers
+    bool (*set_mode)(struct StoreDictPattern* self, StoreDictMode mode);
+    bool (*set_ordered)(struct StoreDictPattern* self, bool ordered);
+    bool (*set_capacity)(struct StoreDictPattern* self, uint64_t capacity);
     bool (*setup)(struct StoreDictPattern* self);
     bool (*store)(struct StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size);
     void (*store_string)(struct StoreDictPattern* self, const char* key, const char* value);
     void (*store_bytes)(struct StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size);
+    size_t (*store_many)(struct StoreDictPattern* self, const char* const* keys,
+        const unsigned char* const* values, const size_t* sizes, size_t count);
+    bool (*store_with_ttl)(struct StoreDictPattern* self, const char* key, const unsigned char* value,
+        size_t value_size, uint64_t ttl_ms);
+    bool (*store_resolved)(struct StoreDictPattern* self, const IpcName* key, const unsigned char* value, size_t value_size);
     unsigned char* (*retrieve)(struct StoreDictPattern* self, const char* key, size_t* out_size);
     unsigned char* (*retrieve_bytes)(struct StoreDictPattern* self, const char* key, size_t* out_size);
     char* (*retrieve_string)(struct StoreDictPattern* self, const char* key);
+    size_t (*retrieve_many)(struct StoreDictPattern* self, const char* const* keys, size_t count,
+        unsigned char** out_values, size_t* out_sizes);
+    unsigned char* (*retrieve_resolved)(struct StoreDictPattern* self, const IpcName* key, size_t* out_size);
+    unsigned char* (*retrieve_with_version)(struct StoreDictPattern* self, const char* key, size_t* out_size,
+        uint64_t* out_version);
+    bool (*store_if_version)(struct StoreDictPattern* self, const char* key, const unsigned char* value,
+        size_t value_size, uint64_t expected_version, uint64_t* out_version);
+    const IpcName* (*resolve)(struct StoreDictPattern* self, const char* key);
+    bool (*create_counter)(struct StoreDictPattern* self, const char* key, int64_t initial, uint32_t shards);
+    bool (*atomic_add)(struct StoreDictPattern* self, const char* key, int64_t delta, int64_t* out_value);
+    bool (*atomic_get)(struct StoreDictPattern* self, const char* key, int64_t* out_value);
+    bool (*compare_exchange)(struct StoreDictPattern* self, const char* key, int64_t expected, int64_t desired,
+        int64_t* out_actual);
+    bool (*remove)(struct StoreDictPattern* self, const char* key);
+    size_t (*scan_prefix)(struct StoreDictPattern* self, const char* prefix, StoreDictScanFn fn, void* user_data);
+    size_t (*scan_range)(struct StoreDictPattern* self, const char* start, const char* end,
+        StoreDictScanFn fn, void* user_data);
+    bool (*snapshot)(struct StoreDictPattern* self, const char* path);
+    bool (*restore)(struct StoreDictPattern* self, const char* path);
+    size_t (*count)(struct StoreDictPattern* self);
     void (*load)(struct StoreDictPattern* self);
+    bool (*refresh_if_changed)(struct StoreDictPattern* self);
     bool (*sync)(struct StoreDictPattern* self);
     char** (*list_keys)(struct StoreDictPattern* self, size_t* out_count);
+    void (*clear)(struct StoreDictPattern* self);
+    size_t (*sweep)(struct StoreDictPattern* self, uint32_t max_buckets);
+    bool (*cache_stats)(struct StoreDictPattern* self, StoreDictCacheStats* out_stats);
+    bool (*arena_stats)(struct StoreDictPattern* self, ShmArenaStats* out_stats);
+    bool (*compact)(struct StoreDictPattern* self);
     void (*close)(struct StoreDictPattern* self);
 } StoreDictPattern;
 
@@ -48,16 +274,83 @@ typedef struct StoreDictPattern {
 void StoreDictPattern_init(StoreDictPattern* store, const char* id, size_t size, bool verbose);
 
 // Method implementations
+// Picks the storage layout for a new segment. Call before setup; a handle
+// attaching to an existing segment follows whatever layout it already has.
+bool StoreDictPattern_set_mode(StoreDictPattern* self, StoreDictMode mode);
+// Asks for an ordered index (table mode only). Call before setup; an
+// existing table without one gets it built at setup, in O(n log n).
+bool StoreDictPattern_set_ordered(StoreDictPattern* self, bool ordered);
+// Bounds the table's arena to `capacity` bytes (table mode only, 0 for no
+// bound); writes past it evict approximately least recently used entries.
+// Call before setup; a nonzero bound replaces the one an existing table has.
+bool StoreDictPattern_set_capacity(StoreDictPattern* self, uint64_t capacity);
 bool StoreDictPattern_setup(StoreDictPattern* self);
 bool StoreDictPattern_store(StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size);
 void StoreDictPattern_store_string(StoreDictPattern* self, const char* key, const char* value);
 void StoreDictPattern_store_bytes(StoreDictPattern* self, const char* key, const unsigned char* value, size_t value_size);
+size_t StoreDictPattern_store_many(StoreDictPattern* self, const char* const* keys,
+    const unsigned char* const* values, const size_t* sizes, size_t count);
+// Stores `key` to read as absent once `ttl_ms` has passed (table mode only;
+// 0 never expires). Plain stores clear any deadline the key had.
+bool StoreDictPattern_store_with_ttl(StoreDictPattern* self, const char* key, const unsigned char* value,
+    size_t value_size, uint64_t ttl_ms);
+// The *_resolved variants take a key from resolve (or any IpcName) and skip
+// hashing it again
+bool StoreDictPattern_store_resolved(StoreDictPattern* self, const IpcName* key, const unsigned char* value, size_t value_size);
 unsigned char* StoreDictPattern_retrieve(StoreDictPattern* self, const char* key, size_t* out_size);
 unsigned char* StoreDictPattern_retrieve_bytes(StoreDictPattern* self, const char* key, size_t* out_size);
 char* StoreDictPattern_retrieve_string(StoreDictPattern* self, const char* key);
+size_t StoreDictPattern_retrieve_many(StoreDictPattern* self, const char* const* keys, size_t count,
+    unsigned char** out_values, size_t* out_sizes);
+unsigned char* StoreDictPattern_retrieve_resolved(StoreDictPattern* self, const IpcName* key, size_t* out_size);
+const IpcName* StoreDictPattern_resolve(StoreDictPattern* self, const char* key);
+// Optimistic concurrency. retrieve_with_version reports the entry version
+// alongside the value; store_if_version stores only while the entry is
+// still at `expected_version` (0: only if absent). Either way
+// `out_version` receives the entry's version afterwards, so a failed
+// caller can re-read and retry.
+unsigned char* StoreDictPattern_retrieve_with_version(StoreDictPattern* self, const char* key, size_t* out_size,
+    uint64_t* out_version);
+bool StoreDictPattern_store_if_version(StoreDictPattern* self, const char* key, const unsigned char* value,
+    size_t value_size, uint64_t expected_version, uint64_t* out_version);
+// Counters. In table mode these run lock-free on the segment; in log mode
+// they fall back to the mutex and any 8-byte value counts as a counter.
+// create_counter leaves an existing counter of the same shape alone and
+// replaces anything else. `shards` above 1 spreads adds over per-core
+// slots that atomic_get sums (table mode only, no compare_exchange).
+// atomic_add creates a missing key as a plain counter at 0. In table mode
+// only creating a counter bumps the version, not updating it.
+bool StoreDictPattern_create_counter(StoreDictPattern* self, const char* key, int64_t initial, uint32_t shards);
+bool StoreDictPattern_atomic_add(StoreDictPattern* self, const char* key, int64_t delta, int64_t* out_value);
+bool StoreDictPattern_atomic_get(StoreDictPattern* self, const char* key, int64_t* out_value);
+bool StoreDictPattern_compare_exchange(StoreDictPattern* self, const char* key, int64_t expected, int64_t desired,
+    int64_t* out_actual);
+bool StoreDictPattern_remove(StoreDictPattern* self, const char* key);
+// Ordered scans over the index, O(log n) to find the first key plus the
+// entries visited. scan_range covers [start, end); NULL leaves either side
+// open. Both return how many entries were passed to `fn`, and 0 when the
+// segment keeps no index.
+size_t StoreDictPattern_scan_prefix(StoreDictPattern* self, const char* prefix, StoreDictScanFn fn, void* user_data);
+size_t StoreDictPattern_scan_range(StoreDictPattern* self, const char* start, const char* end,
+    StoreDictScanFn fn, void* user_data);
+// Warm start. snapshot writes the segment image in its native layout;
+// restore validates the header and reads the image straight back into the
+// segment, replacing its contents with no per-key work. The image must
+// match this handle's mode. Entry versions are those of the snapshot.
+bool StoreDictPattern_snapshot(StoreDictPattern* self, const char* path);
+bool StoreDictPattern_restore(StoreDictPattern* self, const char* path);
+size_t StoreDictPattern_count(StoreDictPattern* self);
 void StoreDictPattern_load(StoreDictPattern* self);
+bool StoreDictPattern_refresh_if_changed(StoreDictPattern* self);
 bool StoreDictPattern_sync(StoreDictPattern* self);
 char** StoreDictPattern_list_keys(StoreDictPattern* self, size_t* out_count);
+void StoreDictPattern_clear(StoreDictPattern* self);
+// Removes expired entries from the next `max_buckets` buckets (0: the whole
+// table) and returns how many went. Writes already sweep a few each.
+size_t StoreDictPattern_sweep(StoreDictPattern* self, uint32_t max_buckets);
+bool StoreDictPattern_cache_stats(StoreDictPattern* self, StoreDictCacheStats* out_stats);
+bool StoreDictPattern_arena_stats(StoreDictPattern* self, ShmArenaStats* out_stats);
+bool StoreDictPattern_compact(StoreDictPattern* self);
 void StoreDictPattern_close(StoreDictPattern* self);
 
 #endif // STORE_DICT_PATTERN_H
\ No newline at end of file